@@ -88,6 +88,11 @@ GROUPS["softdiv"] = GROUPS["arm"] + ["ia64_efi"] + GROUPS["riscv32"]
 GROUPS["no_softdiv"]   = GRUB_PLATFORMS[:]
 for i in GROUPS["softdiv"]: GROUPS["no_softdiv"].remove(i)
 
+# Use the libgcrypt mpih assembly instead of the generic C code
+GROUPS["mpi_asm_amd64"] = GROUPS["x86_64"][:]
+GROUPS["mpi_generic"] = GRUB_PLATFORMS[:]
+for i in GROUPS["mpi_asm_amd64"]: GROUPS["mpi_generic"].remove(i)
+
 # Miscellaneous groups scheduled to disappear in future
 GROUPS["i386_coreboot_multiboot_qemu"] = ["i386_coreboot", "i386_multiboot", "i386_qemu"]
 GROUPS["nopc"] = GRUB_PLATFORMS[:]; GROUPS["nopc"].remove("i386_pc")
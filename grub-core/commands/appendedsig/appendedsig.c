@@ -69,6 +69,12 @@ struct grub_appended_signature
 /* Trusted certificates for verifying appended signatures */
 struct x509_certificate *grub_trusted_key;
 
+/*
+ * The certificate that verified the last signature. Kernels and modules are
+ * normally all signed by the same key, so try it first.
+ */
+static struct x509_certificate *last_good_key;
+
 /*
  * Force gcry_rsa to be a module dependency.
  *
@@ -159,6 +165,8 @@ read_cert_from_file (grub_file_t f, struct x509_certificate *certificate)
   if (err != GRUB_ERR_NONE)
     goto cleanup_buf;
 
+  certificate->modulus_nbits = gcry_mpi_get_nbits (certificate->mpis[0]);
+
   return GRUB_ERR_NONE;
 
 cleanup_buf:
@@ -225,6 +233,50 @@ extract_appended_signature (grub_uint8_t * buf, grub_size_t bufsize,
   return GRUB_ERR_NONE;
 }
 
+/*
+ * Check the signature against a single certificate. Returns 1 if it verifies,
+ * 0 if it doesn't and -1 (with grub_errno set) on error.
+ */
+static int
+verify_with_key (struct x509_certificate *pk, unsigned char *hash,
+		 struct grub_appended_signature *sig, unsigned int sig_nbits)
+{
+  gcry_mpi_t hashmpi;
+  gcry_err_code_t rc;
+
+  /* A signature is always smaller than the modulus of its key.  */
+  if (sig_nbits > pk->modulus_nbits)
+    {
+      grub_dprintf ("appendedsig", "skipping key '%s': %u-bit modulus\n",
+		    pk->subject, pk->modulus_nbits);
+      return 0;
+    }
+
+  rc = grub_crypto_rsa_pad (&hashmpi, hash, sig->pkcs7.hash, pk->mpis[0]);
+  if (rc)
+    {
+      grub_error (GRUB_ERR_BAD_SIGNATURE,
+		  N_("Error padding hash for RSA verification: %d"), rc);
+      return -1;
+    }
+
+  rc = _gcry_pubkey_spec_rsa.verify (0, hashmpi, &sig->pkcs7.sig_mpi,
+				     pk->mpis, NULL, NULL);
+  gcry_mpi_release (hashmpi);
+
+  if (rc == 0)
+    {
+      grub_dprintf ("appendedsig", "verify with key '%s' succeeded\n",
+		    pk->subject);
+      last_good_key = pk;
+      return 1;
+    }
+
+  grub_dprintf ("appendedsig", "verify with key '%s' failed with %d\n",
+		pk->subject, rc);
+  return 0;
+}
+
 static grub_err_t
 grub_verify_appended_signature (grub_uint8_t * buf, grub_size_t bufsize)
 {
@@ -232,10 +284,10 @@ grub_verify_appended_signature (grub_uint8_t * buf, grub_size_t bufsize)
   grub_size_t datasize;
   void *context;
   unsigned char *hash;
-  gcry_mpi_t hashmpi;
-  gcry_err_code_t rc;
   struct x509_certificate *pk;
   struct grub_appended_signature sig;
+  unsigned int sig_nbits;
+  int rc = 0;
 
   if (!grub_trusted_key)
     return grub_error (GRUB_ERR_BAD_SIGNATURE,
@@ -259,36 +311,24 @@ grub_verify_appended_signature (grub_uint8_t * buf, grub_size_t bufsize)
 		"data size %" PRIxGRUB_SIZE ", hash %02x%02x%02x%02x...\n",
 		datasize, hash[0], hash[1], hash[2], hash[3]);
 
-  err = GRUB_ERR_BAD_SIGNATURE;
-  for (pk = grub_trusted_key; pk; pk = pk->next)
-    {
-      rc = grub_crypto_rsa_pad (&hashmpi, hash, sig.pkcs7.hash, pk->mpis[0]);
-      if (rc)
-	{
-	  err = grub_error (GRUB_ERR_BAD_SIGNATURE,
-			    N_("Error padding hash for RSA verification: %d"),
-			    rc);
-	  goto cleanup;
-	}
+  sig_nbits = gcry_mpi_get_nbits (sig.pkcs7.sig_mpi);
 
-      rc = _gcry_pubkey_spec_rsa.verify (0, hashmpi, &sig.pkcs7.sig_mpi,
-					 pk->mpis, NULL, NULL);
-      gcry_mpi_release (hashmpi);
+  /* Try the key that verified the previous signature first.  */
+  if (last_good_key)
+    rc = verify_with_key (last_good_key, hash, &sig, sig_nbits);
 
-      if (rc == 0)
-	{
-	  grub_dprintf ("appendedsig", "verify with key '%s' succeeded\n",
-			pk->subject);
-	  err = GRUB_ERR_NONE;
-	  break;
-	}
+  for (pk = grub_trusted_key; rc == 0 && pk; pk = pk->next)
+    if (pk != last_good_key)
+      rc = verify_with_key (pk, hash, &sig, sig_nbits);
 
-      grub_dprintf ("appendedsig", "verify with key '%s' failed with %d\n",
-		    pk->subject, rc);
+  if (rc < 0)
+    {
+      err = grub_errno;
+      goto cleanup;
     }
 
   /* If we didn't verify, provide a neat message */
-  if (err != GRUB_ERR_NONE)
+  if (rc == 0)
       err = grub_error (GRUB_ERR_BAD_SIGNATURE,
 			N_("Failed to verify signature against a trusted key"));
 
@@ -375,6 +415,8 @@ grub_cmd_distrust (grub_command_t cmd __attribute__((unused)),
     return grub_error (GRUB_ERR_BAD_ARGUMENT,
 		       N_("Certificate number too small - numbers start at 1"));
 
+  last_good_key = NULL;
+
   if (cert_num == 1)
     {
       cert = grub_trusted_key;
@@ -564,6 +606,7 @@ GRUB_MOD_INIT (appendedsig)
     check_sigs = 2;
 
   grub_trusted_key = NULL;
+  last_good_key = NULL;
 
   grub_register_variable_hook ("check_appended_signatures",
   			       grub_env_read_sec,
@@ -41,6 +41,9 @@ struct x509_certificate
 
   /* We only support RSA public keys. This encodes [modulus, publicExponent] */
   gcry_mpi_t mpis[2];
+
+  /* Size of the modulus, used to skip keys that can't match a signature. */
+  unsigned int modulus_nbits;
 };
 
 /*
@@ -196,6 +196,8 @@ grub_loader_boot (void)
     return grub_error (GRUB_ERR_NO_KERNEL,
 		       N_("you need to load the kernel first"));
 
+  grub_boot_trace ('i', "loader", "boot", NULL);
+
   grub_machine_fini (grub_loader_flags);
 
   for (cur = preboots_head; cur; cur = cur->next)
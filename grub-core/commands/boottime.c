@@ -18,19 +18,427 @@
 
 #include <grub/dl.h>
 #include <grub/misc.h>
-#include <grub/command.h>
+#include <grub/mm.h>
+#include <grub/extcmd.h>
 #include <grub/i18n.h>
+#ifdef GRUB_MACHINE_EMU
+#include <grub/emu/hostfile.h>
+#endif
+#ifdef GRUB_MACHINE_EFI
+#include <grub/loader.h>
+#include <grub/efi/api.h>
+#include <grub/efi/efi.h>
+#include <grub/efi/memory.h>
+#endif
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
+static const struct grub_arg_option options[] =
+  {
+    {"tree", 't', 0, N_("Show nested trace spans and time per category."),
+     0, 0},
+    {"json", 'j', 0, N_("Print the trace in Chrome trace event format."),
+     0, 0},
+#ifdef GRUB_MACHINE_EMU
+    {"output", 'o', 0, N_("Write the JSON trace to host file FILE."),
+     N_("FILE"), ARG_TYPE_STRING},
+#endif
+#ifdef GRUB_MACHINE_EFI
+    {"efi", 'e', 0,
+     N_("Pass the JSON trace to the OS in the volatile EFI variable "
+	"GrubBootTrace when booting."), 0, 0},
+#endif
+    {0, 0, 0, 0, 0, 0}
+  };
+
+#if defined (GRUB_MACHINE_EMU)
+#define BOOTTIME_USAGE	N_("[-t|-j|-o FILE]")
+#elif defined (GRUB_MACHINE_EFI)
+#define BOOTTIME_USAGE	N_("[-t|-j|-e]")
+#else
+#define BOOTTIME_USAGE	N_("[-t|-j]")
+#endif
+
+enum options
+  {
+    BOOTTIME_TREE,
+    BOOTTIME_JSON,
+#ifdef GRUB_MACHINE_EMU
+    BOOTTIME_OUTPUT,
+#endif
+#ifdef GRUB_MACHINE_EFI
+    BOOTTIME_EFI,
+#endif
+  };
+
+/* Deepest span nesting tracked by --tree.  */
+#define TRACE_MAX_DEPTH	64
+/* Distinct categories summed up by --tree.  */
+#define TRACE_MAX_CATS	16
+/* Upper bound for one event in JSON: the fixed text plus the strings,
+   each byte of which may be escaped into 6 bytes.  */
+#define TRACE_JSON_EVENT_MAX \
+  (128 + 6 * (2 * 16 + GRUB_BOOT_TRACE_DETAIL_LEN))
+
+static grub_size_t
+trace_first (void)
+{
+  if (grub_boot_trace_count > GRUB_BOOT_TRACE_EVENTS)
+    return grub_boot_trace_count - GRUB_BOOT_TRACE_EVENTS;
+  return 0;
+}
+
+static struct grub_boot_trace_event *
+trace_event (grub_size_t i)
+{
+  return &grub_boot_trace_buf[i % GRUB_BOOT_TRACE_EVENTS];
+}
+
+static void
+print_us (grub_uint64_t us)
+{
+  grub_printf ("%" PRIuGRUB_UINT64_T ".%03u ms",
+	       us / 1000, (unsigned) (us % 1000));
+}
+
+static void
+print_tree (void)
+{
+  grub_size_t i, j, first = trace_first (), end = grub_boot_trace_count;
+  grub_uint64_t base = trace_event (first)->ts;
+  struct
+  {
+    const char *cat;
+    grub_uint64_t ts;
+    int outer;
+  } stack[TRACE_MAX_DEPTH];
+  struct
+  {
+    const char *cat;
+    grub_uint64_t total;
+  } cats[TRACE_MAX_CATS];
+  unsigned depth = 0, ncats = 0, k;
+
+  if (first)
+    grub_printf_ (N_("%" PRIuGRUB_SIZE " older events were dropped\n"),
+		  first);
+
+  for (i = first; i < end; i++)
+    {
+      struct grub_boot_trace_event *ev = trace_event (i);
+
+      if (ev->phase == 'E')
+	{
+	  if (depth == 0)
+	    continue;
+	  depth--;
+	  if (depth >= TRACE_MAX_DEPTH || !stack[depth].outer)
+	    continue;
+	  for (k = 0; k < ncats; k++)
+	    if (grub_strcmp (cats[k].cat, stack[depth].cat) == 0)
+	      break;
+	  if (k == ncats && ncats < TRACE_MAX_CATS)
+	    {
+	      cats[ncats].cat = stack[depth].cat;
+	      cats[ncats++].total = 0;
+	    }
+	  if (k < ncats)
+	    cats[k].total += ev->ts - stack[depth].ts;
+	  continue;
+	}
+
+      grub_printf ("%10" PRIuGRUB_UINT64_T "us ", ev->ts - base);
+      for (k = 0; k < depth && k < 32; k++)
+	grub_printf ("  ");
+      grub_printf ("%s %s %s", ev->phase == 'B' ? "+" : "*",
+		   ev->cat, ev->name);
+      if (ev->detail[0])
+	grub_printf (" `%s'", ev->detail);
+
+      if (ev->phase != 'B')
+	{
+	  grub_printf ("\n");
+	  continue;
+	}
+
+      /* Find the matching end to print the duration.  */
+      {
+	unsigned nest = 0;
+
+	for (j = i + 1; j < end; j++)
+	  {
+	    struct grub_boot_trace_event *e = trace_event (j);
+
+	    if (e->phase == 'B')
+	      nest++;
+	    else if (e->phase == 'E' && nest-- == 0)
+	      break;
+	  }
+	grub_printf (": ");
+	if (j < end)
+	  print_us (trace_event (j)->ts - ev->ts);
+	else
+	  grub_printf ("%s", _("unfinished"));
+	grub_printf ("\n");
+      }
+
+      if (depth < TRACE_MAX_DEPTH)
+	{
+	  stack[depth].cat = ev->cat;
+	  stack[depth].ts = ev->ts;
+	  stack[depth].outer = 1;
+	  for (k = 0; k < depth; k++)
+	    if (grub_strcmp (stack[k].cat, ev->cat) == 0)
+	      stack[depth].outer = 0;
+	}
+      depth++;
+    }
+
+  grub_printf ("\n%s\n", _("Time per category:"));
+  for (k = 0; k < ncats; k++)
+    {
+      grub_printf ("  %-8s ", cats[k].cat);
+      print_us (cats[k].total);
+      grub_printf ("\n");
+    }
+}
+
+static char *
+json_escape (char *p, const char *s)
+{
+  for (; *s; s++)
+    {
+      unsigned char c = *s;
+
+      if (c == '"' || c == '\\')
+	{
+	  *p++ = '\\';
+	  *p++ = c;
+	}
+      else if (c < 0x20)
+	p += grub_snprintf (p, 7, "\\u%04x", c);
+      else if (c >= 0x80)
+	/* Truncation may have split a UTF-8 sequence.  */
+	*p++ = '?';
+      else
+	*p++ = c;
+    }
+  return p;
+}
+
+/* Format EV into BUF, which holds TRACE_JSON_EVENT_MAX bytes, preceded by
+   a separator unless it's the FIRST event.  Returns the length.  */
+static grub_size_t
+event_to_json (char *buf, const struct grub_boot_trace_event *ev, int first)
+{
+  char *p = buf;
+
+  p = grub_stpcpy (p, first ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+  p = json_escape (p, ev->name);
+  p = grub_stpcpy (p, "\",\"cat\":\"");
+  p = json_escape (p, ev->cat);
+  p += grub_snprintf (p, 64, "\",\"ph\":\"%c\",\"ts\":%" PRIuGRUB_UINT64_T
+		      ",\"pid\":1,\"tid\":1", ev->phase, ev->ts);
+  if (ev->phase == 'i')
+    p = grub_stpcpy (p, ",\"s\":\"g\"");
+  if (ev->detail[0])
+    {
+      p = grub_stpcpy (p, ",\"args\":{\"detail\":\"");
+      p = json_escape (p, ev->detail);
+      p = grub_stpcpy (p, "\"}");
+    }
+  *p++ = '}';
+  return p - buf;
+}
+
+/* Write the trace into BUF of SIZE bytes: as many of the newest events as
+   fit, in the order they were recorded, since viewers pair "B" and "E"
+   events with equal timestamps by their order.  Returns the length, or 0
+   if not even the framing fits.  Doesn't allocate, so it's usable while
+   booting.  */
+static grub_size_t
+trace_to_json (char *buf, grub_size_t size)
+{
+  static const char head[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  static const char tail[] = "\n]}\n";
+  char ev_buf[TRACE_JSON_EVENT_MAX];
+  grub_size_t i, start, first = trace_first (), len, n;
+
+  if (size < sizeof (head) + sizeof (tail))
+    return 0;
+
+  grub_memcpy (buf, head, sizeof (head) - 1);
+  len = sizeof (head) - 1;
+
+  /* Find the oldest event that still fits, counting each with its
+     separator.  */
+  n = len + sizeof (tail);
+  for (start = grub_boot_trace_count; start > first; start--)
+    {
+      grub_size_t ev_len = event_to_json (ev_buf, trace_event (start - 1), 0);
+
+      if (n + ev_len > size)
+	break;
+      n += ev_len;
+    }
+
+  for (i = start; i < grub_boot_trace_count; i++)
+    {
+      n = event_to_json (ev_buf, trace_event (i), i == start);
+      grub_memcpy (buf + len, ev_buf, n);
+      len += n;
+    }
+
+  grub_memcpy (buf + len, tail, sizeof (tail));
+  return len + sizeof (tail) - 1;
+}
+
+static char *
+trace_json_alloc (grub_size_t *len)
+{
+  grub_size_t size = (grub_boot_trace_count - trace_first ())
+    * TRACE_JSON_EVENT_MAX + 128;
+  char *buf = grub_malloc (size);
+
+  if (buf)
+    *len = trace_to_json (buf, size);
+  return buf;
+}
+
+#ifdef GRUB_MACHINE_EMU
+static grub_err_t
+write_host_file (const char *name)
+{
+  grub_util_fd_t fd;
+  grub_size_t len;
+  char *buf;
+  grub_err_t err = GRUB_ERR_NONE;
+
+  buf = trace_json_alloc (&len);
+  if (!buf)
+    return grub_errno;
+
+  fd = grub_util_fd_open (name, GRUB_UTIL_FD_O_WRONLY
+			  | GRUB_UTIL_FD_O_CREATTRUNC);
+  if (!GRUB_UTIL_FD_IS_VALID (fd))
+    err = grub_error (GRUB_ERR_BAD_FILENAME, N_("cannot open `%s': %s"),
+		      name, grub_util_fd_strerror ());
+  else
+    {
+      if (grub_util_fd_write (fd, buf, len) != (grub_ssize_t) len)
+	err = grub_error (GRUB_ERR_WRITE_ERROR, N_("cannot write to `%s': %s"),
+			  name, grub_util_fd_strerror ());
+      grub_util_fd_close (fd);
+    }
+  grub_free (buf);
+  return err;
+}
+#endif
+
+#ifdef GRUB_MACHINE_EFI
+/* Most firmwares refuse variables much bigger than this.  */
+#define TRACE_EFI_VAR_PAGES	8
+
+static struct grub_preboot *efi_preboot;
+static grub_efi_physical_address_t efi_var_buf;
+
+/* The heap may already be returned to the firmware when this runs, so
+   the buffer comes straight from EFI and nothing here allocates.  */
+static grub_err_t
+efi_export_trace (int noreturn __attribute__ ((unused)))
+{
+  static grub_efi_char16_t name[] =
+    { 'G', 'r', 'u', 'b', 'B', 'o', 'o', 't', 'T', 'r', 'a', 'c', 'e', 0 };
+  static grub_efi_guid_t guid = GRUB_EFI_GRUB_VARIABLE_GUID;
+  grub_efi_runtime_services_t *r = grub_efi_system_table->runtime_services;
+  grub_size_t len;
+
+  len = trace_to_json ((char *) (grub_addr_t) efi_var_buf,
+		       TRACE_EFI_VAR_PAGES << GRUB_EFI_PAGE_SHIFT);
+  if (len)
+    efi_call_5 (r->set_variable, name, &guid,
+		GRUB_EFI_VARIABLE_BOOTSERVICE_ACCESS
+		| GRUB_EFI_VARIABLE_RUNTIME_ACCESS,
+		len, (void *) (grub_addr_t) efi_var_buf);
+  return GRUB_ERR_NONE;
+}
+
+static grub_err_t
+efi_export_trace_rest (void)
+{
+  return GRUB_ERR_NONE;
+}
+
+static grub_err_t
+efi_export_enable (void)
+{
+  void *buf;
+
+  if (efi_preboot)
+    return GRUB_ERR_NONE;
+
+  buf = grub_efi_allocate_any_pages (TRACE_EFI_VAR_PAGES);
+  if (!buf)
+    return grub_error (GRUB_ERR_OUT_OF_MEMORY, N_("out of memory"));
+  efi_var_buf = (grub_addr_t) buf;
+
+  efi_preboot = grub_loader_register_preboot_hook (efi_export_trace,
+						   efi_export_trace_rest,
+						   GRUB_LOADER_PREBOOT_HOOK_PRIO_NORMAL);
+  if (!efi_preboot)
+    {
+      grub_efi_free_pages (efi_var_buf, TRACE_EFI_VAR_PAGES);
+      return grub_errno;
+    }
+  return GRUB_ERR_NONE;
+}
+#endif
 
 static grub_err_t
-grub_cmd_boottime (struct grub_command *cmd __attribute__ ((unused)),
+grub_cmd_boottime (grub_extcmd_context_t ctxt,
 		   int argc __attribute__ ((unused)),
 		   char *argv[] __attribute__ ((unused)))
 {
+  struct grub_arg_list *state = ctxt->state;
   struct grub_boot_time *cur;
   grub_uint64_t last_time = 0, start_time = 0;
+
+#ifdef GRUB_MACHINE_EFI
+  if (state[BOOTTIME_EFI].set)
+    return efi_export_enable ();
+#endif
+
+  if (state[BOOTTIME_TREE].set || state[BOOTTIME_JSON].set
+#ifdef GRUB_MACHINE_EMU
+      || state[BOOTTIME_OUTPUT].set
+#endif
+      )
+    {
+      if (!grub_boot_trace_count)
+	{
+	  grub_puts_ (N_("No boot trace is available"));
+	  return 0;
+	}
+
+#ifdef GRUB_MACHINE_EMU
+      if (state[BOOTTIME_OUTPUT].set)
+	return write_host_file (state[BOOTTIME_OUTPUT].arg);
+#endif
+      if (state[BOOTTIME_JSON].set)
+	{
+	  grub_size_t len;
+	  char *buf = trace_json_alloc (&len);
+
+	  if (!buf)
+	    return grub_errno;
+	  grub_xputs (buf);
+	  grub_free (buf);
+	}
+      else
+	print_tree ();
+      return 0;
+    }
+
   if (!grub_boot_time_head)
     {
       grub_puts_ (N_("No boot time statistics is available\n"));
@@ -50,16 +458,24 @@ grub_cmd_boottime (struct grub_command *cmd __attribute__ ((unused)),
  return 0;
 }
 
-static grub_command_t cmd_boottime;
+static grub_extcmd_t cmd_boottime;
 
 GRUB_MOD_INIT(boottime)
 {
   cmd_boottime =
-    grub_register_command ("boottime", grub_cmd_boottime,
-			   0, N_("Show boot time statistics."));
+    grub_register_extcmd ("boottime", grub_cmd_boottime, 0,
+			  BOOTTIME_USAGE,
+			  N_("Show boot time statistics."), options);
 }
 
 GRUB_MOD_FINI(boottime)
 {
-  grub_unregister_command (cmd_boottime);
+#ifdef GRUB_MACHINE_EFI
+  if (efi_preboot)
+    {
+      grub_loader_unregister_preboot_hook (efi_preboot);
+      grub_efi_free_pages (efi_var_buf, TRACE_EFI_VAR_PAGES);
+    }
+#endif
+  grub_unregister_extcmd (cmd_boottime);
 }
@@ -0,0 +1,225 @@
+/* disktrace.c - record and dump the disk access pattern.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/dl.h>
+#include <grub/disk.h>
+#include <grub/extcmd.h>
+#include <grub/i18n.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+#ifdef GRUB_MACHINE_EMU
+#include <grub/emu/hostfile.h>
+#endif
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+/* About 3MiB on 64-bit.  */
+#define DISKTRACE_DEFAULT_ENTRIES	65536
+
+static const struct grub_arg_option options[] =
+  {
+    {"entries", 'n', 0, N_("Keep the last N accesses (default 65536)."),
+     N_("N"), ARG_TYPE_INT},
+#ifdef GRUB_MACHINE_EMU
+    {"output", 'o', 0, N_("Write the trace to host file FILE."),
+     N_("FILE"), ARG_TYPE_STRING},
+#endif
+    {0, 0, 0, 0, 0, 0}
+  };
+
+enum options
+  {
+    DISKTRACE_ENTRIES,
+#ifdef GRUB_MACHINE_EMU
+    DISKTRACE_OUTPUT,
+#endif
+  };
+
+static const char *const event_names[] =
+  {
+    [GRUB_DISK_TRACE_READ] = "read",
+    [GRUB_DISK_TRACE_HIT] = "hit",
+    [GRUB_DISK_TRACE_MISS] = "miss",
+    [GRUB_DISK_TRACE_DEV] = "dev"
+  };
+
+/* The module containing the caller, which is good enough to tell a
+   filesystem from a partition map or a disk driver layered on top of
+   another disk.  */
+static const char *
+caller_layer (const void *caller)
+{
+  grub_dl_t mod = NULL;
+  grub_size_t offset;
+
+  if (!caller)
+    return "-";
+  grub_dl_addr_to_symbol (caller, &mod, &offset);
+  return mod ? mod->name : "kernel";
+}
+
+static char *
+format_entry (const struct grub_disk_trace_entry *entry)
+{
+  return grub_xasprintf ("%" PRIuGRUB_UINT64_T " %s %s %" PRIuGRUB_UINT64_T
+			 " %u %u %s\n", entry->time_us,
+			 event_names[entry->event],
+			 entry->disk ? entry->disk : "?", entry->sector,
+			 entry->offset, entry->size,
+			 caller_layer (entry->caller));
+}
+
+static int
+print_entry (const struct grub_disk_trace_entry *entry,
+	     void *data __attribute__ ((unused)))
+{
+  char *line = format_entry (entry);
+
+  if (!line)
+    return 1;
+  grub_xputs (line);
+  grub_free (line);
+  return 0;
+}
+
+#ifdef GRUB_MACHINE_EMU
+struct write_ctx
+{
+  grub_util_fd_t fd;
+  const char *name;
+};
+
+static int
+write_entry (const struct grub_disk_trace_entry *entry, void *data)
+{
+  struct write_ctx *ctx = data;
+  char *line = format_entry (entry);
+  grub_size_t len;
+
+  if (!line)
+    return 1;
+  len = grub_strlen (line);
+  if (grub_util_fd_write (ctx->fd, line, len) != (grub_ssize_t) len)
+    grub_error (GRUB_ERR_WRITE_ERROR, N_("cannot write to `%s': %s"),
+		ctx->name, grub_util_fd_strerror ());
+  grub_free (line);
+  return grub_errno != GRUB_ERR_NONE;
+}
+
+static grub_err_t
+write_host_file (const char *name)
+{
+  struct write_ctx ctx = { .name = name };
+  static const char header[] =
+    "# time_us event disk sector offset bytes layer\n";
+  grub_uint64_t dropped;
+  char *footer;
+
+  ctx.fd = grub_util_fd_open (name, GRUB_UTIL_FD_O_WRONLY
+			      | GRUB_UTIL_FD_O_CREATTRUNC);
+  if (!GRUB_UTIL_FD_IS_VALID (ctx.fd))
+    return grub_error (GRUB_ERR_BAD_FILENAME, N_("cannot open `%s': %s"),
+		       name, grub_util_fd_strerror ());
+
+  if (grub_util_fd_write (ctx.fd, header, sizeof (header) - 1)
+      != sizeof (header) - 1)
+    grub_error (GRUB_ERR_WRITE_ERROR, N_("cannot write to `%s': %s"),
+		name, grub_util_fd_strerror ());
+  else
+    {
+      dropped = grub_disk_trace_iterate (write_entry, &ctx);
+      if (dropped && !grub_errno)
+	{
+	  footer = grub_xasprintf ("# %" PRIuGRUB_UINT64_T
+				   " older entries dropped\n", dropped);
+	  if (footer)
+	    grub_util_fd_write (ctx.fd, footer, grub_strlen (footer));
+	  grub_free (footer);
+	}
+    }
+  grub_util_fd_close (ctx.fd);
+  return grub_errno;
+}
+#endif
+
+static grub_err_t
+grub_cmd_disktrace (grub_extcmd_context_t ctxt, int argc, char **args)
+{
+  struct grub_arg_list *state = ctxt->state;
+
+  if (argc != 1)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("one argument expected"));
+
+  if (grub_strcmp (args[0], "start") == 0)
+    {
+      grub_size_t entries = DISKTRACE_DEFAULT_ENTRIES;
+
+      if (state[DISKTRACE_ENTRIES].set)
+	{
+	  const char *end;
+
+	  entries = grub_strtoul (state[DISKTRACE_ENTRIES].arg, &end, 0);
+	  if (grub_errno || *end || !entries)
+	    return grub_error (GRUB_ERR_BAD_ARGUMENT,
+			       N_("invalid number of entries"));
+	}
+      return grub_disk_trace_start (entries);
+    }
+
+  if (grub_strcmp (args[0], "stop") == 0)
+    {
+      grub_disk_trace_stop ();
+      return GRUB_ERR_NONE;
+    }
+
+  if (grub_strcmp (args[0], "dump") == 0)
+    {
+      grub_uint64_t dropped;
+
+#ifdef GRUB_MACHINE_EMU
+      if (state[DISKTRACE_OUTPUT].set)
+	return write_host_file (state[DISKTRACE_OUTPUT].arg);
+#endif
+      grub_puts ("# time_us event disk sector offset bytes layer");
+      dropped = grub_disk_trace_iterate (print_entry, NULL);
+      if (dropped)
+	grub_printf ("# %" PRIuGRUB_UINT64_T " older entries dropped\n",
+		     dropped);
+      return grub_errno;
+    }
+
+  return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("unknown subcommand `%s'"),
+		     args[0]);
+}
+
+static grub_extcmd_t cmd;
+
+GRUB_MOD_INIT(disktrace)
+{
+  cmd = grub_register_extcmd ("disktrace", grub_cmd_disktrace, 0,
+			      N_("[-n N] start | stop | dump"),
+			      N_("Record disk accesses and show them."),
+			      options);
+}
+
+GRUB_MOD_FINI(disktrace)
+{
+  grub_disk_trace_stop ();
+  grub_unregister_extcmd (cmd);
+}
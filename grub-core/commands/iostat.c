@@ -0,0 +1,132 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/dl.h>
+#include <grub/env.h>
+#include <grub/extcmd.h>
+#include <grub/i18n.h>
+#include <grub/iostat.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+static const struct grub_arg_option options[] =
+  {
+    {"set", 's', 0,
+     N_("Store the counters in variables named "
+	"iostat_CLASS_OBJECT_COUNTER instead of printing them."), 0, 0},
+    {0, 0, 0, 0, 0, 0}
+  };
+
+enum options
+  {
+    IOSTAT_SET
+  };
+
+struct iostat_ctx
+{
+  /* Only counters of this class, or all if NULL.  */
+  const char *class;
+  const char *last_class;
+  const char *last_object;
+  grub_err_t err;
+};
+
+static void
+print_counter (const char *class, const char *object, const char *counter,
+	       grub_uint64_t value, void *data)
+{
+  struct iostat_ctx *ctx = data;
+
+  if (ctx->class && grub_strcmp (ctx->class, class) != 0)
+    return;
+
+  if (!ctx->last_object || grub_strcmp (ctx->last_class, class) != 0
+      || grub_strcmp (ctx->last_object, object) != 0)
+    {
+      if (ctx->last_object)
+	grub_printf ("\n");
+      grub_printf ("%s %s:", class, object);
+      ctx->last_class = class;
+      ctx->last_object = object;
+    }
+  grub_printf (" %s=%" PRIuGRUB_UINT64_T, counter, value);
+}
+
+static void
+set_counter (const char *class, const char *object, const char *counter,
+	     grub_uint64_t value, void *data)
+{
+  struct iostat_ctx *ctx = data;
+  char buf[sizeof ("18446744073709551615")];
+  char *name, *p;
+
+  if (ctx->err || (ctx->class && grub_strcmp (ctx->class, class) != 0))
+    return;
+
+  name = grub_xasprintf ("iostat_%s_%s_%s", class, object, counter);
+  if (!name)
+    {
+      ctx->err = grub_errno;
+      return;
+    }
+  for (p = name; *p; p++)
+    if (!grub_isalnum (*p))
+      *p = '_';
+
+  grub_snprintf (buf, sizeof (buf), "%" PRIuGRUB_UINT64_T, value);
+  ctx->err = grub_env_set (name, buf);
+  grub_free (name);
+}
+
+static grub_err_t
+grub_cmd_iostat (grub_extcmd_context_t ctxt, int argc, char **args)
+{
+  struct grub_arg_list *state = ctxt->state;
+  struct iostat_ctx ctx = { .class = argc ? args[0] : NULL };
+  grub_iostat_emit_t emit = state[IOSTAT_SET].set ? set_counter
+    : print_counter;
+
+  if (argc > 1)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("one argument expected"));
+
+  grub_disk_iostat (emit, &ctx);
+  grub_file_iostat (emit, &ctx);
+  if (grub_net_iostat)
+    grub_net_iostat (emit, &ctx);
+
+  if (ctx.last_object)
+    grub_printf ("\n");
+  return ctx.err;
+}
+
+static grub_extcmd_t cmd;
+
+GRUB_MOD_INIT(iostat)
+{
+  cmd = grub_register_extcmd ("iostat", grub_cmd_iostat, 0,
+			      N_("[-s] [disk|file|net|netfile]"),
+			      N_("Show I/O counters of disks, files and "
+				 "network cards."), options);
+}
+
+GRUB_MOD_FINI(iostat)
+{
+  grub_unregister_extcmd (cmd);
+}
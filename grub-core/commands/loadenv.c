@@ -42,6 +42,36 @@ static const struct grub_arg_option options[] =
     {0, 0, 0, 0, 0, 0}
   };
 
+/* Return the name of the environment block file, FILENAME or the default
+   one, in allocated memory.  */
+static char *
+get_envblk_filename (const char *filename)
+{
+  const char *prefix;
+  char *buf;
+  int len;
+
+  if (filename)
+    return grub_strdup (filename);
+
+  prefix = grub_env_get ("prefix");
+  if (! prefix)
+    {
+      grub_error (GRUB_ERR_FILE_NOT_FOUND, N_("variable `%s' isn't set"), "prefix");
+      return 0;
+    }
+
+  len = grub_strlen (prefix);
+  buf = grub_malloc (len + 1 + sizeof (GRUB_ENVBLK_DEFCFG));
+  if (! buf)
+    return 0;
+
+  grub_strcpy (buf, prefix);
+  buf[len] = '/';
+  grub_strcpy (buf + len + 1, GRUB_ENVBLK_DEFCFG);
+  return buf;
+}
+
 /* Opens 'filename' with compression filters disabled. Optionally disables the
    PUBKEY filter (that insists upon properly signed files) as well.  PUBKEY
    filter is restored before the function returns. */
@@ -50,32 +80,13 @@ open_envblk_file (char *filename,
 		  enum grub_file_type type)
 {
   grub_file_t file;
-  char *buf = 0;
-
-  if (! filename)
-    {
-      const char *prefix;
-      int len;
-
-      prefix = grub_env_get ("prefix");
-      if (! prefix)
-        {
-          grub_error (GRUB_ERR_FILE_NOT_FOUND, N_("variable `%s' isn't set"), "prefix");
-          return 0;
-        }
-
-      len = grub_strlen (prefix);
-      buf = grub_malloc (len + 1 + sizeof (GRUB_ENVBLK_DEFCFG));
-      if (! buf)
-        return 0;
-      filename = buf;
+  char *buf;
 
-      grub_strcpy (filename, prefix);
-      filename[len] = '/';
-      grub_strcpy (filename + len + 1, GRUB_ENVBLK_DEFCFG);
-    }
+  buf = get_envblk_filename (filename);
+  if (! buf)
+    return 0;
 
-  file = grub_file_open (filename, type);
+  file = grub_file_open (buf, type);
 
   grub_free (buf);
   return file;
@@ -150,166 +161,182 @@ grub_cmd_list_env (grub_extcmd_context_t ctxt,
   return grub_errno;
 }
 
-/* Used to maintain a variable length of blocklists internally.  */
-struct blocklist
+/* Boot counting schemes call save_env on every boot, often several times.
+   Finding the sectors of the file goes through the filesystem, and checking
+   them reads the file twice, so the checked blocklists of the files saved
+   to are kept.  Nothing but save_env writes to files in GRUB, so they stay
+   valid until the next boot.  */
+struct envblk_location
 {
-  grub_disk_addr_t sector;
-  unsigned offset;
-  unsigned length;
-  struct blocklist *next;
+  struct envblk_location *next;
+  /* The file name as given and the device it was found on.  */
+  char *filename;
+  char *device;
+  grub_size_t size;
+  struct blocklist *blocklists;
 };
 
-static void
-free_blocklists (struct blocklist *p)
+static struct envblk_location *envblk_locations;
+
+/* The device FILENAME is on, in allocated memory.  */
+static char *
+get_envblk_device (const char *filename)
 {
-  struct blocklist *q;
+  char *device;
+  const char *root;
+
+  device = grub_file_get_device_name (filename);
+  if (device || grub_errno)
+    return device;
 
-  for (; p; p = q)
+  root = grub_env_get ("root");
+  if (! root)
     {
-      q = p->next;
-      grub_free (p);
+      grub_error (GRUB_ERR_BAD_DEVICE, N_("variable `%s' isn't set"), "root");
+      return 0;
     }
+  return grub_strdup (root);
 }
 
-static grub_err_t
-check_blocklists (grub_envblk_t envblk, struct blocklist *blocklists,
-                  grub_file_t file)
+static struct envblk_location *
+find_location (const char *filename, const char *device)
 {
-  grub_size_t total_length;
-  grub_size_t index;
-  grub_disk_t disk;
-  grub_disk_addr_t part_start;
-  struct blocklist *p;
-  char *buf;
+  struct envblk_location *loc;
 
-  /* Sanity checks.  */
-  total_length = 0;
-  for (p = blocklists; p; p = p->next)
-    {
-      struct blocklist *q;
-      /* Check if any pair of blocks overlap.  */
-      for (q = p->next; q; q = q->next)
-        {
-	  grub_disk_addr_t s1, s2;
-	  grub_disk_addr_t e1, e2;
+  for (loc = envblk_locations; loc; loc = loc->next)
+    if (grub_strcmp (loc->filename, filename) == 0
+	&& grub_strcmp (loc->device, device) == 0)
+      return loc;
+  return 0;
+}
 
-	  s1 = p->sector;
-	  e1 = s1 + ((p->length + GRUB_DISK_SECTOR_SIZE - 1) >> GRUB_DISK_SECTOR_BITS);
+static void
+free_location (struct envblk_location *loc)
+{
+  free_blocklists (loc->blocklists);
+  grub_free (loc->filename);
+  grub_free (loc->device);
+  grub_free (loc);
+}
 
-	  s2 = q->sector;
-	  e2 = s2 + ((q->length + GRUB_DISK_SECTOR_SIZE - 1) >> GRUB_DISK_SECTOR_BITS);
+static void
+forget_location (struct envblk_location *loc)
+{
+  struct envblk_location **prev;
+
+  for (prev = &envblk_locations; *prev; prev = &(*prev)->next)
+    if (*prev == loc)
+      {
+	*prev = loc->next;
+	free_location (loc);
+	return;
+      }
+}
 
-	  if (s1 < e2 && s2 < e1)
-            {
-              /* This might be actually valid, but it is unbelievable that
-                 any filesystem makes such a silly allocation.  */
-              return grub_error (GRUB_ERR_BAD_FS, "malformed file");
-            }
-        }
+/* Remember BLOCKLISTS, which are taken over on success.  */
+static struct envblk_location *
+remember_location (const char *filename, const char *device,
+		   grub_size_t size, struct blocklist *blocklists)
+{
+  struct envblk_location *loc;
 
-      total_length += p->length;
-    }
+  loc = grub_zalloc (sizeof (*loc));
+  if (! loc)
+    return 0;
 
-  if (total_length != grub_file_size (file))
+  loc->filename = grub_strdup (filename);
+  loc->device = grub_strdup (device);
+  if (! loc->filename || ! loc->device)
     {
-      /* Maybe sparse, unallocated sectors. No way in GRUB.  */
-      return grub_error (GRUB_ERR_BAD_FILE_TYPE, "sparse file not allowed");
+      free_location (loc);
+      return 0;
     }
+  loc->size = size;
+  loc->blocklists = blocklists;
+  loc->next = envblk_locations;
+  envblk_locations = loc;
+  return loc;
+}
 
-  /* One more sanity check. Re-read all sectors by blocklists, and compare
-     those with the data read via a file.  */
-  disk = file->device->disk;
-
-  part_start = grub_partition_get_start (disk->partition);
-
-  buf = grub_envblk_buffer (envblk);
-  char *blockbuf = NULL;
-  grub_size_t blockbuf_len = 0;
-  for (p = blocklists, index = 0; p; index += p->length, p = p->next)
-    {
-      if (p->length > blockbuf_len)
-	{
-	  grub_free (blockbuf);
-	  blockbuf_len = 2 * p->length;
-	  blockbuf = grub_malloc (blockbuf_len);
-	  if (!blockbuf)
-	    return grub_errno;
-	}
-
-      if (grub_disk_read (disk, p->sector - part_start,
-                          p->offset, p->length, blockbuf))
-        return grub_errno;
+/* Read the environment block straight from the sectors of LOC.  */
+static grub_envblk_t
+read_envblk_location (grub_disk_t disk, struct envblk_location *loc)
+{
+  grub_disk_addr_t part_start;
+  struct blocklist *p;
+  grub_size_t index;
+  grub_envblk_t envblk;
+  char *buf;
 
-      if (grub_memcmp (buf + index, blockbuf, p->length) != 0)
-	return grub_error (GRUB_ERR_FILE_READ_ERROR, "invalid blocklist");
-    }
+  buf = grub_malloc (loc->size);
+  if (! buf)
+    return 0;
 
-  return GRUB_ERR_NONE;
+  part_start = grub_partition_get_start (disk->partition);
+  for (p = loc->blocklists, index = 0; p; index += p->length, p = p->next)
+    if (grub_disk_read (disk, p->sector - part_start,
+			p->offset, p->length, buf + index))
+      {
+	grub_free (buf);
+	return 0;
+      }
+
+  envblk = grub_envblk_open (buf, loc->size);
+  if (! envblk)
+    grub_free (buf);
+  return envblk;
 }
 
-static int
-write_blocklists (grub_envblk_t envblk, struct blocklist *blocklists,
-                  grub_file_t file)
+/* Write the sectors of the environment block that differ from OLD.  */
+static grub_err_t
+write_blocklists (grub_envblk_t envblk, const char *old,
+		  struct blocklist *blocklists, grub_disk_t disk)
 {
   char *buf;
-  grub_disk_t disk;
   grub_disk_addr_t part_start;
   struct blocklist *p;
   grub_size_t index;
 
   buf = grub_envblk_buffer (envblk);
-  disk = file->device->disk;
   part_start = grub_partition_get_start (disk->partition);
 
   index = 0;
   for (p = blocklists; p; index += p->length, p = p->next)
     {
-      if (grub_disk_write (disk, p->sector - part_start,
-                           p->offset, p->length, buf + index))
-        return 0;
-    }
+      grub_disk_addr_t sector;
+      grub_size_t offset, done, len;
 
-  return 1;
-}
+      sector = p->sector - part_start + (p->offset >> GRUB_DISK_SECTOR_BITS);
+      offset = p->offset & (GRUB_DISK_SECTOR_SIZE - 1);
+      for (done = 0; done < p->length; done += len, sector++, offset = 0)
+	{
+	  len = GRUB_DISK_SECTOR_SIZE - offset;
+	  if (len > p->length - done)
+	    len = p->length - done;
 
-/* Context for grub_cmd_save_env.  */
-struct grub_cmd_save_env_ctx
-{
-  struct blocklist *head, *tail;
-};
+	  if (grub_memcmp (buf + index + done, old + index + done, len) == 0)
+	    continue;
 
-/* Store blocklists in a linked list.  */
-static void
-save_env_read_hook (grub_disk_addr_t sector, unsigned offset, unsigned length,
-		    void *data)
-{
-  struct grub_cmd_save_env_ctx *ctx = data;
-  struct blocklist *block;
-
-  block = grub_malloc (sizeof (*block));
-  if (! block)
-    return;
-
-  block->sector = sector;
-  block->offset = offset;
-  block->length = length;
-
-  /* Slightly complicated, because the list should be FIFO.  */
-  block->next = 0;
-  if (ctx->tail)
-    ctx->tail->next = block;
-  ctx->tail = block;
-  if (! ctx->head)
-    ctx->head = block;
+	  if (grub_disk_write (disk, sector, offset, len, buf + index + done))
+	    return grub_errno;
+	}
+    }
+
+  return GRUB_ERR_NONE;
 }
 
 static grub_err_t
 grub_cmd_save_env (grub_extcmd_context_t ctxt, int argc, char **args)
 {
   struct grub_arg_list *state = ctxt->state;
-  grub_file_t file;
-  grub_envblk_t envblk;
-  struct grub_cmd_save_env_ctx ctx = {
+  grub_file_t file = 0;
+  grub_device_t dev = 0;
+  grub_disk_t disk = 0;
+  grub_envblk_t envblk = 0;
+  struct envblk_location *loc;
+  struct blocklist *blocklists = 0;
+  char *filename, *device = 0, *old = 0;
+  struct blocklists_ctx ctx = {
     .head = 0,
     .tail = 0
   };
@@ -317,27 +344,69 @@ grub_cmd_save_env (grub_extcmd_context_t ctxt, int argc, char **args)
   if (! argc)
     return grub_error (GRUB_ERR_BAD_ARGUMENT, "no variable is specified");
 
-  file = open_envblk_file ((state[0].set) ? state[0].arg : 0,
-			   GRUB_FILE_TYPE_SAVEENV
-			   | GRUB_FILE_TYPE_SKIP_SIGNATURE);
-  if (! file)
+  filename = get_envblk_filename ((state[0].set) ? state[0].arg : 0);
+  if (! filename)
     return grub_errno;
 
-  if (! file->device->disk)
+  device = get_envblk_device (filename);
+  loc = device ? find_location (filename, device) : 0;
+  grub_errno = GRUB_ERR_NONE;
+  if (loc)
     {
-      grub_file_close (file);
-      return grub_error (GRUB_ERR_BAD_DEVICE, "disk device required");
+      dev = grub_device_open (loc->device);
+      if (dev && dev->disk)
+	envblk = read_envblk_location (dev->disk, loc);
+      if (envblk)
+	{
+	  disk = dev->disk;
+	  blocklists = loc->blocklists;
+	}
+      else
+	{
+	  /* Look for the file again.  */
+	  forget_location (loc);
+	  if (dev)
+	    grub_device_close (dev);
+	  dev = 0;
+	  grub_errno = GRUB_ERR_NONE;
+	}
     }
 
-  file->read_hook = save_env_read_hook;
-  file->read_hook_data = &ctx;
-  envblk = read_envblk_file (file);
-  file->read_hook = 0;
   if (! envblk)
-    goto fail;
+    {
+      file = grub_file_open (filename, GRUB_FILE_TYPE_SAVEENV
+			     | GRUB_FILE_TYPE_SKIP_SIGNATURE);
+      if (! file)
+	goto fail;
+
+      if (! file->device->disk)
+	{
+	  grub_error (GRUB_ERR_BAD_DEVICE, "disk device required");
+	  goto fail;
+	}
+
+      file->read_hook = blocklists_read_hook;
+      file->read_hook_data = &ctx;
+      envblk = read_envblk_file (file);
+      file->read_hook = 0;
+      if (! envblk)
+	goto fail;
+
+      if (check_blocklists (grub_envblk_buffer (envblk), ctx.head, file))
+	goto fail;
+
+      disk = file->device->disk;
+      blocklists = ctx.head;
+      if (device && remember_location (filename, device,
+				       grub_file_size (file), ctx.head))
+	ctx.head = 0;
+      grub_errno = GRUB_ERR_NONE;
+    }
 
-  if (check_blocklists (envblk, ctx.head, file))
+  old = grub_malloc (grub_envblk_size (envblk));
+  if (! old)
     goto fail;
+  grub_memcpy (old, grub_envblk_buffer (envblk), grub_envblk_size (envblk));
 
   while (argc)
     {
@@ -359,13 +428,19 @@ grub_cmd_save_env (grub_extcmd_context_t ctxt, int argc, char **args)
       args++;
     }
 
-  write_blocklists (envblk, ctx.head, file);
+  write_blocklists (envblk, old, blocklists, disk);
 
  fail:
   if (envblk)
     grub_envblk_close (envblk);
+  grub_free (old);
   free_blocklists (ctx.head);
-  grub_file_close (file);
+  if (file)
+    grub_file_close (file);
+  if (dev)
+    grub_device_close (dev);
+  grub_free (device);
+  grub_free (filename);
   return grub_errno;
 }
 
@@ -391,7 +466,15 @@ GRUB_MOD_INIT(loadenv)
 
 GRUB_MOD_FINI(loadenv)
 {
+  struct envblk_location *next;
+
   grub_unregister_extcmd (cmd_load);
   grub_unregister_extcmd (cmd_list);
   grub_unregister_extcmd (cmd_save);
+
+  for (; envblk_locations; envblk_locations = next)
+    {
+      next = envblk_locations->next;
+      free_location (envblk_locations);
+    }
 }
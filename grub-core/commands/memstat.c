@@ -0,0 +1,210 @@
+/* memstat.c - show which call sites use the heap.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/dl.h>
+#include <grub/extcmd.h>
+#include <grub/i18n.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+#define MEMSTAT_DEFAULT_SITES	20
+
+static const struct grub_arg_option options[] =
+  {
+    {"count", 'n', 0, N_("Show the first N sites (default 20, 0 for all)."),
+     N_("N"), ARG_TYPE_INT},
+    {"sort", 's', 0, N_("Sort by KEY: live (default), peak or allocs."),
+     N_("KEY"), ARG_TYPE_STRING},
+    {"histogram", 'H', 0, N_("Show the allocation sizes of every site."),
+     0, 0},
+    {0, 0, 0, 0, 0, 0}
+  };
+
+enum options
+  {
+    MEMSTAT_COUNT,
+    MEMSTAT_SORT,
+    MEMSTAT_HISTOGRAM
+  };
+
+enum sort_key
+  {
+    SORT_LIVE,
+    SORT_PEAK,
+    SORT_ALLOCS
+  };
+
+struct collect_ctx
+{
+  struct grub_mm_profile_site *sites;
+  grub_size_t count;
+  grub_size_t alloc;
+};
+
+static int
+count_site (const struct grub_mm_profile_site *site __attribute__ ((unused)),
+	    void *data)
+{
+  struct collect_ctx *ctx = data;
+
+  ctx->alloc++;
+  return 0;
+}
+
+static int
+copy_site (const struct grub_mm_profile_site *site, void *data)
+{
+  struct collect_ctx *ctx = data;
+
+  if (ctx->count == ctx->alloc)
+    return 1;
+  ctx->sites[ctx->count++] = *site;
+  return 0;
+}
+
+static grub_size_t
+site_key (const struct grub_mm_profile_site *site, enum sort_key key)
+{
+  switch (key)
+    {
+    case SORT_PEAK:
+      return site->peak;
+    case SORT_ALLOCS:
+      return site->allocs;
+    case SORT_LIVE:
+    default:
+      return site->live;
+    }
+}
+
+static void
+print_histogram (const struct grub_mm_profile_site *site)
+{
+  unsigned i;
+
+  grub_printf ("   ");
+  for (i = 0; i < GRUB_MM_PROFILE_BUCKETS; i++)
+    {
+      if (!site->sizes[i])
+	continue;
+      if (i < GRUB_MM_PROFILE_BUCKETS - 1)
+	grub_printf (" <%" PRIuGRUB_SIZE ":%lu",
+		     GRUB_MM_PROFILE_BUCKET_LIMIT (i), site->sizes[i]);
+      else
+	grub_printf (" >=%" PRIuGRUB_SIZE ":%lu",
+		     GRUB_MM_PROFILE_BUCKET_LIMIT (i - 1), site->sizes[i]);
+    }
+  grub_printf ("\n");
+}
+
+static grub_err_t
+grub_cmd_memstat (grub_extcmd_context_t ctxt, int argc,
+		  char **args __attribute__ ((unused)))
+{
+  struct grub_arg_list *state = ctxt->state;
+  struct collect_ctx ctx = { 0 };
+  enum sort_key key = SORT_LIVE;
+  grub_size_t show = MEMSTAT_DEFAULT_SITES, live, peak, i, j;
+  struct grub_mm_profile_site tmp, *site;
+
+  if (argc != 0)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("no argument expected"));
+
+  if (state[MEMSTAT_COUNT].set)
+    {
+      const char *end;
+
+      show = grub_strtoul (state[MEMSTAT_COUNT].arg, &end, 0);
+      if (grub_errno || *end)
+	return grub_error (GRUB_ERR_BAD_ARGUMENT,
+			   N_("invalid number of sites"));
+    }
+
+  if (state[MEMSTAT_SORT].set)
+    {
+      if (grub_strcmp (state[MEMSTAT_SORT].arg, "live") == 0)
+	key = SORT_LIVE;
+      else if (grub_strcmp (state[MEMSTAT_SORT].arg, "peak") == 0)
+	key = SORT_PEAK;
+      else if (grub_strcmp (state[MEMSTAT_SORT].arg, "allocs") == 0)
+	key = SORT_ALLOCS;
+      else
+	return grub_error (GRUB_ERR_BAD_ARGUMENT,
+			   N_("unknown sort key `%s'"),
+			   state[MEMSTAT_SORT].arg);
+    }
+
+  /* Every allocation may add a site and move the others, so work on a
+     copy.  Allocating it may itself add one, which is then left out.  */
+  grub_mm_profile_iterate (count_site, &ctx);
+  ctx.sites = grub_calloc (ctx.alloc + 1, sizeof (ctx.sites[0]));
+  if (!ctx.sites)
+    return grub_errno;
+  grub_mm_profile_iterate (copy_site, &ctx);
+
+  /* Insertion sort, largest first; there are at most a few thousand
+     sites.  */
+  for (i = 1; i < ctx.count; i++)
+    {
+      tmp = ctx.sites[i];
+      for (j = i; j > 0 && site_key (&ctx.sites[j - 1], key)
+	     < site_key (&tmp, key); j--)
+	ctx.sites[j] = ctx.sites[j - 1];
+      ctx.sites[j] = tmp;
+    }
+
+  grub_mm_profile_totals (&live, &peak);
+  grub_printf_ (N_("%" PRIuGRUB_SIZE " bytes live, %" PRIuGRUB_SIZE
+		   " at most, from %" PRIuGRUB_SIZE " call sites\n"),
+		live, peak, ctx.count);
+  grub_printf ("%12s %12s %10s %10s  %s\n", "live", "peak", "allocs",
+	       "frees", "site");
+
+  if (show == 0 || show > ctx.count)
+    show = ctx.count;
+  for (i = 0; i < show; i++)
+    {
+      site = &ctx.sites[i];
+      grub_printf ("%12" PRIuGRUB_SIZE " %12" PRIuGRUB_SIZE " %10lu %10lu  "
+		   "%s:%d\n", site->live, site->peak, site->allocs,
+		   site->frees, site->file, site->line);
+      if (state[MEMSTAT_HISTOGRAM].set)
+	print_histogram (site);
+    }
+
+  grub_free (ctx.sites);
+  return GRUB_ERR_NONE;
+}
+
+static grub_extcmd_t cmd;
+
+GRUB_MOD_INIT(memstat)
+{
+  cmd = grub_register_extcmd ("memstat", grub_cmd_memstat, 0,
+			      N_("[-n N] [-s live|peak|allocs] [-H]"),
+			      N_("Show the heap usage of allocation call "
+				 "sites."), options);
+}
+
+GRUB_MOD_FINI(memstat)
+{
+  grub_unregister_extcmd (cmd);
+}
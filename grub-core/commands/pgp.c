@@ -181,9 +181,16 @@ struct grub_public_subkey
   struct grub_public_subkey *next;
   grub_uint8_t type;
   grub_uint32_t fingerprint[5];
+  /* Low 64 bits of the fingerprint, as found in signature packets.  */
+  grub_uint64_t keyid;
+  /* Public key algorithm, index into pkalgos.  */
+  grub_uint8_t pkeyalgo;
   gcry_mpi_t mpis[10];
 };
 
+/* Subkey which verified the last signature against the trust database.  */
+static struct grub_public_subkey *last_trusted_sk;
+
 static void
 free_pk (struct grub_public_key *pk)
 {
@@ -350,6 +357,8 @@ grub_load_public_key (grub_file_t f)
       GRUB_MD_SHA1->final (fingerprint_context);
 
       grub_memcpy (sk->fingerprint, GRUB_MD_SHA1->read (fingerprint_context), 20);
+      grub_memcpy (&sk->keyid, sk->fingerprint + 3, sizeof (sk->keyid));
+      sk->pkeyalgo = pk;
 
       *last = sk;
       last = &sk->next;
@@ -372,7 +381,7 @@ grub_crypto_pk_locate_subkey (grub_uint64_t keyid, struct grub_public_key *pkey)
 {
   struct grub_public_subkey *sk;
   for (sk = pkey->subkeys; sk; sk = sk->next)
-    if (grub_memcmp (sk->fingerprint + 3, &keyid, 8) == 0)
+    if (sk->keyid == keyid)
       return sk;
   return 0;
 }
@@ -382,11 +391,19 @@ grub_crypto_pk_locate_subkey_in_trustdb (grub_uint64_t keyid)
 {
   struct grub_public_key *pkey;
   struct grub_public_subkey *sk;
+
+  /* Usually every file of a boot is signed with the same key.  */
+  if (last_trusted_sk && last_trusted_sk->keyid == keyid)
+    return last_trusted_sk;
+
   for (pkey = grub_pk_trusted; pkey; pkey = pkey->next)
     {
       sk = grub_crypto_pk_locate_subkey (keyid, pkey);
       if (sk)
-	return sk;
+	{
+	  last_trusted_sk = sk;
+	  return sk;
+	}
     }
   return 0;
 }
@@ -485,11 +502,23 @@ grub_pubkey_write (void *ctxt_, void *buf, grub_size_t size)
   return GRUB_ERR_NONE;
 }
 
+static void
+release_mpis (gcry_mpi_t *mpis, grub_size_t n, gcry_mpi_t hmpi)
+{
+  grub_size_t i;
+
+  for (i = 0; i < n; i++)
+    if (mpis[i])
+      gcry_mpi_release (mpis[i]);
+  if (hmpi)
+    gcry_mpi_release (hmpi);
+}
+
 static grub_err_t
 grub_verify_signature_real (struct grub_pubkey_context *ctxt,
 			    struct grub_public_key *pkey)
 {
-  gcry_mpi_t mpis[10];
+  gcry_mpi_t mpis[10] = { NULL };
   grub_uint8_t pk = ctxt->v4.pkeyalgo;
   grub_size_t i;
   grub_uint8_t *readbuf = NULL;
@@ -500,7 +529,7 @@ grub_verify_signature_real (struct grub_pubkey_context *ctxt,
   grub_uint16_t unhashed_sub;
   grub_ssize_t r;
   grub_uint8_t hash_start[2];
-  gcry_mpi_t hmpi;
+  gcry_mpi_t hmpi = NULL;
   grub_uint64_t keyid = 0;
   struct grub_public_subkey *sk;
 
@@ -610,6 +639,9 @@ grub_verify_signature_real (struct grub_pubkey_context *ctxt,
       goto fail;
     }
 
+  if (pkalgos[sk->pkeyalgo].algo != pkalgos[pk].algo)
+    goto fail;
+
   if (pkalgos[pk].pad (&hmpi, hval, ctxt->hash, sk))
     goto fail;
   if (!*pkalgos[pk].algo)
@@ -627,11 +659,13 @@ grub_verify_signature_real (struct grub_pubkey_context *ctxt,
   if ((*pkalgos[pk].algo)->verify (0, hmpi, mpis, sk->mpis, 0, 0))
     goto fail;
 
+  release_mpis (mpis, ARRAY_SIZE (mpis), hmpi);
   grub_free (readbuf);
 
   return GRUB_ERR_NONE;
 
  fail:
+  release_mpis (mpis, ARRAY_SIZE (mpis), hmpi);
   grub_free (readbuf);
   if (!grub_errno)
     return grub_error (GRUB_ERR_BAD_SIGNATURE, N_("bad signature"));
@@ -776,6 +810,7 @@ grub_cmd_distrust (grub_command_t cmd  __attribute__ ((unused)),
       if (!sk)
 	continue;
       next = (*pkey)->next;
+      last_trusted_sk = NULL;
       free_pk (*pkey);
       *pkey = next;
       return GRUB_ERR_NONE;
@@ -936,6 +971,7 @@ GRUB_MOD_INIT(pgp)
   grub_env_export ("check_signatures");
 
   grub_pk_trusted = 0;
+  last_trusted_sk = NULL;
   FOR_MODULES (header)
   {
     struct grub_file pseudo_file;
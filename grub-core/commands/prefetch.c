@@ -0,0 +1,888 @@
+/* prefetch.c - warm the disk cache with what the previous boot read.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The list lives in a preallocated file next to grubenv and is rewritten
+ * in place, like the environment block.  It holds lines of the form
+ *
+ *   fs DEVICE FSNAME UUID
+ *   file DEVICE MTIME PATH
+ *   extent DISK SECTOR COUNT
+ *
+ * and is padded with `#'.  Extents are in 512-byte sectors of the whole
+ * disk, sorted and merged.  Prefetching a stale extent only wastes time,
+ * as the cache is filled from the disk, so the checks are cheap: the
+ * extents of a disk are skipped when a filesystem on it has another UUID,
+ * or one of the recorded files on it has another mtime.  The filesystem's
+ * own mtime is left out: ext2 updates it on every mount, which would make
+ * every boot rewrite the list.
+ */
+
+#include <grub/dl.h>
+#include <grub/disk.h>
+#include <grub/env.h>
+#include <grub/err.h>
+#include <grub/extcmd.h>
+#include <grub/file.h>
+#include <grub/fs.h>
+#include <grub/i18n.h>
+#include <grub/loader.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+#include <grub/partition.h>
+#include <grub/lib/envblk.h>
+
+#include "loadenv.h"
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+/* Bigger reads are kernels and initrds, which are read efficiently anyway
+   and would only flush the cache.  */
+#define PREFETCH_MAX_READ	(1 << 20)
+/* Prefetch at most a quarter of the disk cache, in 512-byte sectors.  */
+#define PREFETCH_MAX_SECTORS	((GRUB_DISK_CACHE_NUM << GRUB_DISK_CACHE_BITS) / 4)
+/* Extents closer than this are read together.  */
+#define PREFETCH_MERGE_GAP	GRUB_DISK_CACHE_SIZE
+#define PREFETCH_CHUNK_SECTORS	2048
+#define PREFETCH_MAX_EXTENTS	8192
+#define PREFETCH_MAX_FILES	512
+#define PREFETCH_MAX_DISKS	16
+
+struct extent
+{
+  unsigned disk;
+  grub_disk_addr_t start;
+  grub_disk_addr_t end;
+};
+
+struct file_rec
+{
+  char *device;
+  char *path;
+};
+
+static char *disks[PREFETCH_MAX_DISKS];
+static unsigned ndisks;
+static struct extent *extents;
+static unsigned nextents;
+static struct file_rec *files;
+static unsigned nfiles;
+static int recording;
+
+/* Where the list was loaded from and its text, to skip rewriting it when
+   nothing changed.  */
+static char *list_name;
+static char *list_text;
+
+static grub_dl_t my_mod;
+
+static void
+free_recording (void)
+{
+  unsigned i;
+
+  for (i = 0; i < ndisks; i++)
+    grub_free (disks[i]);
+  for (i = 0; i < nfiles; i++)
+    {
+      grub_free (files[i].device);
+      grub_free (files[i].path);
+    }
+  grub_free (extents);
+  grub_free (files);
+  extents = NULL;
+  files = NULL;
+  ndisks = nextents = nfiles = 0;
+}
+
+static void
+record_read (grub_disk_t disk, grub_disk_addr_t sector, grub_off_t offset,
+	     grub_size_t size)
+{
+  grub_disk_addr_t start, end;
+  struct extent *last;
+  unsigned d;
+
+  if (size > PREFETCH_MAX_READ)
+    return;
+
+  for (d = 0; d < ndisks; d++)
+    if (grub_strcmp (disks[d], disk->name) == 0)
+      break;
+  if (d == ndisks)
+    {
+      if (ndisks == PREFETCH_MAX_DISKS)
+	return;
+      disks[d] = grub_strdup (disk->name);
+      if (!disks[d])
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  return;
+	}
+      ndisks++;
+    }
+
+  /* The cache works in whole blocks.  */
+  start = sector & ~((grub_disk_addr_t) GRUB_DISK_CACHE_SIZE - 1);
+  end = ALIGN_UP (sector + ((offset + size + GRUB_DISK_SECTOR_SIZE - 1)
+			    >> GRUB_DISK_SECTOR_BITS), GRUB_DISK_CACHE_SIZE);
+
+  /* Most reads continue the previous one.  */
+  last = nextents ? &extents[nextents - 1] : NULL;
+  if (last && last->disk == d && start <= last->end && end >= last->start)
+    {
+      if (start < last->start)
+	last->start = start;
+      if (end > last->end)
+	last->end = end;
+      return;
+    }
+
+  if (nextents == PREFETCH_MAX_EXTENTS)
+    return;
+  extents[nextents].disk = d;
+  extents[nextents].start = start;
+  extents[nextents].end = end;
+  nextents++;
+}
+
+/* Not a real filter: it only notes which files the boot opened.  */
+static grub_file_t
+record_file (grub_file_t file, enum grub_file_type type)
+{
+  const char *name = file->name, *end;
+  char *device, *path;
+  unsigned i;
+
+  if (!file->device->disk || file->fs == &grub_fs_blocklist
+      || (type & GRUB_FILE_TYPE_MASK) == GRUB_FILE_TYPE_PREFETCH_LIST
+      || nfiles == PREFETCH_MAX_FILES)
+    return file;
+
+  if (name[0] == '(' && (end = grub_strchr (name, ')')))
+    {
+      device = grub_strndup (name + 1, end - name - 1);
+      name = end + 1;
+    }
+  else
+    device = grub_strdup (grub_env_get ("root") ? : "");
+  path = grub_strdup (name);
+  if (!device || !path || path[0] != '/')
+    {
+      grub_free (device);
+      grub_free (path);
+      grub_errno = GRUB_ERR_NONE;
+      return file;
+    }
+
+  for (i = 0; i < nfiles; i++)
+    if (grub_strcmp (files[i].device, device) == 0
+	&& grub_strcmp (files[i].path, path) == 0)
+      {
+	grub_free (device);
+	grub_free (path);
+	return file;
+      }
+  files[nfiles].device = device;
+  files[nfiles].path = path;
+  nfiles++;
+  return file;
+}
+
+static grub_err_t
+start_recording (void)
+{
+  if (recording)
+    return GRUB_ERR_NONE;
+
+  free_recording ();
+  extents = grub_calloc (PREFETCH_MAX_EXTENTS, sizeof (*extents));
+  files = grub_calloc (PREFETCH_MAX_FILES, sizeof (*files));
+  if (!extents || !files)
+    {
+      free_recording ();
+      return grub_errno;
+    }
+
+  recording = 1;
+  grub_disk_read_notify = record_read;
+  grub_file_filter_register (GRUB_FILE_FILTER_PREFETCH, record_file);
+  grub_dl_ref (my_mod);
+  return GRUB_ERR_NONE;
+}
+
+static void
+stop_recording (void)
+{
+  if (!recording)
+    return;
+  recording = 0;
+  grub_disk_read_notify = NULL;
+  grub_file_filter_unregister (GRUB_FILE_FILTER_PREFETCH);
+  grub_dl_unref (my_mod);
+}
+
+struct mtime_ctx
+{
+  const char *basename;
+  grub_int64_t mtime;
+  int found;
+};
+
+static int
+mtime_hook (const char *filename, const struct grub_dirhook_info *info,
+	    void *data)
+{
+  struct mtime_ctx *ctx = data;
+
+  if ((info->case_insensitive ? grub_strcasecmp (filename, ctx->basename)
+       : grub_strcmp (filename, ctx->basename)) != 0)
+    return 0;
+  ctx->found = info->mtimeset;
+  ctx->mtime = info->mtime;
+  return 1;
+}
+
+/* Format the mtime of PATH, found with a single directory read, into BUF,
+   or "-" if it is unknown.  */
+static void
+file_mtime (grub_device_t dev, grub_fs_t fs, const char *path,
+	    char *buf, grub_size_t size)
+{
+  struct mtime_ctx ctx = { .found = 0 };
+  char *dir;
+
+  grub_strcpy (buf, "-");
+  ctx.basename = grub_strrchr (path, '/') + 1;
+  dir = grub_strndup (path, ctx.basename - path);
+  if (dir)
+    fs->fs_dir (dev, dir, mtime_hook, &ctx);
+  grub_free (dir);
+  grub_errno = GRUB_ERR_NONE;
+  if (ctx.found)
+    grub_snprintf (buf, size, "%" PRIdGRUB_INT64_T, ctx.mtime);
+}
+
+struct text
+{
+  char *buf;
+  grub_size_t len;
+  grub_size_t size;
+};
+
+/* Append LINE and free it.  On failure TEXT->buf becomes NULL.  */
+static void
+text_add (struct text *text, char *line)
+{
+  grub_size_t len;
+
+  if (!line || !text->buf)
+    goto fail;
+  len = grub_strlen (line);
+  if (text->len + len + 1 > text->size)
+    {
+      char *buf;
+
+      text->size = 2 * (text->len + len + 1);
+      buf = grub_realloc (text->buf, text->size);
+      if (!buf)
+	goto fail;
+      text->buf = buf;
+    }
+  grub_memcpy (text->buf + text->len, line, len + 1);
+  text->len += len;
+  grub_free (line);
+  return;
+
+ fail:
+  grub_free (line);
+  grub_free (text->buf);
+  text->buf = NULL;
+}
+
+static void
+add_file_lines (struct text *text)
+{
+  char mtime[32];
+  unsigned i, j;
+
+  for (i = 0; i < nfiles; i++)
+    {
+      grub_device_t dev;
+      grub_fs_t fs;
+      char *uuid = NULL;
+
+      for (j = 0; j < i; j++)
+	if (grub_strcmp (files[j].device, files[i].device) == 0)
+	  break;
+      if (j < i)
+	continue;
+
+      dev = grub_device_open (files[i].device);
+      fs = dev ? grub_fs_probe (dev) : NULL;
+      if (!fs)
+	{
+	  if (dev)
+	    grub_device_close (dev);
+	  grub_errno = GRUB_ERR_NONE;
+	  continue;
+	}
+
+      if (fs->fs_uuid)
+	fs->fs_uuid (dev, &uuid);
+      grub_errno = GRUB_ERR_NONE;
+      text_add (text, grub_xasprintf ("fs %s %s %s\n", files[i].device,
+				      fs->name, uuid ? : "-"));
+      grub_free (uuid);
+
+      for (j = i; j < nfiles; j++)
+	if (grub_strcmp (files[j].device, files[i].device) == 0)
+	  {
+	    file_mtime (dev, fs, files[j].path, mtime, sizeof (mtime));
+	    text_add (text, grub_xasprintf ("file %s %s %s\n", files[j].device,
+					    mtime, files[j].path));
+	  }
+      grub_device_close (dev);
+    }
+}
+
+static int
+extent_less (const struct extent *a, const struct extent *b)
+{
+  if (a->disk != b->disk)
+    return grub_strcmp (disks[a->disk], disks[b->disk]) < 0;
+  return a->start < b->start;
+}
+
+static void
+add_extent_lines (struct text *text)
+{
+  grub_disk_addr_t total = 0;
+  unsigned i, j, n = 0;
+
+  /* Insertion sort; the reads are mostly ascending already.  */
+  for (i = 1; i < nextents; i++)
+    {
+      struct extent e = extents[i];
+
+      for (j = i; j > 0 && extent_less (&e, &extents[j - 1]); j--)
+	extents[j] = extents[j - 1];
+      extents[j] = e;
+    }
+
+  for (i = 0; i < nextents; i++)
+    if (n && extents[n - 1].disk == extents[i].disk
+	&& extents[i].start <= extents[n - 1].end + PREFETCH_MERGE_GAP)
+      {
+	if (extents[i].end > extents[n - 1].end)
+	  extents[n - 1].end = extents[i].end;
+      }
+    else
+      extents[n++] = extents[i];
+
+  for (i = 0; i < n; i++)
+    {
+      total += extents[i].end - extents[i].start;
+      if (total > PREFETCH_MAX_SECTORS)
+	break;
+      text_add (text, grub_xasprintf ("extent %s %" PRIuGRUB_UINT64_T " %"
+				      PRIuGRUB_UINT64_T "\n",
+				      disks[extents[i].disk],
+				      extents[i].start,
+				      extents[i].end - extents[i].start));
+    }
+}
+
+static char *
+build_list (void)
+{
+  struct text text;
+
+  text.size = 4096;
+  text.len = 0;
+  text.buf = grub_malloc (text.size);
+  if (!text.buf)
+    return NULL;
+  text.buf[0] = '\0';
+
+  text_add (&text, grub_strdup ("# GRUB boot prefetch list\n"));
+  add_file_lines (&text);
+  add_extent_lines (&text);
+  return text.buf;
+}
+
+/* Overwrite NAME in place with TEXT, as save_env does with grubenv.  */
+static grub_err_t
+write_list (const char *name, const char *text)
+{
+  struct blocklists_ctx ctx = { .head = NULL, .tail = NULL };
+  struct blocklist *p;
+  grub_size_t size, len, index;
+  grub_disk_addr_t part_start;
+  grub_file_t file;
+  grub_fs_t fs;
+  char *buf = NULL;
+
+  file = grub_file_open (name, GRUB_FILE_TYPE_PREFETCH_LIST
+			 | GRUB_FILE_TYPE_SKIP_SIGNATURE
+			 | GRUB_FILE_TYPE_NO_DECOMPRESS);
+  if (!file)
+    return grub_errno;
+  if (!file->device->disk)
+    {
+      grub_error (GRUB_ERR_BAD_DEVICE, "disk device required");
+      goto out;
+    }
+
+  /* The sectors reported through a filter aren't those of the file.  */
+  fs = grub_fs_probe (file->device);
+  if (!fs)
+    goto out;
+  if (file->fs != fs)
+    {
+      grub_error (GRUB_ERR_BAD_FILE_TYPE, "prefetch list can't be written "
+		  "in place");
+      goto out;
+    }
+
+  size = grub_file_size (file);
+  len = grub_strlen (text);
+  if (len >= size)
+    {
+      grub_error (GRUB_ERR_OUT_OF_RANGE, "prefetch list too small");
+      goto out;
+    }
+
+  buf = grub_malloc (size);
+  if (!buf)
+    goto out;
+
+  file->read_hook = blocklists_read_hook;
+  file->read_hook_data = &ctx;
+  if (grub_file_read (file, buf, size) != (grub_ssize_t) size)
+    {
+      if (!grub_errno)
+	grub_error (GRUB_ERR_FILE_READ_ERROR, N_("premature end of file %s"),
+		    name);
+      goto out;
+    }
+  file->read_hook = NULL;
+
+  if (check_blocklists (buf, ctx.head, file))
+    goto out;
+
+  grub_memcpy (buf, text, len);
+  grub_memset (buf + len, '#', size - len - 1);
+  buf[size - 1] = '\n';
+
+  part_start = grub_partition_get_start (file->device->disk->partition);
+  for (p = ctx.head, index = 0; p; index += p->length, p = p->next)
+    if (grub_disk_write (file->device->disk, p->sector - part_start,
+			 p->offset, p->length, buf + index))
+      break;
+
+ out:
+  free_blocklists (ctx.head);
+  grub_free (buf);
+  grub_file_close (file);
+  return grub_errno;
+}
+
+static grub_err_t
+save_list (const char *name)
+{
+  char *text;
+  grub_err_t err;
+
+  if (!recording)
+    return GRUB_ERR_NONE;
+  stop_recording ();
+
+  text = build_list ();
+  free_recording ();
+  if (!text)
+    return grub_errno;
+
+  if (list_text && grub_strcmp (text, list_text) == 0)
+    {
+      grub_free (text);
+      return GRUB_ERR_NONE;
+    }
+
+  err = write_list (name, text);
+  grub_free (list_text);
+  list_text = err ? NULL : text;
+  if (err)
+    grub_free (text);
+  return err;
+}
+
+static char *
+read_list (const char *name)
+{
+  grub_file_t file;
+  grub_size_t size;
+  char *buf, *padding;
+
+  file = grub_file_open (name, GRUB_FILE_TYPE_PREFETCH_LIST
+			 | GRUB_FILE_TYPE_SKIP_SIGNATURE);
+  if (!file)
+    return NULL;
+
+  size = grub_file_size (file);
+  buf = grub_malloc (size + 1);
+  if (buf && grub_file_read (file, buf, size) != (grub_ssize_t) size)
+    {
+      if (!grub_errno)
+	grub_error (GRUB_ERR_FILE_READ_ERROR, N_("premature end of file %s"),
+		    name);
+      grub_free (buf);
+      buf = NULL;
+    }
+  grub_file_close (file);
+  if (!buf)
+    return NULL;
+  buf[size] = '\0';
+
+  /* Drop the padding, so the text compares equal to a rebuilt list.  */
+  padding = grub_strstr (buf, "\n#");
+  if (padding)
+    padding[1] = '\0';
+  return buf;
+}
+
+/* Split LINE in place into at most MAX words, the last one taking the
+   rest of the line.  */
+static int
+split_line (char *line, char **argv, int max)
+{
+  int argc = 0;
+
+  while (*line && argc < max)
+    {
+      argv[argc++] = line;
+      if (argc == max)
+	break;
+      while (*line && *line != ' ')
+	line++;
+      if (*line)
+	*line++ = '\0';
+    }
+  return argc;
+}
+
+struct list
+{
+  /* Words of the lines, pointing into BUF.  */
+  char *buf;
+  char *(*fs)[4];
+  unsigned nfs;
+  char *(*file)[4];
+  unsigned nfile;
+  char *(*extent)[4];
+  unsigned nextent;
+};
+
+static grub_err_t
+parse_list (const char *text, struct list *list)
+{
+  char *line, *next;
+  unsigned lines = 1;
+
+  list->buf = grub_strdup (text);
+  if (!list->buf)
+    return grub_errno;
+  for (line = list->buf; *line; line++)
+    if (*line == '\n')
+      lines++;
+  list->fs = grub_calloc (lines, sizeof (*list->fs));
+  list->file = grub_calloc (lines, sizeof (*list->file));
+  list->extent = grub_calloc (lines, sizeof (*list->extent));
+  if (!list->fs || !list->file || !list->extent)
+    return grub_errno;
+
+  for (line = list->buf; *line; line = next)
+    {
+      next = grub_strchr (line, '\n');
+      if (next)
+	*next++ = '\0';
+      else
+	next = line + grub_strlen (line);
+
+      if (grub_strncmp (line, "fs ", 3) == 0)
+	list->nfs += split_line (line, list->fs[list->nfs], 4) == 4;
+      else if (grub_strncmp (line, "file ", 5) == 0)
+	list->nfile += split_line (line, list->file[list->nfile], 4) == 4;
+      else if (grub_strncmp (line, "extent ", 7) == 0)
+	list->nextent += split_line (line, list->extent[list->nextent], 4) == 4;
+    }
+  return GRUB_ERR_NONE;
+}
+
+static void
+free_list (struct list *list)
+{
+  grub_free (list->buf);
+  grub_free (list->fs);
+  grub_free (list->file);
+  grub_free (list->extent);
+}
+
+/* Whether the extents on the disk of the filesystem FS_LINE can't be
+   trusted any more.  */
+static int
+fs_is_stale (const struct list *list, char **fs_line)
+{
+  const char *device = fs_line[1];
+  char mtime[32], *uuid = NULL;
+  grub_device_t dev;
+  grub_fs_t fs;
+  int stale = 1;
+  unsigned i;
+
+  dev = grub_device_open (device);
+  fs = dev ? grub_fs_probe (dev) : NULL;
+  if (!fs || grub_strcmp (fs->name, fs_line[2]) != 0)
+    goto out;
+
+  if (fs->fs_uuid)
+    fs->fs_uuid (dev, &uuid);
+  grub_errno = GRUB_ERR_NONE;
+  if (grub_strcmp (uuid ? : "-", fs_line[3]) != 0)
+    goto out;
+
+  for (i = 0; i < list->nfile; i++)
+    if (grub_strcmp (list->file[i][1], device) == 0)
+      {
+	file_mtime (dev, fs, list->file[i][3], mtime, sizeof (mtime));
+	if (grub_strcmp (mtime, "-") == 0
+	    || grub_strcmp (mtime, list->file[i][2]) != 0)
+	  goto out;
+      }
+  stale = 0;
+
+ out:
+  grub_free (uuid);
+  if (dev)
+    grub_device_close (dev);
+  grub_errno = GRUB_ERR_NONE;
+  return stale;
+}
+
+static int
+disk_is_stale (const struct list *list, const char *stale, const char *disk)
+{
+  grub_size_t len = grub_strlen (disk);
+  unsigned i;
+
+  for (i = 0; i < list->nfs; i++)
+    if (stale[i] && grub_strncmp (list->fs[i][1], disk, len) == 0
+	&& (list->fs[i][1][len] == '\0' || list->fs[i][1][len] == ','))
+      return 1;
+  return 0;
+}
+
+static grub_err_t
+load_list (const char *name)
+{
+  struct list list = { .buf = NULL };
+  grub_disk_addr_t total = 0;
+  grub_disk_t disk = NULL;
+  char *text, *stale = NULL, *buf = NULL;
+  unsigned i;
+
+  text = read_list (name);
+  if (!text)
+    return grub_errno;
+
+  if (parse_list (text, &list))
+    goto out;
+
+  stale = grub_zalloc (list.nfs + 1);
+  buf = grub_malloc (PREFETCH_CHUNK_SECTORS << GRUB_DISK_SECTOR_BITS);
+  if (!stale || !buf)
+    goto out;
+
+  for (i = 0; i < list.nfs; i++)
+    {
+      stale[i] = fs_is_stale (&list, list.fs[i]);
+      if (stale[i])
+	grub_dprintf ("prefetch", "%s changed, skipping its disk\n",
+		      list.fs[i][1]);
+    }
+
+  for (i = 0; i < list.nextent; i++)
+    {
+      const char *disk_name = list.extent[i][1];
+      grub_disk_addr_t sector, count, n;
+
+      sector = grub_strtoull (list.extent[i][2], NULL, 10);
+      count = grub_strtoull (list.extent[i][3], NULL, 10);
+      if (grub_errno || total + count > PREFETCH_MAX_SECTORS
+	  || disk_is_stale (&list, stale, disk_name))
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  continue;
+	}
+
+      if (!disk || grub_strcmp (disk->name, disk_name) != 0)
+	{
+	  if (disk)
+	    grub_disk_close (disk);
+	  disk = grub_disk_open (disk_name);
+	  if (!disk)
+	    {
+	      grub_errno = GRUB_ERR_NONE;
+	      continue;
+	    }
+	}
+
+      /* Reading through the cache is what fills it.  */
+      total += count;
+      for (; count; sector += n, count -= n)
+	{
+	  n = count < PREFETCH_CHUNK_SECTORS ? count : PREFETCH_CHUNK_SECTORS;
+	  if (grub_disk_read (disk, sector, 0, n << GRUB_DISK_SECTOR_BITS, buf))
+	    {
+	      grub_errno = GRUB_ERR_NONE;
+	      break;
+	    }
+	}
+    }
+  if (disk)
+    grub_disk_close (disk);
+  grub_dprintf ("prefetch", "prefetched %" PRIuGRUB_UINT64_T " sectors\n",
+		total);
+
+ out:
+  free_list (&list);
+  grub_free (stale);
+  grub_free (buf);
+  grub_free (list_text);
+  list_text = text;
+  return grub_errno;
+}
+
+static char *
+default_list_name (void)
+{
+  const char *prefix = grub_env_get ("prefix");
+
+  if (!prefix)
+    {
+      grub_error (GRUB_ERR_FILE_NOT_FOUND, N_("variable `%s' isn't set"),
+		  "prefix");
+      return NULL;
+    }
+  return grub_xasprintf ("%s/prefetch", prefix);
+}
+
+static grub_err_t
+grub_cmd_prefetch (grub_extcmd_context_t ctxt __attribute__ ((unused)),
+		   int argc, char **args)
+{
+  grub_err_t err;
+  char *name;
+
+  if (argc < 1 || argc > 2)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("one argument expected"));
+
+  if (grub_strcmp (args[0], "record") == 0)
+    return start_recording ();
+
+  if (argc == 2)
+    name = grub_strdup (args[1]);
+  else if (list_name)
+    name = grub_strdup (list_name);
+  else
+    name = default_list_name ();
+  if (!name)
+    return grub_errno;
+
+  if (grub_strcmp (args[0], "load") == 0)
+    {
+      err = load_list (name);
+      if (!err)
+	err = start_recording ();
+    }
+  else if (grub_strcmp (args[0], "save") == 0)
+    err = save_list (name);
+  else
+    {
+      grub_free (name);
+      return grub_error (GRUB_ERR_BAD_ARGUMENT,
+			 N_("unknown subcommand `%s'"), args[0]);
+    }
+
+  grub_free (list_name);
+  list_name = name;
+  return err;
+}
+
+/* Save the list on every boot, however `boot' was reached.  The hook runs
+   before the disk drivers shut down in theirs, and a failure to save must
+   not stop the boot.  */
+static grub_err_t
+prefetch_preboot (int flags __attribute__ ((unused)))
+{
+  char *name;
+
+  if (!recording)
+    return GRUB_ERR_NONE;
+
+  name = list_name ? grub_strdup (list_name) : default_list_name ();
+  if (name)
+    save_list (name);
+  grub_free (name);
+  grub_errno = GRUB_ERR_NONE;
+  return GRUB_ERR_NONE;
+}
+
+static grub_err_t
+prefetch_preboot_rest (void)
+{
+  return GRUB_ERR_NONE;
+}
+
+static grub_extcmd_t cmd;
+static struct grub_preboot *preboot_hnd;
+
+GRUB_MOD_INIT(prefetch)
+{
+  my_mod = mod;
+  cmd = grub_register_extcmd ("prefetch", grub_cmd_prefetch, 0,
+			      N_("load | record | save [FILE]"),
+			      N_("Prefetch the disk blocks the last boot read, "
+				 "or record and save them for the next one."),
+			      0);
+  preboot_hnd = grub_loader_register_preboot_hook (prefetch_preboot,
+						   prefetch_preboot_rest,
+						   GRUB_LOADER_PREBOOT_HOOK_PRIO_NORMAL);
+}
+
+GRUB_MOD_FINI(prefetch)
+{
+  if (preboot_hnd)
+    grub_loader_unregister_preboot_hook (preboot_hnd);
+  stop_recording ();
+  free_recording ();
+  grub_free (list_name);
+  grub_free (list_text);
+  grub_unregister_extcmd (cmd);
+}
@@ -0,0 +1,517 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/dl.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+#include <grub/extcmd.h>
+#include <grub/i18n.h>
+#include <grub/safemath.h>
+#ifdef GRUB_MACHINE_EMU
+#include <grub/emu/misc.h>
+#endif
+#ifdef GRUB_MACHINE_EFI
+#include <grub/loader.h>
+#include <grub/efi/api.h>
+#include <grub/efi/efi.h>
+#endif
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+#define PROFILE_DEFAULT_HZ	100
+#define PROFILE_DEFAULT_SAMPLES	65536
+#define PROFILE_DEFAULT_TOP	20
+
+static const struct grub_arg_option options[] =
+  {
+    {"frequency", 'f', 0, N_("Take HZ samples per second (default 100)."),
+     N_("HZ"), ARG_TYPE_INT},
+    {"samples", 's', 0, N_("Keep at most N samples (default 65536)."),
+     N_("N"), ARG_TYPE_INT},
+    {"top", 'n', 0, N_("Report the N busiest functions (default 20)."),
+     N_("N"), ARG_TYPE_INT},
+    {0, 0, 0, 0, 0, 0}
+  };
+
+enum options
+  {
+    PROFILE_FREQUENCY,
+    PROFILE_SAMPLES,
+    PROFILE_TOP
+  };
+
+struct profile_entry
+{
+  const char *name;
+  grub_dl_t mod;
+  grub_size_t count;
+};
+
+static grub_dl_t my_mod;
+
+/* Written from the timer context; everything else only reads them while
+   sampling is active.  */
+static void **samples;
+static grub_size_t max_samples;
+static volatile grub_size_t nsamples;
+static volatile grub_size_t dropped;
+static unsigned sample_hz;
+static int running;
+
+static void
+record_sample (void *pc)
+{
+  if (nsamples < max_samples)
+    samples[nsamples++] = pc;
+  else
+    dropped++;
+}
+
+#ifdef GRUB_MACHINE_EMU
+
+static grub_err_t
+profile_timer_start (unsigned hz)
+{
+  if (grub_util_profile_start (hz, record_sample) < 0)
+    return grub_error (GRUB_ERR_IO, N_("couldn't start the profiling timer"));
+  return GRUB_ERR_NONE;
+}
+
+static void
+profile_timer_stop (void)
+{
+  grub_util_profile_stop ();
+}
+
+#elif defined (GRUB_MACHINE_EFI)
+
+/* Firmware doesn't tell a timer notification what it interrupted, so the
+   notification scans its own stack for the program counter saved there by
+   the timer interrupt.  Only words pointing into the GRUB image or into
+   loaded modules are candidates.  */
+#define PROFILE_MAX_RANGES	256
+#define PROFILE_STACK_WORDS	512
+
+struct text_range
+{
+  grub_addr_t start;
+  grub_addr_t end;
+};
+
+static struct text_range ranges[PROFILE_MAX_RANGES];
+static unsigned nranges;
+static grub_addr_t ranges_low, ranges_high;
+static grub_efi_event_t timer_event;
+static struct grub_preboot *preboot;
+
+static void
+add_range (grub_addr_t start, grub_size_t size)
+{
+  if (nranges == PROFILE_MAX_RANGES || !size)
+    return;
+  ranges[nranges].start = start;
+  ranges[nranges].end = start + size;
+  if (start < ranges_low)
+    ranges_low = start;
+  if (start + size > ranges_high)
+    ranges_high = start + size;
+  nranges++;
+}
+
+/* Modules loaded after this point are not recognised until the next
+   start.  */
+static void
+collect_ranges (void)
+{
+  grub_efi_loaded_image_t *image;
+  grub_dl_t mod;
+
+  nranges = 0;
+  ranges_low = ~(grub_addr_t) 0;
+  ranges_high = 0;
+
+  image = grub_efi_get_loaded_image (grub_efi_image_handle);
+  if (image)
+    add_range ((grub_addr_t) image->image_base, image->image_size);
+
+  FOR_DL_MODULES (mod)
+    {
+      grub_dl_segment_t seg;
+
+      if (mod == my_mod)
+	continue;
+      for (seg = mod->segment; seg; seg = seg->next)
+	add_range ((grub_addr_t) seg->addr, seg->size);
+    }
+}
+
+static int
+in_grub_text (grub_addr_t addr)
+{
+  unsigned i;
+
+  if (addr < ranges_low || addr >= ranges_high)
+    return 0;
+  for (i = 0; i < nranges; i++)
+    if (addr >= ranges[i].start && addr < ranges[i].end)
+      return 1;
+  return 0;
+}
+
+static void *
+interrupted_pc (void)
+{
+  grub_addr_t *sp = __builtin_frame_address (0);
+  unsigned i;
+#if defined (__i386__) || defined (__x86_64__)
+  grub_uint16_t cs;
+
+  /* The CPU pushes the program counter followed by CS and the flags, with
+     IF and the always-set bit 1 set when interrupts could be taken.  */
+  asm volatile ("mov %%cs, %0" : "=r" (cs));
+  for (i = 0; i < PROFILE_STACK_WORDS - 2; i++)
+    if ((sp[i + 1] & 0xffff) == cs && (sp[i + 2] & 0x202) == 0x202
+	&& in_grub_text (sp[i]))
+      return (void *) sp[i];
+#else
+  for (i = 0; i < PROFILE_STACK_WORDS; i++)
+    if (in_grub_text (sp[i]))
+      return (void *) sp[i];
+#endif
+  return NULL;
+}
+
+/* Firmware calls this with the EFI calling convention.  */
+static void
+#ifdef __x86_64__
+__attribute__ ((ms_abi))
+#endif
+profile_tick (grub_efi_event_t event __attribute__ ((unused)),
+	      void *context __attribute__ ((unused)))
+{
+  record_sample (interrupted_pc ());
+}
+
+static void
+profile_timer_stop (void)
+{
+  grub_efi_boot_services_t *b = grub_efi_system_table->boot_services;
+
+  if (!timer_event)
+    return;
+
+  efi_call_3 (b->set_timer, timer_event, GRUB_EFI_TIMER_CANCEL, 0);
+  efi_call_1 (b->close_event, timer_event);
+  timer_event = NULL;
+  grub_loader_unregister_preboot_hook (preboot);
+  preboot = NULL;
+}
+
+/* The timer must not fire into freed memory once the OS takes over.  */
+static grub_err_t
+profile_preboot (int noreturn __attribute__ ((unused)))
+{
+  grub_efi_boot_services_t *b = grub_efi_system_table->boot_services;
+
+  if (timer_event)
+    efi_call_3 (b->set_timer, timer_event, GRUB_EFI_TIMER_CANCEL, 0);
+  return GRUB_ERR_NONE;
+}
+
+static grub_err_t
+profile_preboot_rest (void)
+{
+  grub_efi_boot_services_t *b = grub_efi_system_table->boot_services;
+
+  if (timer_event)
+    efi_call_3 (b->set_timer, timer_event, GRUB_EFI_TIMER_PERIODIC,
+		10000000 / sample_hz);
+  return GRUB_ERR_NONE;
+}
+
+static grub_err_t
+profile_timer_start (unsigned hz)
+{
+  grub_efi_boot_services_t *b = grub_efi_system_table->boot_services;
+  grub_efi_status_t status;
+
+  if (hz > 10000000)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT,
+		       N_("sampling frequency is too high"));
+
+  collect_ranges ();
+
+  status = efi_call_5 (b->create_event,
+		       GRUB_EFI_EVT_TIMER | GRUB_EFI_EVT_NOTIFY_SIGNAL,
+		       GRUB_EFI_TPL_NOTIFY, profile_tick, NULL, &timer_event);
+  if (status != GRUB_EFI_SUCCESS)
+    {
+      timer_event = NULL;
+      return grub_error (GRUB_ERR_IO,
+			 N_("couldn't start the profiling timer"));
+    }
+
+  preboot = grub_loader_register_preboot_hook (profile_preboot,
+					       profile_preboot_rest,
+					       GRUB_LOADER_PREBOOT_HOOK_PRIO_NORMAL);
+  if (!preboot)
+    {
+      efi_call_1 (b->close_event, timer_event);
+      timer_event = NULL;
+      return grub_errno;
+    }
+
+  status = efi_call_3 (b->set_timer, timer_event, GRUB_EFI_TIMER_PERIODIC,
+		       10000000 / hz);
+  if (status != GRUB_EFI_SUCCESS)
+    {
+      profile_timer_stop ();
+      return grub_error (GRUB_ERR_IO,
+			 N_("couldn't start the profiling timer"));
+    }
+  return GRUB_ERR_NONE;
+}
+
+#endif
+
+static void
+sort_samples (void **a, grub_size_t n)
+{
+  grub_size_t gap, i, j;
+
+  for (gap = n / 2; gap > 0; gap /= 2)
+    for (i = gap; i < n; i++)
+      {
+	void *v = a[i];
+
+	for (j = i; j >= gap && (grub_addr_t) a[j - gap] > (grub_addr_t) v;
+	     j -= gap)
+	  a[j] = a[j - gap];
+	a[j] = v;
+      }
+}
+
+static void
+print_entry (grub_size_t count, grub_size_t total, const char *name,
+	     const char *mod)
+{
+  grub_uint64_t permille = (grub_uint64_t) count * 1000 / total;
+
+  grub_printf ("%3u.%u%% %8" PRIuGRUB_SIZE "  %s%s%s%s\n",
+	       (unsigned) (permille / 10), (unsigned) (permille % 10),
+	       count, name, mod ? " [" : "", mod ? : "", mod ? "]" : "");
+}
+
+static grub_err_t
+profile_report (unsigned top)
+{
+  struct profile_entry *entries = NULL;
+  grub_size_t n = nsamples, nentries = 0, alloc = 0, unknown = 0, i, j;
+  const char *name = NULL;
+  grub_dl_t mod = NULL;
+  void *last = NULL;
+
+  if (!n)
+    {
+      grub_puts_ (N_("No profiling samples are available"));
+      return GRUB_ERR_NONE;
+    }
+
+  /* Samples past N may still be arriving, so only the first N are
+     reordered.  */
+  sort_samples (samples, n);
+
+  for (i = 0; i < n; i++)
+    {
+      if (i == 0 || samples[i] != last)
+	{
+	  last = samples[i];
+	  name = last ? grub_dl_addr_to_symbol (last, &mod, NULL) : NULL;
+	  if (name && (!nentries || entries[nentries - 1].name != name))
+	    {
+	      if (nentries == alloc)
+		{
+		  struct profile_entry *t;
+		  grub_size_t sz;
+
+		  alloc = alloc ? alloc * 2 : 64;
+		  if (grub_mul (alloc, sizeof (*entries), &sz))
+		    t = NULL;
+		  else
+		    t = grub_realloc (entries, sz);
+		  if (!t)
+		    {
+		      grub_free (entries);
+		      return grub_errno ? : grub_error (GRUB_ERR_OUT_OF_MEMORY,
+							N_("overflow is detected"));
+		    }
+		  entries = t;
+		}
+	      entries[nentries].name = name;
+	      entries[nentries].mod = mod;
+	      entries[nentries].count = 0;
+	      nentries++;
+	    }
+	}
+
+      if (name)
+	entries[nentries - 1].count++;
+      else
+	unknown++;
+    }
+
+  grub_printf ("%" PRIuGRUB_SIZE " samples at %u Hz, %" PRIuGRUB_SIZE
+	       " dropped\n", n, sample_hz, (grub_size_t) dropped);
+  grub_puts_ (N_("     %  samples  function"));
+
+  /* Selection of the busiest entries; TOP is small.  */
+  for (i = 0; i < top && i < nentries; i++)
+    {
+      grub_size_t best = i;
+      struct profile_entry t;
+
+      for (j = i + 1; j < nentries; j++)
+	if (entries[j].count > entries[best].count)
+	  best = j;
+      t = entries[i];
+      entries[i] = entries[best];
+      entries[best] = t;
+      print_entry (entries[i].count, n, entries[i].name,
+		   entries[i].mod ? entries[i].mod->name : NULL);
+    }
+
+  if (unknown)
+#ifdef GRUB_MACHINE_EFI
+    print_entry (unknown, n, "(firmware)", NULL);
+#else
+    print_entry (unknown, n, "(unknown)", NULL);
+#endif
+
+  grub_free (entries);
+  return GRUB_ERR_NONE;
+}
+
+static void
+profile_stop (void)
+{
+  if (!running)
+    return;
+  profile_timer_stop ();
+  running = 0;
+  grub_dl_unref (my_mod);
+}
+
+static grub_err_t
+grub_cmd_profile (grub_extcmd_context_t ctxt, int argc, char **args)
+{
+  struct grub_arg_list *state = ctxt->state;
+  const char *end;
+
+  if (argc != 1)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("one argument expected"));
+
+  if (grub_strcmp (args[0], "start") == 0)
+    {
+      unsigned long hz = PROFILE_DEFAULT_HZ;
+      unsigned long count = PROFILE_DEFAULT_SAMPLES;
+      grub_size_t sz;
+      grub_err_t err;
+
+      if (state[PROFILE_FREQUENCY].set)
+	{
+	  hz = grub_strtoul (state[PROFILE_FREQUENCY].arg, &end, 0);
+	  if (grub_errno || *end || !hz)
+	    return grub_error (GRUB_ERR_BAD_ARGUMENT,
+			       N_("invalid sampling frequency"));
+	}
+      if (state[PROFILE_SAMPLES].set)
+	{
+	  count = grub_strtoul (state[PROFILE_SAMPLES].arg, &end, 0);
+	  if (grub_errno || *end || !count)
+	    return grub_error (GRUB_ERR_BAD_ARGUMENT,
+			       N_("invalid sample count"));
+	}
+
+      profile_stop ();
+
+      if (count != max_samples)
+	{
+	  grub_free (samples);
+	  max_samples = 0;
+	  if (grub_mul (count, sizeof (*samples), &sz))
+	    return grub_error (GRUB_ERR_OUT_OF_RANGE,
+			       N_("overflow is detected"));
+	  samples = grub_malloc (sz);
+	  if (!samples)
+	    return grub_errno;
+	  max_samples = count;
+	}
+      nsamples = 0;
+      dropped = 0;
+      sample_hz = hz;
+
+      err = profile_timer_start (hz);
+      if (err)
+	return err;
+      running = 1;
+      /* The timer calls into this module.  */
+      grub_dl_ref (my_mod);
+      return GRUB_ERR_NONE;
+    }
+
+  if (grub_strcmp (args[0], "stop") == 0)
+    {
+      profile_stop ();
+      return GRUB_ERR_NONE;
+    }
+
+  if (grub_strcmp (args[0], "report") == 0)
+    {
+      unsigned long top = PROFILE_DEFAULT_TOP;
+
+      if (state[PROFILE_TOP].set)
+	{
+	  top = grub_strtoul (state[PROFILE_TOP].arg, &end, 0);
+	  if (grub_errno || *end)
+	    return grub_error (GRUB_ERR_BAD_ARGUMENT,
+			       N_("invalid number of functions"));
+	}
+      return profile_report (top);
+    }
+
+  return grub_error (GRUB_ERR_BAD_ARGUMENT,
+		     N_("unknown profile command `%s'"), args[0]);
+}
+
+static grub_extcmd_t cmd;
+
+GRUB_MOD_INIT(profile)
+{
+  my_mod = mod;
+  cmd = grub_register_extcmd ("profile", grub_cmd_profile, 0,
+			      N_("[-f HZ] [-s N] start | stop | [-n N] report"),
+			      N_("Sample where GRUB spends CPU time."),
+			      options);
+}
+
+GRUB_MOD_FINI(profile)
+{
+  profile_stop ();
+  grub_free (samples);
+  grub_unregister_extcmd (cmd);
+}
@@ -27,6 +27,8 @@
 #include <grub/script_sh.h>
 #include <regex.h>
 
+#include "wildcard.h"
+
 GRUB_MOD_LICENSE ("GPLv3+");
 
 static const struct grub_arg_option options[] =
@@ -165,4 +167,5 @@ GRUB_MOD_FINI(regexp)
 {
   grub_unregister_extcmd (cmd);
   grub_wildcard_translator = 0;
+  grub_wildcard_fini ();
 }
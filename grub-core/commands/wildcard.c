@@ -27,15 +27,39 @@
 
 #include <regex.h>
 
+#include "wildcard.h"
+
+/* A compiled path component.  Globs made of literal characters, `*' and
+   `?' only, which is nearly all of them, are matched directly: the pattern
+   is split at its stars into segments, the first anchored at the start of
+   the name and the last at its end.  Anything else is handed to a regex
+   from a small cache.  */
+struct wildcard_matcher
+{
+  /* The regex equivalent to the pattern.  */
+  char *source;
+  /* Only valid until the next regex_cache_get.  */
+  const regex_t *regexp;
+  /* The unescaped segments back to back, with '\0' standing for `?'.  */
+  char *chars;
+  grub_size_t *seglen;
+  unsigned nsegs;
+  /* Whether the pattern has a `?', which matches a byte here but a whole
+     UTF-8 character in the regex.  */
+  int any;
+};
+
 static inline int isregexop (char ch);
 static char ** merge (char **lhs, char **rhs);
 static char *make_dir (const char *prefix, const char *start, const char *end);
-static int make_regex (const char *regex_start, const char *regex_end,
-		       regex_t *regexp);
+static int make_matcher (const char *regex_start, const char *regex_end,
+			 struct wildcard_matcher *matcher);
+static void free_matcher (struct wildcard_matcher *matcher);
 static void split_path (const char *path, const char **suffix_end, const char **regex_end);
-static char ** match_devices (const regex_t *regexp, int noparts);
+static char ** match_devices (struct wildcard_matcher *matcher, int noparts);
 static char ** match_files (const char *prefix, const char *suffix_start,
-			    const char *suffix_end, const regex_t *regexp);
+			    const char *suffix_end,
+			    struct wildcard_matcher *matcher);
 
 static grub_err_t wildcard_expand (const char *s, char ***strs);
 
@@ -116,8 +140,8 @@ make_dir (const char *prefix, const char *start, const char *end)
   return result;
 }
 
-static int
-make_regex (const char *start, const char *end, regex_t *regexp)
+static char *
+make_regex_source (const char *start, const char *end)
 {
   char ch;
   int i = 0;
@@ -128,11 +152,11 @@ make_regex (const char *start, const char *end, regex_t *regexp)
   /* Worst case size is (len * 2 + 2 + 1). */
   if (grub_mul (len, 2, &sz) ||
       grub_add (sz, 3, &sz))
-    return 1;
+    return NULL;
 
   buffer = grub_malloc (sz);
   if (! buffer)
-    return 1;
+    return NULL;
 
   buffer[i++] = '^';
   while (start < end)
@@ -177,16 +201,230 @@ make_regex (const char *start, const char *end, regex_t *regexp)
   buffer[i] = '\0';
   grub_dprintf ("expand", "Regexp is %s\n", buffer);
 
-  if (regcomp (regexp, buffer, RE_SYNTAX_GNU_AWK))
+  return buffer;
+}
+
+/* The same few patterns come up again and again in generated configs, so
+   the compiled regexes of the last ones are kept, the least recently used
+   one making room for a new one.  */
+#define REGEX_CACHE_SIZE 8
+
+struct regex_cache_entry
+{
+  char *source;
+  regex_t regexp;
+  unsigned long last_use;
+};
+
+static struct regex_cache_entry regex_cache[REGEX_CACHE_SIZE];
+static unsigned long regex_cache_clock;
+
+static const regex_t *
+regex_cache_get (const char *source)
+{
+  struct regex_cache_entry *entry, *victim = &regex_cache[0];
+  unsigned i;
+
+  for (i = 0; i < REGEX_CACHE_SIZE; i++)
     {
-      grub_free (buffer);
-      return 1;
+      entry = &regex_cache[i];
+      if (entry->source && grub_strcmp (entry->source, source) == 0)
+	{
+	  entry->last_use = ++regex_cache_clock;
+	  return &entry->regexp;
+	}
+      if (!victim->source)
+	continue;
+      if (!entry->source || entry->last_use < victim->last_use)
+	victim = entry;
     }
 
-  grub_free (buffer);
+  if (victim->source)
+    {
+      regfree (&victim->regexp);
+      grub_free (victim->source);
+      victim->source = NULL;
+    }
+
+  if (regcomp (&victim->regexp, source, RE_SYNTAX_GNU_AWK))
+    return NULL;
+  victim->source = grub_strdup (source);
+  if (!victim->source)
+    {
+      regfree (&victim->regexp);
+      return NULL;
+    }
+  victim->last_use = ++regex_cache_clock;
+  return &victim->regexp;
+}
+
+void
+grub_wildcard_fini (void)
+{
+  unsigned i;
+
+  for (i = 0; i < REGEX_CACHE_SIZE; i++)
+    if (regex_cache[i].source)
+      {
+	regfree (&regex_cache[i].regexp);
+	grub_free (regex_cache[i].source);
+	regex_cache[i].source = NULL;
+      }
+}
+
+/* Whether `\CH' stands for CH itself in the regex; GNU regex gives a
+   meaning to some escaped letters and symbols.  */
+static int
+is_literal_escape (char ch)
+{
+  return ch != '\0' && ! grub_isalnum (ch) && ! grub_strchr ("<>`'", ch);
+}
+
+static int
+make_matcher (const char *start, const char *end,
+	      struct wildcard_matcher *matcher)
+{
+  const char *p;
+  grub_size_t n = 0;
+  unsigned seg = 0;
+  int simple = 1;
+
+  grub_memset (matcher, 0, sizeof (*matcher));
+  matcher->source = make_regex_source (start, end);
+  if (! matcher->source)
+    return 1;
+
+  matcher->nsegs = 1;
+  for (p = start; p < end; p++)
+    if (*p == '\\')
+      {
+	if (p + 1 == end || ! is_literal_escape (p[1]))
+	  simple = 0;
+	p++;
+      }
+    else if (*p == '^' || *p == '$')
+      simple = 0;
+    else if (*p == '*')
+      matcher->nsegs++;
+
+  if (! simple)
+    {
+      matcher->regexp = regex_cache_get (matcher->source);
+      return matcher->regexp ? 0 : 1;
+    }
+
+  matcher->chars = grub_malloc (end - start);
+  matcher->seglen = grub_calloc (matcher->nsegs, sizeof (matcher->seglen[0]));
+  if (! matcher->chars || ! matcher->seglen)
+    return 1;
+
+  for (p = start; p < end; p++)
+    {
+      if (*p == '*')
+	{
+	  seg++;
+	  continue;
+	}
+      if (*p == '\\')
+	matcher->chars[n++] = *++p;
+      else if (*p == '?')
+	{
+	  matcher->chars[n++] = '\0';
+	  matcher->any = 1;
+	}
+      else
+	matcher->chars[n++] = *p;
+      matcher->seglen[seg]++;
+    }
+
+  return 0;
+}
+
+static void
+free_matcher (struct wildcard_matcher *matcher)
+{
+  grub_free (matcher->source);
+  grub_free (matcher->chars);
+  grub_free (matcher->seglen);
+  grub_memset (matcher, 0, sizeof (*matcher));
+}
+
+static int
+match_segment (const char *seg, grub_size_t len, const char *name)
+{
+  grub_size_t i;
+
+  for (i = 0; i < len; i++)
+    if (seg[i] ? seg[i] != name[i] : name[i] == '\0')
+      return 0;
+  return 1;
+}
+
+/* Whether NAME has a byte that isn't ASCII.  */
+static int
+has_non_ascii (const char *name)
+{
+  for (; *name; name++)
+    if ((grub_uint8_t) *name >= 0x80)
+      return 1;
   return 0;
 }
 
+/* Return non-zero if NAME matches.  */
+static int
+matcher_match (struct wildcard_matcher *matcher, const char *name)
+{
+  const char *seg, *pos, *last;
+  grub_size_t len, first_len, last_len;
+  unsigned i;
+
+  /* The wildcards of the regex don't match newlines, and its `.' takes a
+     whole UTF-8 character; leave such rare names to it.  */
+  if (! matcher->regexp && (grub_strchr (name, '\n')
+			    || (matcher->any && has_non_ascii (name))))
+    {
+      matcher->regexp = regex_cache_get (matcher->source);
+      if (! matcher->regexp)
+	return 0;
+    }
+  if (matcher->regexp)
+    return regexec (matcher->regexp, name, 0, 0, 0) == 0;
+
+  len = grub_strlen (name);
+  first_len = matcher->seglen[0];
+  if (matcher->nsegs == 1)
+    return len == first_len && match_segment (matcher->chars, len, name);
+
+  last_len = matcher->seglen[matcher->nsegs - 1];
+  if (len < first_len + last_len
+      || ! match_segment (matcher->chars, first_len, name))
+    return 0;
+
+  /* The segments up to the last one can't overlap it.  */
+  last = name + len - last_len;
+  for (i = 0, seg = matcher->chars; i < matcher->nsegs - 1; i++)
+    seg += matcher->seglen[i];
+  if (! match_segment (seg, last_len, last))
+    return 0;
+
+  /* Stars in between: take the leftmost match of every segment.  */
+  pos = name + first_len;
+  seg = matcher->chars + first_len;
+  for (i = 1; i < matcher->nsegs - 1; i++)
+    {
+      grub_size_t seg_len = matcher->seglen[i];
+
+      while (pos + seg_len <= last && ! match_segment (seg, seg_len, pos))
+	pos++;
+      if (pos + seg_len > last)
+	return 0;
+      pos += seg_len;
+      seg += seg_len;
+    }
+
+  return 1;
+}
+
 /* Split `str' into two parts: (1) dirname that is regexop free (2)
    dirname that has a regexop.  */
 static void
@@ -227,7 +465,7 @@ split_path (const char *str, const char **noregexop, const char **regexop)
 /* Context for match_devices.  */
 struct match_devices_ctx
 {
-  const regex_t *regexp;
+  struct wildcard_matcher *matcher;
   int noparts;
   int ndev;
   char **devs;
@@ -251,7 +489,7 @@ match_devices_iter (const char *name, void *data)
     return 1;
 
   grub_dprintf ("expand", "matching: %s\n", buffer);
-  if (regexec (ctx->regexp, buffer, 0, 0, 0))
+  if (! matcher_match (ctx->matcher, buffer))
     {
       grub_dprintf ("expand", "not matched\n");
  fail:
@@ -277,10 +515,10 @@ match_devices_iter (const char *name, void *data)
 }
 
 static char **
-match_devices (const regex_t *regexp, int noparts)
+match_devices (struct wildcard_matcher *matcher, int noparts)
 {
   struct match_devices_ctx ctx = {
-    .regexp = regexp,
+    .matcher = matcher,
     .noparts = noparts,
     .ndev = 0,
     .devs = 0
@@ -305,7 +543,7 @@ match_devices (const regex_t *regexp, int noparts)
 /* Context for match_files.  */
 struct match_files_ctx
 {
-  const regex_t *regexp;
+  struct wildcard_matcher *matcher;
   char **files;
   unsigned nfile;
   char *dir;
@@ -327,7 +565,7 @@ match_files_iter (const char *name,
     return 0;
 
   grub_dprintf ("expand", "matching: %s in %s\n", name, ctx->dir);
-  if (regexec (ctx->regexp, name, 0, 0, 0))
+  if (! matcher_match (ctx->matcher, name))
     return 0;
 
   grub_dprintf ("expand", "matched\n");
@@ -356,10 +594,10 @@ match_files_iter (const char *name,
 
 static char **
 match_files (const char *prefix, const char *suffix, const char *end,
-	     const regex_t *regexp)
+	     struct wildcard_matcher *matcher)
 {
   struct match_files_ctx ctx = {
-    .regexp = regexp,
+    .matcher = matcher,
     .nfile = 0,
     .files = 0
   };
@@ -533,7 +771,7 @@ wildcard_expand (const char *s, char ***strs)
   int had_regexp = 0;
 
   unsigned i;
-  regex_t regexp;
+  struct wildcard_matcher matcher = { 0 };
 
   *strs = 0;
   if (s[0] != '/' && s[0] != '(' && s[0] != '*')
@@ -610,7 +848,7 @@ wildcard_expand (const char *s, char ***strs)
 	  continue;
 	}
 
-      if (make_regex (noregexop, regexop, &regexp))
+      if (make_matcher (noregexop, regexop, &matcher))
 	goto fail;
 
       had_regexp = 1;
@@ -618,10 +856,10 @@ wildcard_expand (const char *s, char ***strs)
       if (paths == 0)
 	{
 	  if (start == noregexop) /* device part has regexop */
-	    paths = match_devices (&regexp, *start != '(');
+	    paths = match_devices (&matcher, *start != '(');
 
 	  else  /* device part explicit wo regexop */
-	    paths = match_files ("", start, noregexop, &regexp);
+	    paths = match_files ("", start, noregexop, &matcher);
 	}
       else
 	{
@@ -631,7 +869,7 @@ wildcard_expand (const char *s, char ***strs)
 	    {
 	      char **p;
 
-	      p = match_files (paths[i], start, noregexop, &regexp);
+	      p = match_files (paths[i], start, noregexop, &matcher);
 	      grub_free (paths[i]);
 	      if (! p)
 		continue;
@@ -644,7 +882,7 @@ wildcard_expand (const char *s, char ***strs)
 	  paths = r;
 	}
 
-      regfree (&regexp);
+      free_matcher (&matcher);
       if (! paths)
 	goto done;
 
@@ -661,6 +899,6 @@ wildcard_expand (const char *s, char ***strs)
   for (i = 0; paths && paths[i]; i++)
     grub_free (paths[i]);
   grub_free (paths);
-  regfree (&regexp);
+  free_matcher (&matcher);
   return grub_errno;
 }
@@ -30,6 +30,11 @@ GRUB_MOD_LICENSE ("GPLv2+");
 gcry_err_code_t AF_merge (const gcry_md_spec_t * hash, grub_uint8_t * src,
 			  grub_uint8_t * dst, grub_size_t blocksize,
 			  grub_size_t blocknumbers);
+gcry_err_code_t AF_merge_update (const gcry_md_spec_t * hash,
+				 grub_uint8_t * bufblock,
+				 const grub_uint8_t * src, grub_uint8_t * dst,
+				 grub_size_t blocksize, grub_size_t first,
+				 grub_size_t nstripes, grub_size_t blocknumbers);
 
 static void
 diffuse (const gcry_md_spec_t * hash, grub_uint8_t * src,
@@ -66,30 +71,57 @@ diffuse (const gcry_md_spec_t * hash, grub_uint8_t * src,
 }
 
 /**
- * Merges the splitted master key stored on disk into the original key
+ * Merges NSTRIPES stripes from SRC, starting with stripe FIRST of
+ * BLOCKNUMBERS, so that the key material can be merged as it is read.
+ * BUFBLOCK holds the state between calls and must be zeroed before the
+ * first one.  Once the last stripe is merged, the key is stored to DST.
  */
 gcry_err_code_t
-AF_merge (const gcry_md_spec_t * hash, grub_uint8_t * src, grub_uint8_t * dst,
-	  grub_size_t blocksize, grub_size_t blocknumbers)
+AF_merge_update (const gcry_md_spec_t * hash, grub_uint8_t * bufblock,
+		 const grub_uint8_t * src, grub_uint8_t * dst,
+		 grub_size_t blocksize, grub_size_t first,
+		 grub_size_t nstripes, grub_size_t blocknumbers)
 {
   grub_size_t i;
-  grub_uint8_t *bufblock;
 
   if (hash->mdlen > GRUB_CRYPTO_MAX_MDLEN || hash->mdlen == 0)
     return GPG_ERR_INV_ARG;
 
-  bufblock = grub_zalloc (blocksize);
-  if (bufblock == NULL)
-    return GPG_ERR_OUT_OF_MEMORY;
+  if (blocknumbers == 0 || first >= blocknumbers
+      || nstripes > blocknumbers - first)
+    return GPG_ERR_INV_ARG;
 
-  grub_memset (bufblock, 0, blocksize);
-  for (i = 0; i < blocknumbers - 1; i++)
+  for (i = first; i < first + nstripes; i++, src += blocksize)
     {
-      grub_crypto_xor (bufblock, src + (blocksize * i), bufblock, blocksize);
+      if (i == blocknumbers - 1)
+	{
+	  grub_crypto_xor (dst, src, bufblock, blocksize);
+	  break;
+	}
+      grub_crypto_xor (bufblock, src, bufblock, blocksize);
       diffuse (hash, bufblock, bufblock, blocksize);
     }
-  grub_crypto_xor (dst, src + (i * blocksize), bufblock, blocksize);
 
-  grub_free (bufblock);
   return GPG_ERR_NO_ERROR;
 }
+
+/**
+ * Merges the splitted master key stored on disk into the original key
+ */
+gcry_err_code_t
+AF_merge (const gcry_md_spec_t * hash, grub_uint8_t * src, grub_uint8_t * dst,
+	  grub_size_t blocksize, grub_size_t blocknumbers)
+{
+  grub_uint8_t *bufblock;
+  gcry_err_code_t err;
+
+  bufblock = grub_zalloc (blocksize);
+  if (bufblock == NULL)
+    return GPG_ERR_OUT_OF_MEMORY;
+
+  err = AF_merge_update (hash, bufblock, src, dst, blocksize, 0,
+			 blocknumbers, blocknumbers);
+
+  grub_free (bufblock);
+  return err;
+}
@@ -26,6 +26,7 @@
 #include <grub/file.h>
 #include <grub/procfs.h>
 #include <grub/partition.h>
+#include <grub/env.h>
 
 #ifdef GRUB_UTIL
 #include <grub/emu/hostdisk.h>
@@ -714,6 +715,9 @@ grub_cryptodisk_open (const char *name, grub_disk_t disk)
       dev->source_disk = grub_disk_open (dev->source);
       if (!dev->source_disk)
 	return grub_errno;
+      /* Only the plaintext is worth caching: it is cached by the disk cache
+	 under this device's id, so don't keep the ciphertext too.  */
+      dev->source_disk->nocache = 1;
     }
 
   disk->data = dev;
@@ -782,6 +786,8 @@ grub_cryptodisk_read (grub_disk_t disk, grub_disk_addr_t sector,
       grub_dprintf ("cryptodisk", "grub_disk_read failed with error %d\n", err);
       return err;
     }
+  dev->stat_reads++;
+  dev->stat_sectors += size;
   gcry_err = grub_cryptodisk_endecrypt (dev, (grub_uint8_t *) buf,
 					size << disk->log_sector_size,
 					sector, dev->log_sector_size, 0);
@@ -913,6 +919,62 @@ grub_cryptodisk_get_by_uuid (const char *uuid)
   return NULL;
 }
 
+/*
+ * The keyslot which last unlocked a device is kept in the environment
+ * variable cryptodisk_keyslot_<uuid>, so that it can be persisted with
+ * save_env and tried first on the next boot.
+ */
+static char *
+last_keyslot_varname (grub_cryptodisk_t dev)
+{
+  return grub_xasprintf ("cryptodisk_keyslot_%s", dev->uuid);
+}
+
+int
+grub_cryptodisk_get_last_keyslot (grub_cryptodisk_t dev)
+{
+  const char *val, *end;
+  char *name;
+  unsigned long slot;
+
+  name = last_keyslot_varname (dev);
+  if (!name)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return -1;
+    }
+  val = grub_env_get (name);
+  grub_free (name);
+  if (!val)
+    return -1;
+
+  slot = grub_strtoul (val, &end, 10);
+  if (grub_errno != GRUB_ERR_NONE || *end != '\0' || slot > GRUB_INT_MAX)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return -1;
+    }
+  return slot;
+}
+
+void
+grub_cryptodisk_set_last_keyslot (grub_cryptodisk_t dev, grub_uint64_t slot)
+{
+  char *name;
+  char val[21];
+
+  name = last_keyslot_varname (dev);
+  if (!name)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+  grub_snprintf (val, sizeof (val), "%" PRIuGRUB_UINT64_T, slot);
+  grub_env_set (name, val);
+  grub_free (name);
+  grub_errno = GRUB_ERR_NONE;
+}
+
 grub_cryptodisk_t
 grub_cryptodisk_get_by_source_disk (grub_disk_t disk)
 {
@@ -1311,6 +1373,43 @@ struct grub_procfs_entry luks_script =
   .get_contents = luks_script_get
 };
 
+static char *
+cryptodisk_stats_get (grub_size_t *sz)
+{
+  grub_cryptodisk_t i;
+  grub_size_t size = 0;
+  char *ptr, *ret;
+
+  *sz = 0;
+
+  for (i = cryptodisk_list; i != NULL; i = i->next)
+    size += sizeof ("crypto reads= sectors=\n") + 3 * 20;
+
+  ret = grub_malloc (size + 1);
+  if (!ret)
+    return 0;
+
+  ptr = ret;
+  for (i = cryptodisk_list; i != NULL; i = i->next)
+    {
+      grub_snprintf (ptr, size + 1 - (ptr - ret),
+		     "crypto%lu reads=%" PRIuGRUB_UINT64_T
+		     " sectors=%" PRIuGRUB_UINT64_T "\n",
+		     i->id, i->stat_reads, i->stat_sectors);
+      while (*ptr)
+	ptr++;
+    }
+  *ptr = '\0';
+  *sz = ptr - ret;
+  return ret;
+}
+
+struct grub_procfs_entry cryptodisk_stats =
+{
+  .name = "cryptodisk_stats",
+  .get_contents = cryptodisk_stats_get
+};
+
 static grub_extcmd_t cmd;
 
 GRUB_MOD_INIT (cryptodisk)
@@ -1320,6 +1419,7 @@ GRUB_MOD_INIT (cryptodisk)
 			      N_("SOURCE|-u UUID|-a|-b"),
 			      N_("Mount a crypto device."), options);
   grub_procfs_register ("luks_script", &luks_script);
+  grub_procfs_register ("cryptodisk_stats", &cryptodisk_stats);
 }
 
 GRUB_MOD_FINI (cryptodisk)
@@ -1328,4 +1428,5 @@ GRUB_MOD_FINI (cryptodisk)
   cryptodisk_cleanup ();
   grub_unregister_extcmd (cmd);
   grub_procfs_unregister (&luks_script);
+  grub_procfs_unregister (&cryptodisk_stats);
 }
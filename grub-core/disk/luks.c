@@ -26,6 +26,8 @@
 #include <grub/crypto.h>
 #include <grub/partition.h>
 #include <grub/i18n.h>
+#include <grub/time.h>
+#include <grub/safemath.h>
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -60,9 +62,11 @@ struct grub_luks_phdr
 
 typedef struct grub_luks_phdr *grub_luks_phdr_t;
 
-gcry_err_code_t AF_merge (const gcry_md_spec_t * hash, grub_uint8_t * src,
-			  grub_uint8_t * dst, grub_size_t blocksize,
-			  grub_size_t blocknumbers);
+gcry_err_code_t AF_merge_update (const gcry_md_spec_t * hash,
+				 grub_uint8_t * bufblock,
+				 const grub_uint8_t * src, grub_uint8_t * dst,
+				 grub_size_t blocksize, grub_size_t first,
+				 grub_size_t nstripes, grub_size_t blocknumbers);
 
 static grub_cryptodisk_t
 configure_ciphers (grub_disk_t disk, const char *check_uuid,
@@ -150,6 +154,60 @@ configure_ciphers (grub_disk_t disk, const char *check_uuid,
   return newdev;
 }
 
+/*
+ * Read, decrypt and merge the key material of a keyslot a chunk at a time,
+ * so that large stripe counts don't need a buffer for the whole key area.
+ * CHUNK must hold KEYSIZE sectors, which is a whole number of stripes.
+ */
+static grub_err_t
+luks_merge_key_material (grub_disk_t source, grub_cryptodisk_t dev,
+			 grub_disk_addr_t start, grub_size_t keysize,
+			 grub_size_t stripes, grub_uint8_t *chunk,
+			 grub_uint8_t *af_block, grub_uint8_t *candidate_key)
+{
+  grub_size_t chunk_size = keysize << GRUB_LUKS1_LOG_SECTOR_SIZE;
+  grub_size_t length, offset, stripe, nstripes;
+  gcry_err_code_t gcry_err;
+  grub_err_t err;
+
+  if (stripes == 0 || grub_mul (keysize, stripes, &length))
+    return grub_error (GRUB_ERR_BAD_FS, "invalid number of stripes");
+
+  grub_memset (af_block, 0, keysize);
+
+  for (offset = 0, stripe = 0; stripe < stripes;
+       offset += chunk_size, stripe += nstripes)
+    {
+      grub_size_t len = ALIGN_UP (length - offset,
+				  1 << GRUB_LUKS1_LOG_SECTOR_SIZE);
+
+      if (len > chunk_size)
+	len = chunk_size;
+      nstripes = chunk_size / keysize;
+      if (nstripes > stripes - stripe)
+	nstripes = stripes - stripe;
+
+      err = grub_disk_read (source,
+			    start + (offset >> GRUB_LUKS1_LOG_SECTOR_SIZE), 0,
+			    len, chunk);
+      if (err)
+	return err;
+
+      gcry_err = grub_cryptodisk_decrypt (dev, chunk, len,
+					  offset >> GRUB_LUKS1_LOG_SECTOR_SIZE,
+					  GRUB_LUKS1_LOG_SECTOR_SIZE);
+      if (gcry_err)
+	return grub_crypto_gcry_error (gcry_err);
+
+      gcry_err = AF_merge_update (dev->hash, af_block, chunk, candidate_key,
+				  keysize, stripe, nstripes, stripes);
+      if (gcry_err)
+	return grub_crypto_gcry_error (gcry_err);
+    }
+
+  return GRUB_ERR_NONE;
+}
+
 static grub_err_t
 luks_recover_key (grub_disk_t source,
 		  grub_cryptodisk_t dev)
@@ -157,12 +215,13 @@ luks_recover_key (grub_disk_t source,
   struct grub_luks_phdr header;
   grub_size_t keysize;
   grub_uint8_t *split_key = NULL;
+  grub_uint8_t af_block[GRUB_CRYPTODISK_MAX_KEYLEN];
   char passphrase[MAX_PASSPHRASE] = "";
   grub_uint8_t candidate_digest[sizeof (header.mkDigest)];
-  unsigned i;
-  grub_size_t length;
+  unsigned order[ARRAY_SIZE (header.keyblock)];
+  unsigned i, n;
+  int last;
   grub_err_t err;
-  grub_size_t max_stripes = 1;
   char *tmp;
 
   err = grub_disk_read (source, 0, 0, sizeof (header), &header);
@@ -173,13 +232,10 @@ luks_recover_key (grub_disk_t source,
   keysize = grub_be_to_cpu32 (header.keyBytes);
   if (keysize > GRUB_CRYPTODISK_MAX_KEYLEN)
     return grub_error (GRUB_ERR_BAD_FS, "key is too long");
+  if (keysize == 0)
+    return grub_error (GRUB_ERR_BAD_FS, "key is too short");
 
-  for (i = 0; i < ARRAY_SIZE (header.keyblock); i++)
-    if (grub_be_to_cpu32 (header.keyblock[i].active) == LUKS_KEY_ENABLED
-	&& grub_be_to_cpu32 (header.keyblock[i].stripes) > max_stripes)
-      max_stripes = grub_be_to_cpu32 (header.keyblock[i].stripes);
-
-  split_key = grub_calloc (keysize, max_stripes);
+  split_key = grub_malloc (keysize << GRUB_LUKS1_LOG_SECTOR_SIZE);
   if (!split_key)
     return grub_errno;
 
@@ -197,12 +253,24 @@ luks_recover_key (grub_disk_t source,
       return grub_error (GRUB_ERR_BAD_ARGUMENT, "Passphrase not supplied");
     }
 
-  /* Try to recover master key from each active keyslot.  */
+  /* Try the keyslot that opened the volume last time first.  */
+  last = grub_cryptodisk_get_last_keyslot (dev);
+  n = 0;
+  if (last >= 0 && (unsigned) last < ARRAY_SIZE (header.keyblock))
+    order[n++] = last;
   for (i = 0; i < ARRAY_SIZE (header.keyblock); i++)
+    if ((int) i != last)
+      order[n++] = i;
+
+  /* Try to recover master key from each active keyslot.  */
+  for (n = 0; n < ARRAY_SIZE (header.keyblock); n++)
     {
       gcry_err_code_t gcry_err;
       grub_uint8_t candidate_key[GRUB_CRYPTODISK_MAX_KEYLEN];
       grub_uint8_t digest[GRUB_CRYPTODISK_MAX_KEYLEN];
+      grub_uint64_t start, elapsed;
+
+      i = order[n];
 
       /* Check if keyslot is enabled.  */
       if (grub_be_to_cpu32 (header.keyblock[i].active) != LUKS_KEY_ENABLED)
@@ -211,6 +279,7 @@ luks_recover_key (grub_disk_t source,
       grub_dprintf ("luks", "Trying keyslot %d\n", i);
 
       /* Calculate the PBKDF2 of the user supplied passphrase.  */
+      start = grub_get_time_ms ();
       gcry_err = grub_crypto_pbkdf2 (dev->hash, (grub_uint8_t *) passphrase,
 				     grub_strlen (passphrase),
 				     header.keyblock[i].passwordSalt,
@@ -225,7 +294,11 @@ luks_recover_key (grub_disk_t source,
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
-      grub_dprintf ("luks", "PBKDF2 done\n");
+      elapsed = grub_get_time_ms () - start;
+      grub_dprintf ("luks", "PBKDF2 done in %" PRIuGRUB_UINT64_T " ms (%"
+		    PRIuGRUB_UINT64_T " iterations/s)\n", elapsed,
+		    grub_divmod64 (grub_be_to_cpu32 (header.keyblock[i].passwordIterations)
+				   * 1000ULL, elapsed ? : 1, NULL));
 
       gcry_err = grub_cryptodisk_setkey (dev, digest, keysize); 
       if (gcry_err)
@@ -234,36 +307,18 @@ luks_recover_key (grub_disk_t source,
 	  return grub_crypto_gcry_error (gcry_err);
 	}
 
-      length = (keysize * grub_be_to_cpu32 (header.keyblock[i].stripes));
-
-      /* Read and decrypt the key material from the disk.  */
-      err = grub_disk_read (source,
-			    grub_be_to_cpu32 (header.keyblock
-					      [i].keyMaterialOffset), 0,
-			    length, split_key);
+      /* Read, decrypt and merge the key material from the disk.  */
+      err = luks_merge_key_material (source, dev,
+				     grub_be_to_cpu32 (header.keyblock[i].keyMaterialOffset),
+				     keysize,
+				     grub_be_to_cpu32 (header.keyblock[i].stripes),
+				     split_key, af_block, candidate_key);
       if (err)
 	{
 	  grub_free (split_key);
 	  return err;
 	}
 
-      gcry_err = grub_cryptodisk_decrypt (dev, split_key, length, 0,
-					  GRUB_LUKS1_LOG_SECTOR_SIZE);
-      if (gcry_err)
-	{
-	  grub_free (split_key);
-	  return grub_crypto_gcry_error (gcry_err);
-	}
-
-      /* Merge the decrypted key material to get the candidate master key.  */
-      gcry_err = AF_merge (dev->hash, split_key, candidate_key, keysize,
-			   grub_be_to_cpu32 (header.keyblock[i].stripes));
-      if (gcry_err)
-	{
-	  grub_free (split_key);
-	  return grub_crypto_gcry_error (gcry_err);
-	}
-
       grub_dprintf ("luks", "candidate key recovered\n");
 
       /* Calculate the PBKDF2 of the candidate master key.  */
@@ -293,6 +348,7 @@ luks_recover_key (grub_disk_t source,
       /* TRANSLATORS: It's a cryptographic key slot: one element of an array
 	 where each element is either empty or holds a key.  */
       grub_printf_ (N_("Slot %d opened\n"), i);
+      grub_cryptodisk_set_last_keyslot (dev, i);
 
       /* Set the master key.  */
       gcry_err = grub_cryptodisk_setkey (dev, candidate_key, keysize); 
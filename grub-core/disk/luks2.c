@@ -26,6 +26,8 @@
 #include <grub/crypto.h>
 #include <grub/partition.h>
 #include <grub/i18n.h>
+#include <grub/time.h>
+#include <grub/safemath.h>
 
 #include <base64.h>
 #include <json.h>
@@ -37,6 +39,12 @@ GRUB_MOD_LICENSE ("GPLv3+");
 
 #define MAX_PASSPHRASE 256
 
+/*
+ * Keyslot priorities are 0 (ignore), 1 (normal) and 2 (prefer). The keyslot
+ * which opened the volume last time ranks above all of them.
+ */
+#define LUKS2_PRIORITY_LAST_USED 3
+
 enum grub_luks2_kdf_type
 {
   LUKS2_KDF_TYPE_ARGON2I,
@@ -126,9 +134,11 @@ struct grub_luks2_digest
 };
 typedef struct grub_luks2_digest grub_luks2_digest_t;
 
-gcry_err_code_t AF_merge (const gcry_md_spec_t * hash, grub_uint8_t * src,
-			  grub_uint8_t * dst, grub_size_t blocksize,
-			  grub_size_t blocknumbers);
+gcry_err_code_t AF_merge_update (const gcry_md_spec_t * hash,
+				 grub_uint8_t * bufblock,
+				 const grub_uint8_t * src, grub_uint8_t * dst,
+				 grub_size_t blocksize, grub_size_t first,
+				 grub_size_t nstripes, grub_size_t blocknumbers);
 
 static grub_err_t
 luks2_parse_keyslot (grub_luks2_keyslot_t *out, const grub_json_t *keyslot)
@@ -427,12 +437,14 @@ luks2_decrypt_key (grub_uint8_t *out_key,
 {
   grub_uint8_t area_key[GRUB_CRYPTODISK_MAX_KEYLEN];
   grub_uint8_t salt[GRUB_CRYPTODISK_MAX_KEYLEN];
-  grub_uint8_t *split_key = NULL;
+  grub_uint8_t *split_key = NULL, *af_block = NULL;
+  grub_size_t af_size, chunk_size = 0, offset, stripe, nstripes;
   idx_t saltlen = sizeof (salt);
   char cipher[32], *p;
   const gcry_md_spec_t *hash;
   gcry_err_code_t gcry_ret;
   grub_err_t ret;
+  grub_uint64_t start, elapsed;
 
   if (!base64_decode (k->kdf.salt, grub_strlen (k->kdf.salt),
 		     (char *)salt, &saltlen))
@@ -456,6 +468,7 @@ luks2_decrypt_key (grub_uint8_t *out_key,
 	    goto err;
 	  }
 
+	start = grub_get_time_ms ();
 	gcry_ret = grub_crypto_pbkdf2 (hash, (grub_uint8_t *) passphrase,
 				       passphraselen,
 				       salt, saltlen,
@@ -467,6 +480,14 @@ luks2_decrypt_key (grub_uint8_t *out_key,
 	    goto err;
 	  }
 
+	/* Let admins size keyslot iteration counts for GRUB's speed.  */
+	elapsed = grub_get_time_ms () - start;
+	grub_dprintf ("luks2", "PBKDF2 with %" PRIdGRUB_INT64_T " iterations took %"
+		      PRIuGRUB_UINT64_T " ms (%" PRIuGRUB_UINT64_T " iterations/s)\n",
+		      k->kdf.u.pbkdf2.iterations, elapsed,
+		      grub_divmod64 (k->kdf.u.pbkdf2.iterations * 1000ULL,
+				     elapsed ? : 1, NULL));
+
 	break;
     }
 
@@ -488,58 +509,151 @@ luks2_decrypt_key (grub_uint8_t *out_key,
       goto err;
     }
 
- /* Read and decrypt the binary key area with the area key. */
-  split_key = grub_malloc (k->area.size);
-  if (!split_key)
+  /* Configure the hash used for anti-forensic merging. */
+  hash = grub_crypto_lookup_md_by_name (k->af.hash);
+  if (!hash)
     {
-      ret = grub_errno;
+      ret = grub_error (GRUB_ERR_FILE_NOT_FOUND, "Couldn't load %s hash",
+			k->af.hash);
       goto err;
     }
 
-  grub_errno = GRUB_ERR_NONE;
-  ret = grub_disk_read (source, 0, k->area.offset, k->area.size, split_key);
-  if (ret)
+  if (k->key_size <= 0 || k->key_size > GRUB_CRYPTODISK_MAX_KEYLEN
+      || k->af.stripes <= 0
+      || grub_mul ((grub_size_t) k->key_size, (grub_size_t) k->af.stripes,
+		   &af_size)
+      || af_size > k->area.size)
     {
-      grub_error (GRUB_ERR_IO, "Read error: %s\n", grub_errmsg);
+      ret = grub_error (GRUB_ERR_BAD_ARGUMENT, "Invalid key area size");
       goto err;
     }
 
   /*
-   * The key slots area is always encrypted in 512-byte sectors,
-   * regardless of encrypted data sector size.
+   * Read, decrypt and merge the key material a chunk at a time, so large
+   * stripe counts don't need a buffer the size of the whole key area. A
+   * chunk holds a whole number of both stripes and sectors.
    */
-  gcry_ret = grub_cryptodisk_decrypt (crypt, split_key, k->area.size, 0,
-				      GRUB_LUKS1_LOG_SECTOR_SIZE);
-  if (gcry_ret)
+  chunk_size = k->key_size << GRUB_LUKS1_LOG_SECTOR_SIZE;
+  split_key = grub_malloc (chunk_size);
+  af_block = grub_zalloc (k->key_size);
+  if (!split_key || !af_block)
     {
-      ret = grub_crypto_gcry_error (gcry_ret);
+      ret = grub_errno;
       goto err;
     }
 
-  /* Configure the hash used for anti-forensic merging. */
-  hash = grub_crypto_lookup_md_by_name (k->af.hash);
-  if (!hash)
+  for (offset = 0, stripe = 0; stripe < (grub_size_t) k->af.stripes;
+       offset += chunk_size, stripe += nstripes)
     {
-      ret = grub_error (GRUB_ERR_FILE_NOT_FOUND, "Couldn't load %s hash",
-			k->af.hash);
-      goto err;
-    }
+      grub_size_t len = ALIGN_UP (af_size - offset,
+				  1 << GRUB_LUKS1_LOG_SECTOR_SIZE);
 
-  /* Merge the decrypted key material to get the candidate master key. */
-  gcry_ret = AF_merge (hash, split_key, out_key, k->key_size, k->af.stripes);
-  if (gcry_ret)
-    {
-      ret = grub_crypto_gcry_error (gcry_ret);
-      goto err;
+      if (len > chunk_size)
+	len = chunk_size;
+      nstripes = chunk_size / k->key_size;
+      if (nstripes > k->af.stripes - stripe)
+	nstripes = k->af.stripes - stripe;
+
+      grub_errno = GRUB_ERR_NONE;
+      ret = grub_disk_read (source, 0, k->area.offset + offset, len, split_key);
+      if (ret)
+	{
+	  grub_error (GRUB_ERR_IO, "Read error: %s\n", grub_errmsg);
+	  goto err;
+	}
+
+      /*
+       * The key slots area is always encrypted in 512-byte sectors,
+       * regardless of encrypted data sector size.
+       */
+      gcry_ret = grub_cryptodisk_decrypt (crypt, split_key, len,
+					  offset >> GRUB_LUKS1_LOG_SECTOR_SIZE,
+					  GRUB_LUKS1_LOG_SECTOR_SIZE);
+      if (gcry_ret)
+	{
+	  ret = grub_crypto_gcry_error (gcry_ret);
+	  goto err;
+	}
+
+      /* Merge the decrypted key material into the candidate master key. */
+      gcry_ret = AF_merge_update (hash, af_block, split_key, out_key,
+				  k->key_size, stripe, nstripes, k->af.stripes);
+      if (gcry_ret)
+	{
+	  ret = grub_crypto_gcry_error (gcry_ret);
+	  goto err;
+	}
     }
 
   grub_dprintf ("luks2", "Candidate key recovered\n");
 
  err:
+  if (split_key)
+    grub_memset (split_key, 0, chunk_size);
+  if (af_block)
+    grub_memset (af_block, 0, k->key_size);
   grub_free (split_key);
+  grub_free (af_block);
   return ret;
 }
 
+/*
+ * Work out the order in which to try the keyslots: the one that opened the
+ * volume last time first, then by descending priority, otherwise in the order
+ * they are stored. Keyslots that fail to parse are left for the caller to
+ * report.
+ */
+static grub_err_t
+luks2_order_keyslots (grub_size_t **out, const grub_json_t *root,
+		      grub_size_t size, int last_keyslot)
+{
+  grub_json_t keyslots, keyslot;
+  grub_size_t *order, i, j;
+  grub_int64_t *rank, r;
+  grub_uint64_t idx;
+
+  if (grub_json_getvalue (&keyslots, root, "keyslots"))
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, "Could not get keyslots");
+
+  order = grub_calloc (size, sizeof (*order));
+  rank = grub_calloc (size, sizeof (*rank));
+  if (!order || !rank)
+    {
+      grub_free (order);
+      grub_free (rank);
+      return grub_errno;
+    }
+
+  for (i = 0; i < size; i++)
+    {
+      r = 1;
+      if (grub_json_getchild (&keyslot, &keyslots, i) == GRUB_ERR_NONE &&
+	  grub_json_getuint64 (&idx, &keyslot, NULL) == GRUB_ERR_NONE &&
+	  grub_json_getchild (&keyslot, &keyslot, 0) == GRUB_ERR_NONE)
+	{
+	  if (grub_json_getint64 (&r, &keyslot, "priority"))
+	    r = 1;
+	  /* Priority 0 means the keyslot must not be tried at all. */
+	  if (r != 0 && last_keyslot >= 0 && idx == (grub_uint64_t) last_keyslot)
+	    r = LUKS2_PRIORITY_LAST_USED;
+	}
+
+      /* Stable insertion sort, there are only a handful of keyslots. */
+      for (j = i; j > 0 && rank[j - 1] < r; j--)
+	{
+	  rank[j] = rank[j - 1];
+	  order[j] = order[j - 1];
+	}
+      rank[j] = r;
+      order[j] = i;
+    }
+
+  grub_free (rank);
+  grub_errno = GRUB_ERR_NONE;
+  *out = order;
+  return GRUB_ERR_NONE;
+}
+
 static grub_err_t
 luks2_recover_key (grub_disk_t source,
 		   grub_cryptodisk_t crypt)
@@ -547,7 +661,7 @@ luks2_recover_key (grub_disk_t source,
   grub_uint8_t candidate_key[GRUB_CRYPTODISK_MAX_KEYLEN];
   char passphrase[MAX_PASSPHRASE], cipher[32];
   char *json_header = NULL, *part = NULL, *ptr;
-  grub_size_t candidate_key_len = 0, json_idx, size;
+  grub_size_t candidate_key_len = 0, size, n, *order = NULL;
   grub_luks2_header_t header;
   grub_luks2_keyslot_t keyslot;
   grub_luks2_digest_t digest;
@@ -609,14 +723,19 @@ luks2_recover_key (grub_disk_t source,
       goto err;
     }
 
-  /* Try all keyslot */
-  for (json_idx = 0; json_idx < size; json_idx++)
+  ret = luks2_order_keyslots (&order, json, size,
+			      grub_cryptodisk_get_last_keyslot (crypt));
+  if (ret)
+    goto err;
+
+  /* Try all keyslots, most likely ones first */
+  for (n = 0; n < size; n++)
     {
       char indexstr[21]; /* log10(2^64) ~ 20, plus NUL character. */
       typeof (source->total_sectors) max_crypt_sectors = 0;
 
       grub_errno = GRUB_ERR_NONE;
-      ret = luks2_get_keyslot (&keyslot, &digest, &segment, json, json_idx);
+      ret = luks2_get_keyslot (&keyslot, &digest, &segment, json, order[n]);
       if (ret)
 	goto err;
       if (grub_errno != GRUB_ERR_NONE)
@@ -739,6 +858,7 @@ luks2_recover_key (grub_disk_t source,
        * where each element is either empty or holds a key.
        */
       grub_printf_ (N_("Slot \"%s\" opened\n"), indexstr);
+      grub_cryptodisk_set_last_keyslot (crypt, keyslot.idx);
 
       candidate_key_len = keyslot.key_size;
       break;
@@ -769,6 +889,7 @@ luks2_recover_key (grub_disk_t source,
     }
 
  err:
+  grub_free (order);
   grub_free (part);
   grub_free (json_header);
   grub_json_free (json);
@@ -36,12 +36,6 @@ GRUB_MOD_LICENSE ("GPLv3+");
 
 static const char *(*grub_gettext_original) (const char *s);
 
-struct grub_gettext_msg
-{
-  char *name;
-  char *translated;
-};
-
 struct header
 {
   grub_uint32_t magic;
@@ -49,6 +43,8 @@ struct header
   grub_uint32_t number_of_strings;
   grub_uint32_t offset_original;
   grub_uint32_t offset_translation;
+  grub_uint32_t hash_size;
+  grub_uint32_t hash_offset;
 };
 
 struct string_descriptor 
@@ -57,20 +53,36 @@ struct string_descriptor
   grub_uint32_t offset;
 };
 
+/* A .mo file read into memory.  Translations point into DATA, so a
+   catalog is never freed: the strings could still be in use.  Loading
+   the same file again reuses the catalog instead of leaking another
+   copy.  */
+struct grub_gettext_catalog
+{
+  struct grub_gettext_catalog *next;
+  grub_size_t size;
+  char *data;
+};
+
+static struct grub_gettext_catalog *grub_gettext_catalogs;
+
 struct grub_gettext_context
 {
-  grub_file_t fd_mo;
-  grub_off_t grub_gettext_offset_original;
-  grub_off_t grub_gettext_offset_translation;
+  struct grub_gettext_catalog *catalog;
+  const struct string_descriptor *original;
+  const struct string_descriptor *translation;
+  const grub_uint32_t *hash;
+  grub_uint32_t hash_size;
   grub_size_t grub_gettext_max;
-  int grub_gettext_max_log;
-  struct grub_gettext_msg *grub_gettext_msg_list;
 };
 
 static struct grub_gettext_context main_context, secondary_context;
 
 #define MO_MAGIC_NUMBER 		0x950412de
 
+/* Catalogs bigger than this are surely corrupted.  */
+#define MO_MAX_SIZE			(16 << 20)
+
 static grub_err_t
 grub_gettext_pread (grub_file_t file, void *buf, grub_size_t len,
 		    grub_off_t offset)
@@ -88,159 +100,90 @@ grub_gettext_pread (grub_file_t file, void *buf, grub_size_t len,
   return GRUB_ERR_NONE;
 }
 
-static char *
-grub_gettext_getstr_from_position (struct grub_gettext_context *ctx,
-				   grub_off_t off,
-				   grub_size_t position)
-{
-  grub_off_t internal_position;
-  grub_size_t length;
-  grub_off_t offset;
-  char *translation;
-  struct string_descriptor desc;
-  grub_err_t err;
-
-  internal_position = (off + position * sizeof (desc));
-
-  err = grub_gettext_pread (ctx->fd_mo, (char *) &desc,
-			    sizeof (desc), internal_position);
-  if (err)
-    return NULL;
-  length = grub_cpu_to_le32 (desc.length);
-  offset = grub_cpu_to_le32 (desc.offset);
-
-  translation = grub_malloc (length + 1);
-  if (!translation)
-    return NULL;
-
-  err = grub_gettext_pread (ctx->fd_mo, translation, length, offset);
-  if (err)
-    {
-      grub_free (translation);
-      return NULL;
-    }
-  translation[length] = '\0';
-
-  return translation;
-}
-
 static const char *
-grub_gettext_gettranslation_from_position (struct grub_gettext_context *ctx,
-					   grub_size_t position)
+grub_gettext_getstr (struct grub_gettext_context *ctx,
+		     const struct string_descriptor *table,
+		     grub_size_t position)
 {
-  if (!ctx->grub_gettext_msg_list[position].translated)
-    ctx->grub_gettext_msg_list[position].translated
-      = grub_gettext_getstr_from_position (ctx,
-					   ctx->grub_gettext_offset_translation,
-					   position);
-  return ctx->grub_gettext_msg_list[position].translated;
+  return ctx->catalog->data + grub_le_to_cpu32 (table[position].offset);
 }
 
-static const char *
-grub_gettext_getstring_from_position (struct grub_gettext_context *ctx,
-				      grub_size_t position)
+/* The hash function of GNU gettext, which msgfmt uses to build the hash
+   table of the catalog.  */
+static grub_uint32_t
+grub_gettext_hash (const char *str)
 {
-  if (!ctx->grub_gettext_msg_list[position].name)
-    ctx->grub_gettext_msg_list[position].name
-      = grub_gettext_getstr_from_position (ctx,
-					   ctx->grub_gettext_offset_original,
-					   position);
-  return ctx->grub_gettext_msg_list[position].name;
+  grub_uint32_t hval = 0, g;
+
+  while (*str)
+    {
+      hval <<= 4;
+      hval += (grub_uint8_t) *str++;
+      g = hval & 0xf0000000;
+      if (g)
+	{
+	  hval ^= g >> 24;
+	  hval ^= g;
+	}
+    }
+  return hval;
 }
 
 static const char *
 grub_gettext_translate_real (struct grub_gettext_context *ctx,
 			     const char *orig)
 {
-  grub_size_t current = 0;
-  int i;
-  const char *current_string;
-  static int depth = 0;
+  grub_size_t position;
 
-  if (!ctx->grub_gettext_msg_list || !ctx->fd_mo)
+  if (!ctx->catalog)
     return NULL;
 
-  /* Shouldn't happen. Just a precaution if our own code
-     calls gettext somehow.  */
-  if (depth > 2)
-    return NULL;
-  depth++;
-
-  /* Make sure we can use grub_gettext_translate for error messages.  Push
-     active error message to error stack and reset error message.  */
-  grub_error_push ();
-
-  for (i = ctx->grub_gettext_max_log; i >= 0; i--)
-    {
-      grub_size_t test;
-      int cmp;
-
-      test = current | (1 << i);
-      if (test >= ctx->grub_gettext_max)
-	continue;
-
-      current_string = grub_gettext_getstring_from_position (ctx, test);
-
-      if (!current_string)
-	{
-	  grub_errno = GRUB_ERR_NONE;
-	  grub_error_pop ();
-	  depth--;
-	  return NULL;
-	}
-
-      /* Search by bisection.  */
-      cmp = grub_strcmp (current_string, orig);
-      if (cmp <= 0)
-	current = test;
-      if (cmp == 0)
-	{
-	  const char *ret = 0;
-	  ret = grub_gettext_gettranslation_from_position (ctx, current);
-	  if (!ret)
-	    {
-	      grub_errno = GRUB_ERR_NONE;
-	      grub_error_pop ();
-	      depth--;
-	      return NULL;
-	    }
-	  grub_error_pop ();
-	  depth--;
-	  return ret;      
-	}
-    }
-
-  if (current == 0 && ctx->grub_gettext_max != 0)
+  if (ctx->hash)
     {
-      current_string = grub_gettext_getstring_from_position (ctx, 0);
+      grub_uint32_t hval = grub_gettext_hash (orig);
+      grub_uint32_t idx = hval % ctx->hash_size;
+      grub_uint32_t incr = 1 + hval % (ctx->hash_size - 2);
+      grub_uint32_t i;
 
-      if (!current_string)
+      for (i = 0; i < ctx->hash_size; i++)
 	{
-	  grub_errno = GRUB_ERR_NONE;
-	  grub_error_pop ();
-	  depth--;
-	  return NULL;
-	}
-
-      if (grub_strcmp (current_string, orig) == 0)
-	{
-	  const char *ret = 0;
-	  ret = grub_gettext_gettranslation_from_position (ctx, current);
-	  if (!ret)
-	    {
-	      grub_errno = GRUB_ERR_NONE;
-	      grub_error_pop ();
-	      depth--;
-	      return NULL;
-	    }
-	  grub_error_pop ();
-	  depth--;
-	  return ret;      
+	  grub_uint32_t nstr = grub_le_to_cpu32 (ctx->hash[idx]);
+
+	  if (nstr == 0)
+	    return NULL;
+	  if (nstr <= ctx->grub_gettext_max
+	      && grub_strcmp (grub_gettext_getstr (ctx, ctx->original,
+						   nstr - 1), orig) == 0)
+	    return grub_gettext_getstr (ctx, ctx->translation, nstr - 1);
+
+	  if (idx >= ctx->hash_size - incr)
+	    idx -= ctx->hash_size - incr;
+	  else
+	    idx += incr;
 	}
+      return NULL;
     }
 
-  grub_error_pop ();
-  depth--;
+  /* No hash table: the original strings are sorted, search by
+     bisection.  */
+  {
+    grub_size_t lo = 0, hi = ctx->grub_gettext_max;
+
+    while (lo < hi)
+      {
+	int cmp;
+
+	position = lo + (hi - lo) / 2;
+	cmp = grub_strcmp (grub_gettext_getstr (ctx, ctx->original, position),
+			   orig);
+	if (cmp == 0)
+	  return grub_gettext_getstr (ctx, ctx->translation, position);
+	if (cmp < 0)
+	  lo = position + 1;
+	else
+	  hi = position;
+      }
+  }
   return NULL;
 }
 
@@ -263,74 +206,139 @@ grub_gettext_translate (const char *orig)
 static void
 grub_gettext_delete_list (struct grub_gettext_context *ctx)
 {
-  struct grub_gettext_msg *l = ctx->grub_gettext_msg_list;
-  grub_size_t i;
-
-  if (!l)
-    return;
-  ctx->grub_gettext_msg_list = 0;
-  for (i = 0; i < ctx->grub_gettext_max; i++)
-    grub_free (l[i].name);
-  /* Don't delete the translated message because could be in use.  */
-  grub_free (l);
-  if (ctx->fd_mo)
-    grub_file_close (ctx->fd_mo);
-  ctx->fd_mo = 0;
+  /* The catalog stays, translations could be in use.  */
   grub_memset (ctx, 0, sizeof (*ctx));
 }
 
+/* Check that the string table at OFFSET and all of its strings lie
+   within the catalog and are NUL-terminated.  */
+static int
+grub_gettext_check_table (const char *data, grub_size_t size,
+			  grub_uint32_t offset, grub_uint32_t count)
+{
+  const struct string_descriptor *table;
+  grub_uint32_t i;
+
+  if ((offset & 3) || offset > size
+      || (size - offset) / sizeof (*table) < count)
+    return 0;
+
+  table = (const struct string_descriptor *) (data + offset);
+  for (i = 0; i < count; i++)
+    {
+      grub_uint32_t len = grub_le_to_cpu32 (table[i].length);
+      grub_uint32_t off = grub_le_to_cpu32 (table[i].offset);
+
+      if (off >= size || len >= size - off || data[off + len] != '\0')
+	return 0;
+    }
+  return 1;
+}
+
 /* This is similar to grub_file_open. */
 static grub_err_t
 grub_mofile_open (struct grub_gettext_context *ctx,
 		  const char *filename)
 {
-  struct header head;
+  struct grub_gettext_catalog *catalog;
+  const struct header *head;
+  grub_off_t size;
   grub_err_t err;
   grub_file_t fd;
-
-  /* Using fd_mo and not another variable because
-     it's needed for grub_gettext_get_info.  */
+  char *data;
 
   fd = grub_file_open (filename, GRUB_FILE_TYPE_GETTEXT_CATALOG);
 
   if (!fd)
     return grub_errno;
 
-  err = grub_gettext_pread (fd, &head, sizeof (head), 0);
-  if (err)
+  size = grub_file_size (fd);
+  if (size < sizeof (*head) || size > MO_MAX_SIZE)
     {
       grub_file_close (fd);
-      return err;
+      return grub_error (GRUB_ERR_BAD_FILE_TYPE,
+			 "mo: invalid size of file: %s", filename);
     }
 
-  if (head.magic != grub_cpu_to_le32_compile_time (MO_MAGIC_NUMBER))
+  /* Read the whole catalog at once: lookups then need no I/O.  */
+  data = grub_malloc (size);
+  if (!data)
     {
       grub_file_close (fd);
+      return grub_errno;
+    }
+  err = grub_gettext_pread (fd, data, size, 0);
+  grub_file_close (fd);
+  if (err)
+    {
+      grub_free (data);
+      return err;
+    }
+
+  head = (const struct header *) data;
+  if (head->magic != grub_cpu_to_le32_compile_time (MO_MAGIC_NUMBER))
+    {
+      grub_free (data);
       return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 			 "mo: invalid mo magic in file: %s", filename);
     }
 
-  if (head.version != 0)
+  if (head->version != 0)
     {
-      grub_file_close (fd);
+      grub_free (data);
       return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 			 "mo: invalid mo version in file: %s", filename);
     }
 
-  ctx->grub_gettext_offset_original = grub_le_to_cpu32 (head.offset_original);
-  ctx->grub_gettext_offset_translation = grub_le_to_cpu32 (head.offset_translation);
-  ctx->grub_gettext_max = grub_le_to_cpu32 (head.number_of_strings);
-  for (ctx->grub_gettext_max_log = 0; ctx->grub_gettext_max >> ctx->grub_gettext_max_log;
-       ctx->grub_gettext_max_log++);
+  if (!grub_gettext_check_table (data, size,
+				 grub_le_to_cpu32 (head->offset_original),
+				 grub_le_to_cpu32 (head->number_of_strings))
+      || !grub_gettext_check_table (data, size,
+				    grub_le_to_cpu32 (head->offset_translation),
+				    grub_le_to_cpu32 (head->number_of_strings)))
+    {
+      grub_free (data);
+      return grub_error (GRUB_ERR_BAD_FILE_TYPE,
+			 "mo: invalid string table in file: %s", filename);
+    }
 
-  ctx->grub_gettext_msg_list = grub_zalloc (ctx->grub_gettext_max
-					    * sizeof (ctx->grub_gettext_msg_list[0]));
-  if (!ctx->grub_gettext_msg_list)
+  for (catalog = grub_gettext_catalogs; catalog; catalog = catalog->next)
+    if (catalog->size == size && grub_memcmp (catalog->data, data, size) == 0)
+      break;
+  if (catalog)
+    grub_free (data);
+  else
     {
-      grub_file_close (fd);
-      return grub_errno;
+      catalog = grub_malloc (sizeof (*catalog));
+      if (!catalog)
+	{
+	  grub_free (data);
+	  return grub_errno;
+	}
+      catalog->size = size;
+      catalog->data = data;
+      catalog->next = grub_gettext_catalogs;
+      grub_gettext_catalogs = catalog;
     }
-  ctx->fd_mo = fd;
+
+  head = (const struct header *) catalog->data;
+  ctx->catalog = catalog;
+  ctx->grub_gettext_max = grub_le_to_cpu32 (head->number_of_strings);
+  ctx->original = (const struct string_descriptor *)
+    (catalog->data + grub_le_to_cpu32 (head->offset_original));
+  ctx->translation = (const struct string_descriptor *)
+    (catalog->data + grub_le_to_cpu32 (head->offset_translation));
+
+  /* Without a usable hash table, fall back to bisection.  */
+  ctx->hash_size = grub_le_to_cpu32 (head->hash_size);
+  ctx->hash = NULL;
+  if (ctx->hash_size > 2 && !(grub_le_to_cpu32 (head->hash_offset) & 3)
+      && grub_le_to_cpu32 (head->hash_offset) <= size
+      && (size - grub_le_to_cpu32 (head->hash_offset)) / sizeof (grub_uint32_t)
+	 >= ctx->hash_size)
+    ctx->hash = (const grub_uint32_t *)
+      (catalog->data + grub_le_to_cpu32 (head->hash_offset));
+
   if (grub_gettext != grub_gettext_translate)
     {
       grub_gettext_original = grub_gettext;
@@ -0,0 +1,129 @@
+/* bitmap_cache.c - Share the images of a theme between its components.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/mm.h>
+#include <grub/misc.h>
+#include <grub/err.h>
+#include <grub/i18n.h>
+#include <grub/bitmap.h>
+#include <grub/gfxwidgets.h>
+
+/* Themes refer to the same pixmaps many times: the item and selected item
+   boxes of a list usually share a style, and most styles lack some of
+   their nine pixmaps.  Every file is therefore loaded, or found missing,
+   only once while the view lives.  */
+struct bitmap_cache_entry
+{
+  struct bitmap_cache_entry *next;
+  char *path;
+  /* NULL if the file doesn't exist.  */
+  struct grub_video_bitmap *bitmap;
+  unsigned refs;
+};
+
+static struct bitmap_cache_entry *bitmap_cache;
+
+/* Like grub_video_bitmap_load, but the bitmap is shared and must be
+   released with grub_gfxmenu_bitmap_release.  */
+grub_err_t
+grub_gfxmenu_bitmap_load (struct grub_video_bitmap **bitmap,
+                          const char *path)
+{
+  struct bitmap_cache_entry *entry;
+
+  *bitmap = 0;
+  for (entry = bitmap_cache; entry; entry = entry->next)
+    if (grub_strcmp (entry->path, path) == 0)
+      break;
+
+  if (! entry)
+    {
+      struct grub_video_bitmap *loaded;
+
+      if (grub_video_bitmap_load (&loaded, path) != GRUB_ERR_NONE)
+        {
+          /* Only remember files that don't exist; other errors may be
+             worth retrying.  */
+          if (grub_errno != GRUB_ERR_FILE_NOT_FOUND)
+            return grub_errno;
+          loaded = 0;
+        }
+
+      entry = grub_malloc (sizeof (*entry));
+      if (entry)
+        entry->path = grub_strdup (path);
+      if (! entry || ! entry->path)
+        {
+          grub_free (entry);
+          grub_video_bitmap_destroy (loaded);
+          return grub_errno;
+        }
+      entry->bitmap = loaded;
+      entry->refs = 0;
+      entry->next = bitmap_cache;
+      bitmap_cache = entry;
+    }
+
+  if (! entry->bitmap)
+    return grub_error (GRUB_ERR_FILE_NOT_FOUND, N_("file `%s' not found"),
+                       path);
+
+  entry->refs++;
+  *bitmap = entry->bitmap;
+  return GRUB_ERR_NONE;
+}
+
+void
+grub_gfxmenu_bitmap_release (struct grub_video_bitmap *bitmap)
+{
+  struct bitmap_cache_entry *entry;
+
+  if (! bitmap)
+    return;
+
+  for (entry = bitmap_cache; entry; entry = entry->next)
+    if (entry->bitmap == bitmap)
+      {
+        entry->refs--;
+        return;
+      }
+}
+
+/* Free the bitmaps nobody uses any longer, and forget missing files.
+   Unused bitmaps are kept until then because components recreate their
+   boxes when a theme sets a property more than once.  */
+void
+grub_gfxmenu_bitmap_cache_flush (void)
+{
+  struct bitmap_cache_entry **prev, *entry;
+
+  for (prev = &bitmap_cache; *prev; )
+    {
+      entry = *prev;
+      if (entry->refs)
+        {
+          prev = &entry->next;
+          continue;
+        }
+      *prev = entry->next;
+      grub_video_bitmap_destroy (entry->bitmap);
+      grub_free (entry->path);
+      grub_free (entry);
+    }
+}
@@ -55,6 +55,8 @@ circprog_destroy (void *vself)
 {
   circular_progress_t self = vself;
   grub_gfxmenu_timeout_unregister ((grub_gui_component_t) self);
+  grub_gfxmenu_bitmap_release (self->center_bitmap);
+  grub_gfxmenu_bitmap_release (self->tick_bitmap);
   grub_free (self);
 }
 
@@ -88,7 +90,7 @@ load_bitmap (const char *dir, const char *file)
 
   /* Load the image.  */
   grub_errno = GRUB_ERR_NONE;
-  grub_video_bitmap_load (&bitmap, abspath);
+  grub_gfxmenu_bitmap_load (&bitmap, abspath);
   grub_errno = GRUB_ERR_NONE;
 
   grub_free (abspath);
@@ -100,8 +102,8 @@ check_pixmaps (circular_progress_t self)
 {
   if (self->need_to_load_pixmaps)
     {
-      if (self->center_bitmap)
-        grub_video_bitmap_destroy (self->center_bitmap);
+      grub_gfxmenu_bitmap_release (self->center_bitmap);
+      grub_gfxmenu_bitmap_release (self->tick_bitmap);
       self->center_bitmap = load_bitmap (self->theme_dir, self->center_file);
       self->tick_bitmap = load_bitmap (self->theme_dir, self->tick_file);
       self->need_to_load_pixmaps = 0;
@@ -23,6 +23,7 @@
 #include <grub/gui_string_util.h>
 #include <grub/bitmap.h>
 #include <grub/bitmap_scale.h>
+#include <grub/gfxwidgets.h>
 
 struct grub_gui_image
 {
@@ -46,8 +47,7 @@ image_destroy (void *vself)
   /* Free the scaled bitmap, unless it's a reference to the raw bitmap.  */
   if (self->bitmap && (self->bitmap != self->raw_bitmap))
     grub_video_bitmap_destroy (self->bitmap);
-  if (self->raw_bitmap)
-    grub_video_bitmap_destroy (self->raw_bitmap);
+  grub_gfxmenu_bitmap_release (self->raw_bitmap);
 
   grub_free (self);
 }
@@ -191,7 +191,7 @@ static grub_err_t
 load_image (grub_gui_image_t self, const char *path)
 {
   struct grub_video_bitmap *bitmap;
-  if (grub_video_bitmap_load (&bitmap, path) != GRUB_ERR_NONE)
+  if (grub_gfxmenu_bitmap_load (&bitmap, path) != GRUB_ERR_NONE)
     return grub_errno;
 
   if (self->bitmap && (self->bitmap != self->raw_bitmap))
@@ -199,8 +199,7 @@ load_image (grub_gui_image_t self, const char *path)
       grub_video_bitmap_destroy (self->bitmap);
       self->bitmap = 0;
     }
-  if (self->raw_bitmap)
-    grub_video_bitmap_destroy (self->raw_bitmap);
+  grub_gfxmenu_bitmap_release (self->raw_bitmap);
 
   self->raw_bitmap = bitmap;
   return rescale_image (self);
@@ -223,15 +223,18 @@ list_is_instance (void *vself __attribute__((unused)), const char *type)
           || grub_strcmp (type, "list") == 0);
 }
 
-static struct grub_video_bitmap *
-get_item_icon (list_impl_t self, int item_index)
+/* Height of a row, including the borders of the item boxes.  */
+static int
+get_row_height (list_impl_t self)
 {
-  grub_menu_entry_t entry;
-  entry = grub_menu_get_entry (self->view->menu, item_index);
-  if (! entry)
-    return 0;
+  grub_gfxmenu_box_t itembox = self->item_box;
+  grub_gfxmenu_box_t selbox = self->selected_item_box;
 
-  return grub_gfxmenu_icon_manager_get_icon (self->icon_manager, entry);
+  return (grub_max (itembox->get_top_pad (itembox),
+		    selbox->get_top_pad (selbox))
+	  + self->item_height
+	  + grub_max (itembox->get_bottom_pad (itembox),
+		      selbox->get_bottom_pad (selbox)));
 }
 
 static void
@@ -314,9 +317,11 @@ draw_scrollbar (list_impl_t self,
   thumb->draw (thumb, thumbx, thumby);
 }
 
-/* Draw the list of items.  */
+/* Draw the list of items.  Only the rows crossing the lines CLIP_TOP to
+   CLIP_BOTTOM, relative to the first row, are drawn.  */
 static void
-draw_menu (list_impl_t self, int num_shown_items)
+draw_menu (list_impl_t self, int num_shown_items,
+	   int clip_top, int clip_bottom)
 {
   if (! self->menu_box || ! self->selected_item_box || ! self->item_box)
     return;
@@ -347,8 +352,10 @@ draw_menu (list_impl_t self, int num_shown_items)
   int max_leftpad = grub_max (item_leftpad, sel_leftpad);
   int max_toppad = grub_max (item_toppad, sel_toppad);
   int item_top = 0;
+  int row_height = get_row_height (self);
   int menu_index;
   int visible_index;
+  grub_menu_entry_t entry;
   struct grub_video_rect oviewport;
 
   grub_video_get_viewport (&oviewport.x, &oviewport.y,
@@ -389,9 +396,13 @@ draw_menu (list_impl_t self, int num_shown_items)
   int item_icon_top_offset = item_toppad + tmp_icon_top_offset;
   int sel_icon_top_offset = sel_toppad + tmp_icon_top_offset;
 
+  /* Walk the entries instead of looking each one up from the start of
+     the menu, which is quadratic in the number of entries.  */
+  entry = grub_menu_get_entry (self->view->menu, self->first_shown_index);
   for (visible_index = 0, menu_index = self->first_shown_index;
-       visible_index < num_shown_items && menu_index < self->view->menu->size;
-       visible_index++, menu_index++)
+       visible_index < num_shown_items && entry;
+       visible_index++, menu_index++, entry = entry->next,
+	 item_top += text_box_height + item_vspace)
     {
       int is_selected = (menu_index == self->view->selected);
       struct grub_video_bitmap *icon;
@@ -402,6 +413,9 @@ draw_menu (list_impl_t self, int num_shown_items)
       int icon_top_offset;
       int viewport_width;
 
+      if (item_top >= clip_bottom || item_top + row_height <= clip_top)
+	continue;
+
       if (is_selected)
         {
           selbox->draw (selbox, 0, item_top + sel_box_top_offset);
@@ -423,15 +437,14 @@ draw_menu (list_impl_t self, int num_shown_items)
           viewport_width = item_viewport_width;
         }
 
-      icon = get_item_icon (self, menu_index);
+      icon = grub_gfxmenu_icon_manager_get_icon (self->icon_manager, entry);
       if (icon != 0)
         grub_video_blit_bitmap (icon, GRUB_VIDEO_BLIT_BLEND,
                                 max_leftpad,
                                 item_top + icon_top_offset,
                                 0, 0, self->icon_width, self->icon_height);
 
-      const char *item_title =
-        grub_menu_get_entry (self->view->menu, menu_index)->title;
+      const char *item_title = entry->title;
 
       sviewport.y = item_top + top_pad;
       sviewport.width = viewport_width;
@@ -442,8 +455,6 @@ draw_menu (list_impl_t self, int num_shown_items)
                              0,
                              text_top_offset);
       grub_gui_restore_viewport (&svpsave);
-
-      item_top += text_box_height + item_vspace;
     }
   grub_video_set_viewport (oviewport.x,
 			   oviewport.y,
@@ -506,8 +517,12 @@ list_paint (void *vself, const grub_video_rect_t *region)
           break;
       }
 
+    /* Rows start below the padding of the menu box.  */
+    int clip_top = region->y - self->bounds.y - content_rect.y
+                   - self->item_padding;
+
     grub_gui_set_viewport (&content_rect, &vpsave2);
-    draw_menu (self, num_shown_items);
+    draw_menu (self, num_shown_items, clip_top, clip_top + region->height);
     grub_gui_restore_viewport (&vpsave2);
 
     if (drawing_scrollbar)
@@ -852,6 +867,40 @@ list_set_view_info (void *vself,
   self->view = view;
 }
 
+/* Find the rows of OLD_SELECTED and of the current selection, so that
+   moving the selection repaints just the two of them.  */
+static int
+list_get_selection_rows (void *vself, int old_selected,
+                         grub_video_rect_t *old_row,
+                         grub_video_rect_t *new_row)
+{
+  list_impl_t self = vself;
+  int first_shown_index = self->first_shown_index;
+  int selected = self->view->selected;
+  int row_top;
+
+  if (! self->visible || ! check_boxes (self))
+    return 0;
+
+  /* Scrolling moves every row.  */
+  make_selected_item_visible (self);
+  if (self->first_shown_index != first_shown_index
+      || old_selected < first_shown_index || selected < first_shown_index
+      || old_selected >= first_shown_index + get_num_shown_items (self))
+    return 0;
+
+  row_top = (self->bounds.y + self->menu_box->get_top_pad (self->menu_box)
+             + self->item_padding);
+  old_row->x = new_row->x = self->bounds.x;
+  old_row->width = new_row->width = self->bounds.width;
+  old_row->height = new_row->height = get_row_height (self);
+  old_row->y = row_top + ((old_selected - first_shown_index)
+                          * (self->item_height + self->item_spacing));
+  new_row->y = row_top + ((selected - first_shown_index)
+                          * (self->item_height + self->item_spacing));
+  return 1;
+}
+
 /* Refresh list variables */
 static void
 list_refresh_info (void *vself,
@@ -879,7 +928,8 @@ static struct grub_gui_component_ops list_comp_ops =
 static struct grub_gui_list_ops list_ops =
 {
   .set_view_info = list_set_view_info,
-  .refresh_list = list_refresh_info
+  .refresh_list = list_refresh_info,
+  .get_selection_rows = list_get_selection_rows
 };
 
 grub_gui_component_t
@@ -34,6 +34,7 @@ static const char icon_extension[] = ".png";
 typedef struct icon_entry
 {
   char *class_name;
+  /* NULL if the class has no icon.  */
   struct grub_video_bitmap *bitmap;
   struct icon_entry *next;
 } *icon_entry_t;
@@ -213,13 +214,9 @@ get_icon_by_class (grub_gfxmenu_icon_manager_t mgr, const char *class_name)
 	icon = try_loading_icon (mgr, icondir, class_name);
     }
 
-  /* No icon was found.  */
-  /* This should probably be noted in the cache, so that a search is not
-     performed each time an icon for CLASS_NAME is requested.  */
-  if (! icon)
-    return 0;
-
-  /* Insert a new cache entry for this icon.  */
+  /* Insert a new cache entry for this icon.  Classes without an icon are
+     cached too, so that the menu doesn't search for their icons on every
+     repaint.  */
   entry = grub_malloc (sizeof (*entry));
   if (! entry)
     {
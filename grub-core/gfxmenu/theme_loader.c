@@ -169,13 +169,13 @@ theme_set_string (grub_gfxmenu_view_t view,
       path = grub_resolve_relative_path (theme_dir, value);
       if (! path)
         return grub_errno;
-      if (grub_video_bitmap_load (&raw_bitmap, path) != GRUB_ERR_NONE)
+      if (grub_gfxmenu_bitmap_load (&raw_bitmap, path) != GRUB_ERR_NONE)
         {
           grub_free (path);
           return grub_errno;
         }
       grub_free(path);
-      grub_video_bitmap_destroy (view->raw_desktop_image);
+      grub_gfxmenu_bitmap_release (view->raw_desktop_image);
       view->raw_desktop_image = raw_bitmap;
     }
   else if (! grub_strcmp ("desktop-image-scale-method", name))
@@ -134,7 +134,7 @@ grub_gfxmenu_view_destroy (grub_gfxmenu_view_t view)
       grub_gfxmenu_timeout_notifications = grub_gfxmenu_timeout_notifications->next;
       grub_free (p);
     }
-  grub_video_bitmap_destroy (view->raw_desktop_image);
+  grub_gfxmenu_bitmap_release (view->raw_desktop_image);
   grub_video_bitmap_destroy (view->scaled_desktop_image);
   if (view->terminal_box)
     view->terminal_box->destroy (view->terminal_box);
@@ -145,6 +145,7 @@ grub_gfxmenu_view_destroy (grub_gfxmenu_view_t view)
   if (view->canvas)
     view->canvas->component.ops->destroy (view->canvas);
   grub_free (view);
+  grub_gfxmenu_bitmap_cache_flush ();
 }
 
 static void
@@ -401,13 +402,63 @@ grub_gfxmenu_redraw_menu (grub_gfxmenu_view_t view)
     }
 }
 
+/* Context for redraw_selection_visit.  */
+struct redraw_selection_ctx
+{
+  grub_gfxmenu_view_t view;
+  int old_selected;
+  /* Set when a list had to be repainted entirely, so that the second
+     buffer gets the same treatment.  */
+  int full;
+};
+
+static void
+redraw_selection_visit (grub_gui_component_t component,
+                        void *userdata)
+{
+  struct redraw_selection_ctx *ctx = userdata;
+  grub_gui_list_t list;
+  grub_video_rect_t old_row, new_row;
+
+  if (! component->ops->is_instance (component, "list"))
+    return;
+
+  list = (grub_gui_list_t) component;
+  if (! ctx->full && list->ops->get_selection_rows
+      && list->ops->get_selection_rows (list, ctx->old_selected,
+                                        &old_row, &new_row))
+    {
+      grub_video_set_area_status (GRUB_VIDEO_AREA_ENABLED);
+      grub_gfxmenu_view_redraw (ctx->view, &old_row);
+      grub_video_set_area_status (GRUB_VIDEO_AREA_ENABLED);
+      grub_gfxmenu_view_redraw (ctx->view, &new_row);
+    }
+  else
+    {
+      ctx->full = 1;
+      redraw_menu_visit (component, ctx->view);
+    }
+}
+
 void 
 grub_gfxmenu_set_chosen_entry (int entry, void *data)
 {
   grub_gfxmenu_view_t view = data;
+  struct redraw_selection_ctx ctx = {
+    .view = view,
+    .old_selected = view->selected,
+    .full = 0
+  };
 
   view->selected = entry;
-  grub_gfxmenu_redraw_menu (view);
+  update_menu_components (view);
+
+  grub_gui_iterate_recursively ((grub_gui_component_t) view->canvas,
+                                redraw_selection_visit, &ctx);
+  grub_video_swap_buffers ();
+  if (view->double_repaint)
+    grub_gui_iterate_recursively ((grub_gui_component_t) view->canvas,
+                                  redraw_selection_visit, &ctx);
 }
 
 static void
@@ -62,6 +62,46 @@ get_width (struct grub_video_bitmap *bitmap)
     return 0;
 }
 
+/* Load the pixmaps when the box is first measured or drawn, so that the
+   boxes of components that are never shown cost nothing.  */
+static void
+load_pixmaps (grub_gfxmenu_box_t self)
+{
+  unsigned i;
+
+  if (! self->pixmaps_prefix)
+    return;
+
+  for (i = 0; i < BOX_NUM_PIXMAPS; i++)
+    {
+      char *path;
+      char *path_end;
+
+      path = grub_malloc (grub_strlen (self->pixmaps_prefix)
+                          + grub_strlen (box_pixmap_names[i])
+                          + grub_strlen (self->pixmaps_suffix)
+                          + 1);
+      if (! path)
+        break;
+
+      /* Construct the specific path for this pixmap.  */
+      path_end = grub_stpcpy (path, self->pixmaps_prefix);
+      path_end = grub_stpcpy (path_end, box_pixmap_names[i]);
+      path_end = grub_stpcpy (path_end, self->pixmaps_suffix);
+
+      grub_gfxmenu_bitmap_load (&self->raw_pixmaps[i], path);
+      grub_free (path);
+    }
+
+  /* Ignore missing pixmaps.  */
+  grub_errno = GRUB_ERR_NONE;
+
+  grub_free (self->pixmaps_prefix);
+  grub_free (self->pixmaps_suffix);
+  self->pixmaps_prefix = 0;
+  self->pixmaps_suffix = 0;
+}
+
 static void
 blit (grub_gfxmenu_box_t self, int pixmap_index, int x, int y)
 {
@@ -82,6 +122,8 @@ draw (grub_gfxmenu_box_t self, int x, int y)
   int width_w;
   int tmp;
 
+  load_pixmaps (self);
+
   /* Count maximum height of NW, N, NE.  */
   height_n = get_height (self->scaled_pixmaps[BOX_PIXMAP_NW]);
   tmp = get_height (self->scaled_pixmaps[BOX_PIXMAP_N]);
@@ -158,6 +200,8 @@ set_content_size (grub_gfxmenu_box_t self,
   self->content_width = width;
   self->content_height = height;
 
+  load_pixmaps (self);
+
   /* Resize sides to match the width and height.  */
   /* It is assumed that the corners width/height match the adjacent sides.  */
 
@@ -191,6 +235,7 @@ set_content_size (grub_gfxmenu_box_t self,
 static int
 get_border_width (grub_gfxmenu_box_t self)
 {
+  load_pixmaps (self);
   return (get_width (self->raw_pixmaps[BOX_PIXMAP_E])
 	  + get_width (self->raw_pixmaps[BOX_PIXMAP_W]));
 }
@@ -200,6 +245,8 @@ get_left_pad (grub_gfxmenu_box_t self)
 {
   int v, c;
 
+  load_pixmaps (self);
+
   v = get_width (self->raw_pixmaps[BOX_PIXMAP_W]);
   c = get_width (self->raw_pixmaps[BOX_PIXMAP_NW]);
   if (c > v)
@@ -216,6 +263,8 @@ get_top_pad (grub_gfxmenu_box_t self)
 {
   int v, c;
 
+  load_pixmaps (self);
+
   v = get_height (self->raw_pixmaps[BOX_PIXMAP_N]);
   c = get_height (self->raw_pixmaps[BOX_PIXMAP_NW]);
   if (c > v)
@@ -232,6 +281,8 @@ get_right_pad (grub_gfxmenu_box_t self)
 {
   int v, c;
 
+  load_pixmaps (self);
+
   v = get_width (self->raw_pixmaps[BOX_PIXMAP_E]);
   c = get_width (self->raw_pixmaps[BOX_PIXMAP_NE]);
   if (c > v)
@@ -248,6 +299,8 @@ get_bottom_pad (grub_gfxmenu_box_t self)
 {
   int v, c;
 
+  load_pixmaps (self);
+
   v = get_height (self->raw_pixmaps[BOX_PIXMAP_S]);
   c = get_height (self->raw_pixmaps[BOX_PIXMAP_SW]);
   if (c > v)
@@ -265,8 +318,7 @@ destroy (grub_gfxmenu_box_t self)
   unsigned i;
   for (i = 0; i < BOX_NUM_PIXMAPS; i++)
     {
-      if (self->raw_pixmaps[i])
-        grub_video_bitmap_destroy(self->raw_pixmaps[i]);
+      grub_gfxmenu_bitmap_release (self->raw_pixmaps[i]);
       self->raw_pixmaps[i] = 0;
 
       if (self->scaled_pixmaps[i])
@@ -277,6 +329,8 @@ destroy (grub_gfxmenu_box_t self)
   self->raw_pixmaps = 0;
   grub_free (self->scaled_pixmaps);
   self->scaled_pixmaps = 0;
+  grub_free (self->pixmaps_prefix);
+  grub_free (self->pixmaps_suffix);
 
   /* Free self:  must be the last step!  */
   grub_free (self);
@@ -284,8 +338,8 @@ destroy (grub_gfxmenu_box_t self)
 
 
 /* Create a new box.  If PIXMAPS_PREFIX and PIXMAPS_SUFFIX are both non-null,
-   then an attempt is made to load the north, south, east, west, northwest,
-   northeast, southeast, southwest, and center pixmaps.
+   then the north, south, east, west, northwest, northeast, southeast,
+   southwest, and center pixmaps are loaded when the box is first used.
    If either PIXMAPS_PREFIX or PIXMAPS_SUFFIX is 0, then no pixmaps are
    loaded, and the box has zero-width borders and is drawn transparent.  */
 grub_gfxmenu_box_t
@@ -315,32 +369,15 @@ grub_gfxmenu_create_box (const char *pixmaps_prefix,
   for (i = 0; i < BOX_NUM_PIXMAPS; i++)
       box->scaled_pixmaps[i] = 0;
 
-  /* Load the pixmaps.  */
-  for (i = 0; i < BOX_NUM_PIXMAPS; i++)
+  box->pixmaps_prefix = 0;
+  box->pixmaps_suffix = 0;
+
+  if (pixmaps_prefix && pixmaps_suffix)
     {
-      if (pixmaps_prefix && pixmaps_suffix)
-        {
-          char *path;
-          char *path_end;
-
-          path = grub_malloc (grub_strlen (pixmaps_prefix)
-                              + grub_strlen (box_pixmap_names[i])
-                              + grub_strlen (pixmaps_suffix)
-                              + 1);
-          if (! path)
-            goto fail_and_destroy;
-
-          /* Construct the specific path for this pixmap.  */
-          path_end = grub_stpcpy (path, pixmaps_prefix);
-          path_end = grub_stpcpy (path_end, box_pixmap_names[i]);
-          path_end = grub_stpcpy (path_end, pixmaps_suffix);
-
-          grub_video_bitmap_load (&box->raw_pixmaps[i], path);
-          grub_free (path);
-
-          /* Ignore missing pixmaps.  */
-          grub_errno = GRUB_ERR_NONE;
-        }
+      box->pixmaps_prefix = grub_strdup (pixmaps_prefix);
+      box->pixmaps_suffix = grub_strdup (pixmaps_suffix);
+      if (! box->pixmaps_prefix || ! box->pixmaps_suffix)
+        goto fail_and_destroy;
     }
 
   box->draw = draw;
@@ -253,9 +253,22 @@ grub_xzio_read (grub_file_t file, char *buf, grub_size_t len)
 
   while (len > 0)
     {
-      xzio->buf.out_size = file->offset + ret + len - current_offset;
-      if (xzio->buf.out_size > XZBUFSIZ)
-	xzio->buf.out_size = XZBUFSIZ;
+      int direct = (file->offset + ret == current_offset);
+
+      /* Once the decoder has reached the requested offset, let it write
+	 straight into the caller's buffer instead of going through ours.  */
+      if (direct)
+	{
+	  xzio->buf.out = (grub_uint8_t *) buf;
+	  xzio->buf.out_size = len;
+	}
+      else
+	{
+	  xzio->buf.out = xzio->outbuf;
+	  xzio->buf.out_size = file->offset + ret + len - current_offset;
+	  if (xzio->buf.out_size > XZBUFSIZ)
+	    xzio->buf.out_size = XZBUFSIZ;
+	}
       /* Feed input.  */
       if (xzio->buf.in_pos == xzio->buf.in_size)
 	{
@@ -288,8 +301,9 @@ grub_xzio_read (grub_file_t file, char *buf, grub_size_t len)
 	  /* Store first chunk of data in buffer.  */
 	  {
 	    grub_size_t delta = new_offset - (file->offset + ret);
-	    grub_memmove (buf, xzio->buf.out + (xzio->buf.out_pos - delta),
-			  delta);
+	    if (!direct)
+	      grub_memmove (buf, xzio->buf.out + (xzio->buf.out_pos - delta),
+			    delta);
 	    len -= delta;
 	    buf += delta;
 	    ret += delta;
@@ -36,6 +36,15 @@ grub_efi_get_time_ms (void)
   return tmr / timer_frequency_in_khz;
 }
 
+static grub_uint64_t
+grub_efi_get_time_us (void)
+{
+  grub_uint64_t tmr;
+  asm volatile("mrs %0,   cntvct_el0" : "=r" (tmr));
+
+  return tmr * 1000 / timer_frequency_in_khz;
+}
+
 
 void
 grub_machine_init (void)
@@ -48,6 +57,7 @@ grub_machine_init (void)
   timer_frequency_in_khz = timer_frequency / 1000;
 
   grub_install_get_time_ms (grub_efi_get_time_ms);
+  grub_install_get_time_us (grub_efi_get_time_us);
 }
 
 void
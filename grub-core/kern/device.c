@@ -26,8 +26,10 @@
 #include <grub/env.h>
 #include <grub/partition.h>
 #include <grub/i18n.h>
+#include <grub/iostat.h>
 
 grub_net_t (*grub_net_open) (const char *name) = NULL;
+void (*grub_net_iostat) (grub_iostat_emit_t emit, void *data) = NULL;
 
 grub_device_t
 grub_device_open (const char *name)
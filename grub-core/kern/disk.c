@@ -25,6 +25,7 @@
 #include <grub/time.h>
 #include <grub/file.h>
 #include <grub/i18n.h>
+#include <grub/iostat.h>
 
 #define	GRUB_CACHE_TIMEOUT	2
 
@@ -34,6 +35,8 @@ static grub_uint64_t grub_last_time = 0;
 struct grub_disk_cache grub_disk_cache_table[GRUB_DISK_CACHE_NUM];
 
 void (*grub_disk_firmware_fini) (void);
+void (*grub_disk_read_notify) (grub_disk_t disk, grub_disk_addr_t sector,
+			       grub_off_t offset, grub_size_t size);
 int grub_disk_firmware_is_tainted;
 
 #if DISK_CACHE_STATS
@@ -70,6 +73,184 @@ grub_disk_cache_invalidate_all (void)
 	  cache->data = 0;
 	}
     }
+
+  grub_partition_cache_invalidate_all ();
+}
+
+/* Counters of every device opened so far.  Entries are never freed.  */
+static struct grub_disk_stats *grub_disk_stats_list;
+
+static struct grub_disk_stats *
+grub_disk_stats_get (grub_disk_t disk)
+{
+  struct grub_disk_stats *stats;
+
+  for (stats = grub_disk_stats_list; stats; stats = stats->next)
+    if (stats->dev_id == disk->dev->id && stats->disk_id == disk->id)
+      return stats;
+
+  /* Statistics are best effort; never fail the open because of them.  */
+  stats = grub_zalloc (sizeof (*stats));
+  if (stats)
+    stats->name = grub_strdup (disk->name);
+  if (!stats || !stats->name)
+    {
+      grub_free (stats);
+      grub_errno = GRUB_ERR_NONE;
+      return NULL;
+    }
+  stats->dev_id = disk->dev->id;
+  stats->disk_id = disk->id;
+  stats->next = grub_disk_stats_list;
+  grub_disk_stats_list = stats;
+  return stats;
+}
+
+void
+grub_disk_iostat (grub_iostat_emit_t emit, void *data)
+{
+  struct grub_disk_stats *stats;
+  unsigned i;
+
+  for (stats = grub_disk_stats_list; stats; stats = stats->next)
+    {
+      emit ("disk", stats->name, "reads", stats->reads, data);
+      emit ("disk", stats->name, "bytes", stats->bytes, data);
+      emit ("disk", stats->name, "cache_hits", stats->cache_hits, data);
+      emit ("disk", stats->name, "cache_misses", stats->cache_misses, data);
+      emit ("disk", stats->name, "dev_reads", stats->dev_reads, data);
+      emit ("disk", stats->name, "dev_sectors", stats->dev_sectors, data);
+      emit ("disk", stats->name, "dev_time_us", stats->dev_time_us, data);
+      for (i = 0; i < GRUB_DISK_STATS_SIZE_BUCKETS; i++)
+	{
+	  /* Bucket I holds reads of 2^(I+9) bytes up to twice that.  */
+	  static const char *const names[GRUB_DISK_STATS_SIZE_BUCKETS] =
+	    {
+	      "dev_reads_512", "dev_reads_1k", "dev_reads_2k", "dev_reads_4k",
+	      "dev_reads_8k", "dev_reads_16k", "dev_reads_32k",
+	      "dev_reads_64k", "dev_reads_128k", "dev_reads_256k",
+	      "dev_reads_512k", "dev_reads_1m"
+	    };
+
+	  if (stats->dev_read_sizes[i])
+	    emit ("disk", stats->name, names[i], stats->dev_read_sizes[i],
+		  data);
+	}
+    }
+}
+
+static struct grub_disk_trace_entry *grub_disk_trace_ring;
+static grub_size_t grub_disk_trace_size;
+/* Next slot to fill.  */
+static grub_size_t grub_disk_trace_head;
+static grub_uint64_t grub_disk_trace_total;
+static int grub_disk_trace_active;
+
+grub_err_t
+grub_disk_trace_start (grub_size_t entries)
+{
+  struct grub_disk_trace_entry *ring;
+
+  if (!entries)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, N_("invalid trace size"));
+
+  ring = grub_calloc (entries, sizeof (*ring));
+  if (!ring)
+    return grub_errno;
+
+  grub_disk_trace_active = 0;
+  grub_free (grub_disk_trace_ring);
+  grub_disk_trace_ring = ring;
+  grub_disk_trace_size = entries;
+  grub_disk_trace_head = 0;
+  grub_disk_trace_total = 0;
+  grub_disk_trace_active = 1;
+  return GRUB_ERR_NONE;
+}
+
+void
+grub_disk_trace_stop (void)
+{
+  grub_disk_trace_active = 0;
+}
+
+grub_uint64_t
+grub_disk_trace_iterate (int (*hook) (const struct grub_disk_trace_entry *entry,
+				      void *data),
+			 void *data)
+{
+  grub_size_t i, n, pos = 0;
+
+  n = grub_disk_trace_total < grub_disk_trace_size
+    ? (grub_size_t) grub_disk_trace_total : grub_disk_trace_size;
+  if (grub_disk_trace_total > grub_disk_trace_size)
+    pos = grub_disk_trace_head;
+
+  for (i = 0; i < n; i++)
+    {
+      if (hook (&grub_disk_trace_ring[pos], data))
+	break;
+      if (++pos == grub_disk_trace_size)
+	pos = 0;
+    }
+  return grub_disk_trace_total - n;
+}
+
+static void
+grub_disk_trace (grub_disk_t disk, enum grub_disk_trace_event event,
+		 grub_disk_addr_t sector, grub_size_t offset, grub_size_t size,
+		 const void *caller)
+{
+  struct grub_disk_trace_entry *entry;
+
+  entry = &grub_disk_trace_ring[grub_disk_trace_head];
+  if (++grub_disk_trace_head == grub_disk_trace_size)
+    grub_disk_trace_head = 0;
+  grub_disk_trace_total++;
+
+  entry->time_us = grub_get_time_us ();
+  entry->disk = disk->stats ? disk->stats->name : NULL;
+  entry->sector = sector;
+  entry->offset = offset;
+  entry->size = size;
+  entry->caller = caller;
+  entry->event = event;
+}
+
+/* Read from the device itself; every cache miss ends up here.  */
+static grub_err_t
+grub_disk_dev_read (grub_disk_t disk, grub_disk_addr_t sector,
+		    grub_size_t size, char *buf)
+{
+  struct grub_disk_stats *stats = disk->stats;
+  grub_uint64_t start = 0;
+  grub_err_t err;
+
+  if (stats)
+    start = grub_get_time_us ();
+  if (grub_disk_trace_active)
+    grub_disk_trace (disk, GRUB_DISK_TRACE_DEV, sector,
+		     0, size << disk->log_sector_size, NULL);
+  grub_boot_trace_begin ("disk", "read", disk->name);
+  err = (disk->dev->disk_read) (disk, sector, size, buf);
+  grub_boot_trace_end ("disk", "read", disk->name);
+
+  if (stats)
+    {
+      grub_uint64_t sectors;
+      unsigned bucket = 0;
+
+      sectors = (grub_uint64_t) size << (disk->log_sector_size
+					 - GRUB_DISK_SECTOR_BITS);
+      while (bucket < GRUB_DISK_STATS_SIZE_BUCKETS - 1
+	     && (sectors >> (bucket + 1)))
+	bucket++;
+      stats->dev_reads++;
+      stats->dev_sectors += sectors;
+      stats->dev_time_us += grub_get_time_us () - start;
+      stats->dev_read_sizes[bucket]++;
+    }
+  return err;
 }
 
 static char *
@@ -247,6 +428,7 @@ grub_disk_open (const char *name)
     }
 
   disk->dev = dev;
+  disk->stats = grub_disk_stats_get (disk);
 
   if (p)
     {
@@ -326,6 +508,17 @@ grub_disk_read_small_real (grub_disk_t disk, grub_disk_addr_t sector,
 
   /* Fetch the cache.  */
   data = grub_disk_cache_fetch (disk->dev->id, disk->id, sector);
+  if (disk->stats)
+    {
+      if (data)
+	disk->stats->cache_hits++;
+      else
+	disk->stats->cache_misses++;
+    }
+  if (grub_disk_trace_active)
+    grub_disk_trace (disk, data ? GRUB_DISK_TRACE_HIT : GRUB_DISK_TRACE_MISS,
+		     sector, 0, GRUB_DISK_CACHE_SIZE << GRUB_DISK_SECTOR_BITS,
+		     NULL);
   if (data)
     {
       /* Just copy it!  */
@@ -345,10 +538,10 @@ grub_disk_read_small_real (grub_disk_t disk, grub_disk_addr_t sector,
       < (disk->total_sectors << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS)))
     {
       grub_err_t err;
-      err = (disk->dev->disk_read) (disk, transform_sector (disk, sector),
-				    1U << (GRUB_DISK_CACHE_BITS
-					   + GRUB_DISK_SECTOR_BITS
-					   - disk->log_sector_size), tmp_buf);
+      err = grub_disk_dev_read (disk, transform_sector (disk, sector),
+				1U << (GRUB_DISK_CACHE_BITS
+				       + GRUB_DISK_SECTOR_BITS
+				       - disk->log_sector_size), tmp_buf);
       if (!err)
 	{
 	  /* Copy it and store it in the disk cache.  */
@@ -381,8 +574,8 @@ grub_disk_read_small_real (grub_disk_t disk, grub_disk_addr_t sector,
     if (!tmp_buf)
       return grub_errno;
     
-    if ((disk->dev->disk_read) (disk, transform_sector (disk, aligned_sector),
-				num, tmp_buf))
+    if (grub_disk_dev_read (disk, transform_sector (disk, aligned_sector),
+			    num, tmp_buf))
       {
 	grub_error_push ();
 	grub_dprintf ("disk", "%s read failed\n", disk->name);
@@ -412,6 +605,76 @@ grub_disk_read_small (grub_disk_t disk, grub_disk_addr_t sector,
   return GRUB_ERR_NONE;
 }
 
+/* Read data straight from the device, without touching the cache.  SECTOR
+   and OFFSET must already be adjusted by grub_disk_adjust_range.  */
+static grub_err_t
+grub_disk_read_uncached (grub_disk_t disk, grub_disk_addr_t sector,
+			 grub_off_t offset, grub_size_t size, void *buf)
+{
+  grub_disk_addr_t aligned_sector;
+  grub_size_t max;
+  grub_disk_addr_t start_sector = sector;
+  grub_off_t start_offset = offset;
+  grub_size_t start_size = size;
+
+  aligned_sector = (sector & ~((1ULL << (disk->log_sector_size
+					 - GRUB_DISK_SECTOR_BITS)) - 1));
+  offset += ((sector - aligned_sector) << GRUB_DISK_SECTOR_BITS);
+
+  max = (grub_size_t) (disk->max_agglomerate ? : 1)
+    << (GRUB_DISK_CACHE_BITS + GRUB_DISK_SECTOR_BITS);
+
+  while (size)
+    {
+      grub_size_t len, num;
+      char *tmp_buf = NULL;
+      grub_err_t err;
+
+      len = size + offset;
+      if (len > max)
+	len = max;
+      num = ((len + (1ULL << disk->log_sector_size) - 1)
+	     >> disk->log_sector_size);
+      len -= offset;
+
+      /* Only whole native sectors can be read in place.  */
+      if (offset || (len & ((1ULL << disk->log_sector_size) - 1)))
+	{
+	  tmp_buf = grub_malloc (num << disk->log_sector_size);
+	  if (!tmp_buf)
+	    return grub_errno;
+	}
+
+      err = grub_disk_dev_read (disk, transform_sector (disk, aligned_sector),
+				num, tmp_buf ? : (char *) buf);
+      if (err)
+	{
+	  grub_error_push ();
+	  grub_dprintf ("disk", "%s read failed\n", disk->name);
+	  grub_error_pop ();
+	  grub_free (tmp_buf);
+	  return err;
+	}
+
+      if (tmp_buf)
+	{
+	  grub_memcpy (buf, tmp_buf + offset, len);
+	  grub_free (tmp_buf);
+	}
+
+      aligned_sector += num << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS);
+      buf = (char *) buf + len;
+      size -= len;
+      offset = 0;
+    }
+
+  if (disk->read_hook)
+    (disk->read_hook) (start_sector, start_offset, start_size,
+		       disk->read_hook_data);
+
+  return GRUB_ERR_NONE;
+}
+
 /* Read data from the disk.  */
 grub_err_t
 grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
@@ -427,6 +690,20 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
       return grub_errno;
     }
 
+  if (disk->stats)
+    {
+      disk->stats->reads++;
+      disk->stats->bytes += size;
+    }
+  if (grub_disk_trace_active)
+    grub_disk_trace (disk, GRUB_DISK_TRACE_READ, sector, offset, size,
+		     __builtin_return_address (0));
+  if (grub_disk_read_notify)
+    grub_disk_read_notify (disk, sector, offset, size);
+
+  if (disk->nocache)
+    return grub_disk_read_uncached (disk, sector, offset, size, buf);
+
   /* First read until first cache boundary.   */
   if (offset || (sector & (GRUB_DISK_CACHE_SIZE - 1)))
     {
@@ -468,6 +745,19 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
 	  data = grub_disk_cache_fetch (disk->dev->id, disk->id,
 					sector + (agglomerate
 						  << GRUB_DISK_CACHE_BITS));
+	  if (disk->stats)
+	    {
+	      if (data)
+		disk->stats->cache_hits++;
+	      else
+		disk->stats->cache_misses++;
+	    }
+	  if (grub_disk_trace_active)
+	    grub_disk_trace (disk, data ? GRUB_DISK_TRACE_HIT
+			     : GRUB_DISK_TRACE_MISS,
+			     sector + (agglomerate << GRUB_DISK_CACHE_BITS), 0,
+			     GRUB_DISK_CACHE_SIZE << GRUB_DISK_SECTOR_BITS,
+			     NULL);
 	  if (data)
 	    break;
 	}
@@ -487,11 +777,11 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
 	{
 	  grub_disk_addr_t i;
 
-	  err = (disk->dev->disk_read) (disk, transform_sector (disk, sector),
-					agglomerate << (GRUB_DISK_CACHE_BITS
-							+ GRUB_DISK_SECTOR_BITS
-							- disk->log_sector_size),
-					buf);
+	  err = grub_disk_dev_read (disk, transform_sector (disk, sector),
+				    agglomerate << (GRUB_DISK_CACHE_BITS
+						    + GRUB_DISK_SECTOR_BITS
+						    - disk->log_sector_size),
+				    buf);
 	  if (err)
 	    return err;
 	  
@@ -168,6 +168,50 @@ grub_get_symbol_by_addr(const void *addr, int isfunc)
   return NULL;
 }
 
+/* Find the function containing ADDR.  The owning module is looked up from
+   its segments and the closest function symbol at or below ADDR that this
+   module (or the kernel, if no module owns ADDR) registered is returned.
+   Only exported symbols are known, so static functions are attributed to
+   the nearest preceding exported one.  */
+const char *
+grub_dl_addr_to_symbol (const void *addr, grub_dl_t *mod_out,
+			grub_size_t *offset)
+{
+  grub_dl_t mod, owner = NULL;
+  grub_symbol_t sym, best = NULL;
+  unsigned i;
+
+  FOR_DL_MODULES (mod)
+    {
+      grub_dl_segment_t seg;
+
+      for (seg = mod->segment; seg; seg = seg->next)
+	if (seg->addr <= addr
+	    && (const grub_uint8_t *) addr
+	       < (const grub_uint8_t *) seg->addr + seg->size)
+	  break;
+      if (seg)
+	{
+	  owner = mod;
+	  break;
+	}
+    }
+
+  for (i = 0; i < GRUB_SYMTAB_SIZE; i++)
+    for (sym = grub_symtab[i]; sym; sym = sym->next)
+      if (sym->isfunc && sym->mod == owner && sym->addr <= addr
+	  && (!best || best->addr < sym->addr))
+	best = sym;
+
+  if (mod_out)
+    *mod_out = owner;
+  if (!best)
+    return NULL;
+  if (offset)
+    *offset = (const grub_uint8_t *) addr - (const grub_uint8_t *) best->addr;
+  return best->name;
+}
+
 /* Register a symbol with the name NAME and the address ADDR.  */
 grub_err_t
 grub_dl_register_symbol (const char *name, void *addr, int isfunc,
@@ -880,7 +924,9 @@ grub_dl_load_core (void *addr, grub_size_t size)
     return NULL;
 
   grub_boot_time ("Initing module %s", mod->name);
+  grub_boot_trace_begin ("dl", "init", mod->name);
   grub_dl_init (mod);
+  grub_boot_trace_end ("dl", "init", mod->name);
   grub_boot_time ("Module %s inited", mod->name);
 
   return mod;
@@ -914,8 +960,20 @@ grub_dl_load_file (const char *filename)
   if (! file)
     return 0;
 
+  /* Compressed modules go through the decompression filters, which know
+     the size of their contents.  xzio decodes straight into CORE only
+     when no verifier is active; otherwise the verifier has already read
+     the whole module into its own buffer and CORE is copied from it.  */
+  if (grub_file_size (file) == GRUB_FILE_SIZE_UNKNOWN)
+    {
+      grub_file_close (file);
+      grub_error (GRUB_ERR_BAD_MODULE, N_("size of module `%s' is unknown"),
+		  filename);
+      return 0;
+    }
+
   size = grub_file_size (file);
-  core = grub_malloc (size);
+  core = grub_bulk_alloc (size);
   if (! core)
     {
       grub_file_close (file);
@@ -925,7 +983,7 @@ grub_dl_load_file (const char *filename)
   if (grub_file_read (file, core, size) != (int) size)
     {
       grub_file_close (file);
-      grub_free (core);
+      grub_bulk_free (core);
       return 0;
     }
 
@@ -935,7 +993,7 @@ grub_dl_load_file (const char *filename)
   grub_file_close (file);
 
   mod = grub_dl_load_core (core, size);
-  grub_free (core);
+  grub_bulk_free (core);
   if (! mod)
     return 0;
 
@@ -968,7 +1026,9 @@ grub_dl_load (const char *name)
   if (! filename)
     return 0;
 
+  grub_boot_trace_begin ("dl", "load", name);
   mod = grub_dl_load_file (filename);
+  grub_boot_trace_end ("dl", "load", name);
   grub_free (filename);
 
   if (! mod)
@@ -160,6 +160,7 @@ shim_lock_verifier_init (grub_file_t io __attribute__ ((unused)),
     case GRUB_FILE_TYPE_FS_SEARCH:
     case GRUB_FILE_TYPE_LOADENV:
     case GRUB_FILE_TYPE_SAVEENV:
+    case GRUB_FILE_TYPE_PREFETCH_LIST:
     case GRUB_FILE_TYPE_VERIFY_SIGNATURE:
       *flags = GRUB_VERIFY_FLAGS_SKIP_VERIFICATION;
       return GRUB_ERR_NONE;
@@ -195,6 +195,70 @@ static struct argp argp = {
 
 
 
+#if MM_PROFILE
+struct site_list
+{
+  struct grub_mm_profile_site *sites;
+  size_t count, alloc;
+};
+
+static int
+count_site (const struct grub_mm_profile_site *site, void *data)
+{
+  struct site_list *list = data;
+
+  if (site->live)
+    list->alloc++;
+  return 0;
+}
+
+static int
+copy_site (const struct grub_mm_profile_site *site, void *data)
+{
+  struct site_list *list = data;
+
+  if (site->live && list->count < list->alloc)
+    list->sites[list->count++] = *site;
+  return 0;
+}
+
+static int
+compare_live (const void *a, const void *b)
+{
+  const struct grub_mm_profile_site *sa = a, *sb = b;
+
+  if (sa->live != sb->live)
+    return sa->live < sb->live ? 1 : -1;
+  return 0;
+}
+
+/* Tell which call sites still hold memory, which at exit means they leaked
+   it unless the memory is meant to live forever.  */
+static void
+report_allocations (void)
+{
+  struct site_list list = { 0 };
+  grub_size_t live, peak;
+  size_t i;
+
+  grub_mm_profile_totals (&live, &peak);
+  fprintf (stderr, "heap: %" PRIuGRUB_SIZE " bytes still allocated, %"
+	   PRIuGRUB_SIZE " at most\n", live, peak);
+
+  grub_mm_profile_iterate (count_site, &list);
+  list.sites = xcalloc (list.alloc + 1, sizeof (list.sites[0]));
+  grub_mm_profile_iterate (copy_site, &list);
+  qsort (list.sites, list.count, sizeof (list.sites[0]), compare_live);
+
+  for (i = 0; i < list.count; i++)
+    fprintf (stderr, "%12" PRIuGRUB_SIZE " bytes in %lu blocks from %s:%d\n",
+	     list.sites[i].live,
+	     list.sites[i].allocs - list.sites[i].frees,
+	     list.sites[i].file, list.sites[i].line);
+  free (list.sites);
+}
+#endif
+
 #pragma GCC diagnostic ignored "-Wmissing-prototypes"
 
 int
@@ -289,5 +353,9 @@ main (int argc, char *argv[])
 
   grub_machine_fini (GRUB_LOADER_FLAG_NORETURN);
 
+#if MM_PROFILE
+  report_allocations ();
+#endif
+
   return 0;
 }
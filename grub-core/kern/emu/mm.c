@@ -25,6 +25,14 @@
 #include <string.h>
 #include <grub/i18n.h>
 
+#if MM_PROFILE
+# undef grub_calloc
+# undef grub_malloc
+# undef grub_zalloc
+# undef grub_realloc
+# undef grub_free
+#endif
+
 void *
 grub_calloc (grub_size_t nmemb, grub_size_t size)
 {
@@ -64,6 +72,18 @@ grub_free (void *ptr)
     free (ptr);
 }
 
+void *
+grub_bulk_alloc (grub_size_t size)
+{
+  return grub_malloc (size);
+}
+
+void
+grub_bulk_free (void *ptr)
+{
+  grub_free (ptr);
+}
+
 void *
 grub_realloc (void *ptr, grub_size_t size)
 {
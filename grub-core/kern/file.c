@@ -25,16 +25,36 @@
 #include <grub/fs.h>
 #include <grub/device.h>
 #include <grub/i18n.h>
+#include <grub/iostat.h>
+#include <grub/time.h>
 
 void (*EXPORT_VAR (grub_grubnet_fini)) (void);
 
 grub_file_filter_t grub_file_filters[GRUB_FILE_FILTER_MAX];
 
+/* Counters of the most recently closed files, oldest overwritten first.  */
+#define GRUB_FILE_STATS_NUM	32
+#define GRUB_FILE_STATS_NAME	48
+
+struct grub_file_stats
+{
+  char name[GRUB_FILE_STATS_NAME];
+  grub_uint64_t reads;
+  grub_uint64_t bytes;
+  grub_uint64_t time_us;
+  grub_uint64_t size;
+};
+
+static struct grub_file_stats grub_file_stats[GRUB_FILE_STATS_NUM];
+static unsigned grub_file_stats_next;
+
 static const char *filter_names[] = {
+    [GRUB_FILE_FILTER_PREFETCH] = "GRUB_FILE_FILTER_PREFETCH",
     [GRUB_FILE_FILTER_VERIFY] = "GRUB_FILE_FILTER_VERIFY",
     [GRUB_FILE_FILTER_GZIO] = "GRUB_FILE_FILTER_GZIO",
     [GRUB_FILE_FILTER_XZIO] = "GRUB_FILE_FILTER_XZIO",
     [GRUB_FILE_FILTER_LZOPIO] = "GRUB_FILE_FILTER_LZOPIO",
+    [GRUB_FILE_FILTER_VERIFY_CONTENT] = "GRUB_FILE_FILTER_VERIFY_CONTENT",
     [GRUB_FILE_FILTER_MAX] = "GRUB_FILE_FILTER_MAX"
 };
 
@@ -75,6 +95,7 @@ grub_file_open (const char *name, enum grub_file_type type)
   grub_file_filter_id_t filter;
 
   grub_dprintf ("file", "Opening `%s' ...\n", name);
+  grub_boot_trace_begin ("fs", "open", name);
 
   /* Reset grub_errno before we start */
   grub_errno = GRUB_ERR_NONE;
@@ -135,7 +156,11 @@ grub_file_open (const char *name, enum grub_file_type type)
 	if (filter < GRUB_FILE_FILTER_MAX)
 	  grub_dprintf ("file", "Running %s file filter\n",
 			filter_names[filter]);
+	grub_boot_trace_begin ("fs", "filter", filter_names[filter]
+			       + sizeof ("GRUB_FILE_FILTER_") - 1);
 	file = grub_file_filters[filter] (file, type);
+	grub_boot_trace_end ("fs", "filter", filter_names[filter]
+			     + sizeof ("GRUB_FILE_FILTER_") - 1);
 	if (file && file != last_file)
 	  {
 	    file->name = grub_strdup (name);
@@ -146,6 +171,7 @@ grub_file_open (const char *name, enum grub_file_type type)
     grub_file_close (last_file);
 
   grub_dprintf ("file", "Opening `%s' succeeded.\n", name);
+  grub_boot_trace_end ("fs", "open", name);
 
   return file;
 
@@ -159,6 +185,7 @@ grub_file_open (const char *name, enum grub_file_type type)
   grub_free (file);
 
   grub_dprintf ("file", "Opening `%s' failed.\n", name);
+  grub_boot_trace_end ("fs", "open", name);
 
   return 0;
 }
@@ -171,6 +198,7 @@ grub_file_read (grub_file_t file, void *buf, grub_size_t len)
   grub_ssize_t res;
   grub_disk_read_hook_t read_hook;
   void *read_hook_data;
+  grub_uint64_t start;
 
   if (len == 0)
     return 0;
@@ -204,19 +232,80 @@ grub_file_read (grub_file_t file, void *buf, grub_size_t len)
       file->read_hook_data = file;
       file->progress_offset = file->offset;
     }
+  start = grub_get_time_us ();
   res = (file->fs->fs_read) (file, buf, len);
+  file->stat_time_us += grub_get_time_us () - start;
+  file->stat_reads++;
   file->read_hook = read_hook;
   file->read_hook_data = read_hook_data;
   if (res > 0)
-    file->offset += res;
+    {
+      file->offset += res;
+      file->stat_bytes += res;
+    }
 
   return res;
 }
 
+/* Remember the counters of FILE.  Filters show up as separate entries
+   named after the filter, so compressed and verified files can be told
+   apart from the raw reads underneath.  */
+static void
+grub_file_stats_record (grub_file_t file)
+{
+  struct grub_file_stats *st;
+  const char *name = file->name ? : "";
+  grub_size_t len;
+
+  if (!file->stat_reads)
+    return;
+
+  st = &grub_file_stats[grub_file_stats_next++ % GRUB_FILE_STATS_NUM];
+  len = grub_strlen (name);
+  /* Keep the end of long paths, the file name is what matters.  */
+  if (len >= GRUB_FILE_STATS_NAME)
+    grub_snprintf (st->name, sizeof (st->name), "...%s",
+		   name + len - (GRUB_FILE_STATS_NAME - 4));
+  else
+    grub_strcpy (st->name, name);
+  if (file->fs && file->fs->name)
+    {
+      len = grub_strlen (st->name);
+      grub_snprintf (st->name + len, sizeof (st->name) - len, " [%s]",
+		     file->fs->name);
+    }
+  st->reads = file->stat_reads;
+  st->bytes = file->stat_bytes;
+  st->time_us = file->stat_time_us;
+  st->size = file->size;
+}
+
+void
+grub_file_iostat (grub_iostat_emit_t emit, void *data)
+{
+  unsigned i, n;
+
+  n = grub_file_stats_next < GRUB_FILE_STATS_NUM ? grub_file_stats_next
+    : GRUB_FILE_STATS_NUM;
+  for (i = 0; i < n; i++)
+    {
+      struct grub_file_stats *st;
+
+      st = &grub_file_stats[(grub_file_stats_next - n + i)
+			    % GRUB_FILE_STATS_NUM];
+      emit ("file", st->name, "reads", st->reads, data);
+      emit ("file", st->name, "bytes", st->bytes, data);
+      emit ("file", st->name, "time_us", st->time_us, data);
+      if (st->size != GRUB_FILE_SIZE_UNKNOWN)
+	emit ("file", st->name, "size", st->size, data);
+    }
+}
+
 grub_err_t
 grub_file_close (grub_file_t file)
 {
   grub_dprintf ("file", "Closing `%s' ...\n", file->name);
+  grub_file_stats_record (file);
   if (file->fs->fs_close)
     (file->fs->fs_close) (file);
 
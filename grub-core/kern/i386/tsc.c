@@ -43,6 +43,19 @@ grub_tsc_get_time_ms (void)
   return ((al * grub_tsc_rate) >> 32) + ah * grub_tsc_rate;
 }
 
+static grub_uint64_t
+grub_tsc_get_time_us (void)
+{
+  grub_uint64_t a = grub_get_tsc () - tsc_boot_time;
+  grub_uint64_t ah = a >> 32;
+  grub_uint64_t al = a & 0xffffffff;
+
+  /* Keep 10 fractional bits of the millisecond part so that the
+     multiplication by 1000 can't overflow.  */
+  return ((((al * grub_tsc_rate) >> 22) * 1000) >> 10)
+    + ah * grub_tsc_rate * 1000;
+}
+
 static int
 calibrate_tsc_hardcode (void)
 {
@@ -75,4 +88,5 @@ grub_tsc_init (void)
   (void) (grub_tsc_calibrate_from_pit () || calibrate_tsc_hardcode());
 #endif
   grub_install_get_time_ms (grub_tsc_get_time_ms);
+  grub_install_get_time_us (grub_tsc_get_time_us);
 }
@@ -24,6 +24,7 @@
 #include <grub/term.h>
 #include <grub/file.h>
 #include <grub/device.h>
+#include <grub/fs.h>
 #include <grub/env.h>
 #include <grub/mm.h>
 #include <grub/command.h>
@@ -285,6 +286,91 @@ grub_set_prefix_and_root (void)
   grub_print_error ();
 }
 
+static int
+find_prefetch_list (const char *filename,
+		    const struct grub_dirhook_info *info, void *data)
+{
+  int *found = data;
+
+  if (info->dir)
+    return 0;
+  if (info->case_insensitive ? grub_strcasecmp (filename, "prefetch") == 0
+      : grub_strcmp (filename, "prefetch") == 0)
+    {
+      *found = 1;
+      return 1;
+    }
+  return 0;
+}
+
+/* Look for the list in the directory PREFIX instead of opening it, so
+   that a boot without the list doesn't load the prefetch module and a
+   boot with it doesn't open the list twice.  */
+static int
+prefetch_list_exists (const char *prefix)
+{
+  grub_device_t dev;
+  grub_fs_t fs;
+  char *device_name;
+  const char *path;
+  int found = 0;
+
+  device_name = grub_file_get_device_name (prefix);
+  if (grub_errno)
+    return 0;
+
+  path = grub_strchr (prefix, ')');
+  path = path ? path + 1 : prefix;
+  if (! *path)
+    path = "/";
+
+  dev = grub_device_open (device_name);
+  grub_free (device_name);
+  if (! dev)
+    return 0;
+
+  fs = grub_fs_probe (dev);
+  if (fs)
+    (fs->fs_dir) (dev, path, find_prefetch_list, &found);
+  grub_device_close (dev);
+
+  return found;
+}
+
+/* Warm the disk cache with what the previous boot read before normal mode
+   is loaded, so that normal.mod, its dependencies, the config file, fonts
+   and themes all come from one sorted pass over the disk.  The feature is
+   on when the list exists next to grubenv.  */
+static void
+grub_prefetch_early (void)
+{
+  const char *prefix;
+  char *list;
+
+  prefix = grub_env_get ("prefix");
+  if (! prefix || ! prefetch_list_exists (prefix))
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  list = grub_xasprintf ("%s/prefetch", prefix);
+  if (! list)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  if (grub_dl_load ("prefetch"))
+    {
+      char *argv[] = { (char *) "load", list, NULL };
+
+      grub_command_execute ("prefetch", 2, argv);
+    }
+  grub_free (list);
+  grub_errno = GRUB_ERR_NONE;
+}
+
 /* Load the normal mode module and execute the normal mode if possible.  */
 static void
 grub_load_normal_mode (void)
@@ -376,6 +462,7 @@ grub_main (void)
 
   grub_boot_time ("After execution of embedded config. Attempt to go to normal mode");
 
+  grub_prefetch_early ();
   grub_load_normal_mode ();
   grub_rescue_run ();
 }
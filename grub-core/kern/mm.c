@@ -72,7 +72,7 @@
 #include <grub/mm_private.h>
 #include <grub/safemath.h>
 
-#ifdef MM_DEBUG
+#if defined (MM_DEBUG) || MM_PROFILE
 # undef grub_calloc
 # undef grub_malloc
 # undef grub_zalloc
@@ -128,6 +128,18 @@
 
 grub_mm_region_t grub_mm_base;
 grub_mm_add_region_func_t grub_mm_add_region_fn;
+grub_mm_alloc_pages_func_t grub_mm_alloc_pages_fn;
+grub_mm_free_pages_func_t grub_mm_free_pages_fn;
+
+/* A buffer from grub_bulk_alloc() which lives outside of the heap.  */
+struct grub_mm_bulk
+{
+  struct grub_mm_bulk *next;
+  void *addr;
+  grub_size_t size;
+};
+
+static struct grub_mm_bulk *grub_mm_bulk_list;
 
 /* Get a header from the pointer PTR, and set *P and *R to a pointer
    to the header and a pointer to its region, respectively. PTR must
@@ -722,6 +734,59 @@ grub_realloc (void *ptr, grub_size_t size)
   return q;
 }
 
+/* Allocate SIZE bytes for a large buffer that is freed again soon, such as
+   a whole file being read.  Taking these from the firmware keeps them from
+   growing and fragmenting the heap.  The buffer must be freed with
+   grub_bulk_free().  */
+void *
+grub_bulk_alloc (grub_size_t size)
+{
+  struct grub_mm_bulk *bulk;
+
+  if (size < GRUB_MM_BULK_MIN || grub_mm_alloc_pages_fn == NULL)
+    return grub_malloc (size);
+
+  bulk = grub_malloc (sizeof (*bulk));
+  if (bulk == NULL)
+    return NULL;
+
+  bulk->addr = grub_mm_alloc_pages_fn (size);
+  if (bulk->addr == NULL)
+    {
+      /* The heap may still have room, or be able to grow.  */
+      grub_free (bulk);
+      grub_errno = GRUB_ERR_NONE;
+      return grub_malloc (size);
+    }
+
+  bulk->size = size;
+  bulk->next = grub_mm_bulk_list;
+  grub_mm_bulk_list = bulk;
+  return bulk->addr;
+}
+
+/* Deallocate PTR, which was returned by grub_bulk_alloc().  */
+void
+grub_bulk_free (void *ptr)
+{
+  struct grub_mm_bulk **prev, *bulk;
+
+  if (ptr == NULL)
+    return;
+
+  for (prev = &grub_mm_bulk_list; *prev != NULL; prev = &(*prev)->next)
+    if ((*prev)->addr == ptr)
+      {
+	bulk = *prev;
+	*prev = bulk->next;
+	grub_mm_free_pages_fn (bulk->addr, bulk->size);
+	grub_free (bulk);
+	return;
+      }
+
+  grub_free (ptr);
+}
+
 #ifdef MM_DEBUG
 int grub_mm_debug = 0;
 
@@ -0,0 +1,379 @@
+/* mm_profile.c - account heap allocations to their call sites.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <grub/mm.h>
+#include <grub/misc.h>
+#include <grub/types.h>
+
+#if MM_PROFILE && !defined (GRUB_UTIL)
+
+/* The tables below are allocated from the heap itself, without being
+   accounted.  */
+# undef grub_calloc
+# undef grub_malloc
+# undef grub_zalloc
+# undef grub_realloc
+# undef grub_free
+# undef grub_memalign
+
+/*
+ * Sites live in a dense array so that the live allocations can refer to
+ * them by index, and are found through an open addressing hash table of
+ * these indices.  File names are copied, since the call site may be in a
+ * module that is unloaded later.
+ *
+ * Every live allocation is kept in a second open addressing table keyed
+ * by its address, which tells its size and site when it is freed.
+ * Pointers allocated or freed by code that bypasses these wrappers, such
+ * as the allocator itself, are simply not found.
+ */
+struct live_alloc
+{
+  void *ptr;
+  grub_size_t size;
+  grub_uint32_t site;
+};
+
+#define SITE_NONE	((grub_uint32_t) -1)
+
+static struct grub_mm_profile_site *sites;
+static grub_uint32_t nsites, sites_alloc;
+
+/* Site index plus one, zero for an empty slot.  */
+static grub_uint32_t *site_hash;
+static grub_uint32_t site_hash_size;
+
+static struct live_alloc *live;
+static grub_size_t live_size, live_count;
+
+static grub_size_t total_live, total_peak;
+
+static grub_uint32_t
+hash_site (const char *file, int line)
+{
+  grub_uint32_t h = 2166136261U;
+
+  while (*file)
+    h = (h ^ (grub_uint8_t) *file++) * 16777619U;
+  return h ^ ((grub_uint32_t) line * 2654435761U);
+}
+
+static grub_size_t
+hash_ptr (const void *ptr)
+{
+  grub_addr_t a = (grub_addr_t) ptr >> 4;
+
+  return (grub_size_t) (a ^ (a >> 15)) * 2654435761U;
+}
+
+static int
+grow_site_hash (void)
+{
+  grub_uint32_t *n, size, i, j;
+
+  size = site_hash_size ? site_hash_size * 2 : 256;
+  n = grub_calloc (size, sizeof (n[0]));
+  if (!n)
+    return 0;
+
+  for (i = 0; i < nsites; i++)
+    {
+      j = hash_site (sites[i].file, sites[i].line) & (size - 1);
+      while (n[j])
+	j = (j + 1) & (size - 1);
+      n[j] = i + 1;
+    }
+
+  grub_free (site_hash);
+  site_hash = n;
+  site_hash_size = size;
+  return 1;
+}
+
+static grub_uint32_t
+find_site (const char *file, int line)
+{
+  struct grub_mm_profile_site *site;
+  grub_uint32_t i;
+  grub_size_t len;
+  char *copy;
+
+  if (site_hash_size)
+    for (i = hash_site (file, line) & (site_hash_size - 1); site_hash[i];
+	 i = (i + 1) & (site_hash_size - 1))
+      {
+	site = &sites[site_hash[i] - 1];
+	if (site->line == line && grub_strcmp (site->file, file) == 0)
+	  return site_hash[i] - 1;
+      }
+
+  /* Keep the hash table at most half full.  */
+  if (2 * (nsites + 1) > site_hash_size && !grow_site_hash ())
+    return SITE_NONE;
+
+  if (nsites == sites_alloc)
+    {
+      struct grub_mm_profile_site *n;
+
+      n = grub_realloc (sites, (sites_alloc ? 2 * sites_alloc : 128)
+			* sizeof (sites[0]));
+      if (!n)
+	return SITE_NONE;
+      sites = n;
+      sites_alloc = sites_alloc ? 2 * sites_alloc : 128;
+    }
+
+  len = grub_strlen (file) + 1;
+  copy = grub_malloc (len);
+  if (!copy)
+    return SITE_NONE;
+  grub_memcpy (copy, file, len);
+
+  site = &sites[nsites];
+  grub_memset (site, 0, sizeof (*site));
+  site->file = copy;
+  site->line = line;
+
+  for (i = hash_site (file, line) & (site_hash_size - 1); site_hash[i];
+       i = (i + 1) & (site_hash_size - 1))
+    ;
+  site_hash[i] = ++nsites;
+  return nsites - 1;
+}
+
+static struct live_alloc *
+find_live (void *ptr)
+{
+  grub_size_t i;
+
+  if (!live_size)
+    return NULL;
+
+  for (i = hash_ptr (ptr) & (live_size - 1); live[i].ptr;
+       i = (i + 1) & (live_size - 1))
+    if (live[i].ptr == ptr)
+      return &live[i];
+  return NULL;
+}
+
+static int
+grow_live (void)
+{
+  struct live_alloc *n;
+  grub_size_t size, i, j;
+
+  size = live_size ? live_size * 2 : 4096;
+  n = grub_calloc (size, sizeof (n[0]));
+  if (!n)
+    return 0;
+
+  for (i = 0; i < live_size; i++)
+    if (live[i].ptr)
+      {
+	for (j = hash_ptr (live[i].ptr) & (size - 1); n[j].ptr;
+	     j = (j + 1) & (size - 1))
+	  ;
+	n[j] = live[i];
+      }
+
+  grub_free (live);
+  live = n;
+  live_size = size;
+  return 1;
+}
+
+/* Remove ENTRY from the table, moving up the entries of its cluster that
+   would no longer be found otherwise.  */
+static void
+remove_live (struct live_alloc *entry)
+{
+  grub_size_t hole = entry - live, i, want;
+
+  live[hole].ptr = NULL;
+  live_count--;
+
+  for (i = (hole + 1) & (live_size - 1); live[i].ptr;
+       i = (i + 1) & (live_size - 1))
+    {
+      want = hash_ptr (live[i].ptr) & (live_size - 1);
+      /* Move the entry if its wanted slot isn't between the hole and it,
+	 cyclically.  */
+      if ((i > hole && (want <= hole || want > i))
+	  || (i < hole && want <= hole && want > i))
+	{
+	  live[hole] = live[i];
+	  live[i].ptr = NULL;
+	  hole = i;
+	}
+    }
+}
+
+static void
+record_free (void *ptr)
+{
+  struct live_alloc *entry;
+  struct grub_mm_profile_site *site;
+
+  if (!ptr)
+    return;
+
+  entry = find_live (ptr);
+  if (!entry)
+    return;
+
+  site = &sites[entry->site];
+  site->frees++;
+  site->live -= entry->size;
+  total_live -= entry->size;
+  remove_live (entry);
+}
+
+static void
+record_alloc (const char *file, int line, void *ptr, grub_size_t size)
+{
+  struct grub_mm_profile_site *site;
+  grub_err_t saved_errno = grub_errno;
+  grub_uint32_t id;
+  grub_size_t i;
+  unsigned bucket;
+
+  if (!ptr)
+    return;
+
+  /* Freed behind our back and handed out again.  */
+  record_free (ptr);
+
+  id = find_site (file, line);
+  if (id == SITE_NONE)
+    goto fail;
+
+  if (2 * (live_count + 1) > live_size && !grow_live ())
+    goto fail;
+
+  for (i = hash_ptr (ptr) & (live_size - 1); live[i].ptr;
+       i = (i + 1) & (live_size - 1))
+    ;
+  live[i].ptr = ptr;
+  live[i].size = size;
+  live[i].site = id;
+  live_count++;
+
+  site = &sites[id];
+  site->allocs++;
+  site->live += size;
+  if (site->live > site->peak)
+    site->peak = site->live;
+  for (bucket = 0; bucket < GRUB_MM_PROFILE_BUCKETS - 1; bucket++)
+    if (size < GRUB_MM_PROFILE_BUCKET_LIMIT (bucket))
+      break;
+  site->sizes[bucket]++;
+
+  total_live += size;
+  if (total_live > total_peak)
+    total_peak = total_live;
+  return;
+
+ fail:
+  /* The allocation itself succeeded; only its accounting is lost.  */
+  grub_errno = saved_errno;
+}
+
+void *
+grub_profile_calloc (const char *file, int line, grub_size_t nmemb,
+		     grub_size_t size)
+{
+  void *ptr = grub_calloc (nmemb, size);
+
+  /* grub_calloc() has already refused overflowing sizes.  */
+  if (ptr)
+    record_alloc (file, line, ptr, nmemb * size);
+  return ptr;
+}
+
+void *
+grub_profile_malloc (const char *file, int line, grub_size_t size)
+{
+  void *ptr = grub_malloc (size);
+
+  record_alloc (file, line, ptr, size);
+  return ptr;
+}
+
+void *
+grub_profile_zalloc (const char *file, int line, grub_size_t size)
+{
+  void *ptr = grub_zalloc (size);
+
+  record_alloc (file, line, ptr, size);
+  return ptr;
+}
+
+void *
+grub_profile_realloc (const char *file, int line, void *ptr,
+		      grub_size_t size)
+{
+  void *ret = grub_realloc (ptr, size);
+
+  /* On failure PTR is still allocated.  */
+  if (ret || !size)
+    {
+      record_free (ptr);
+      record_alloc (file, line, ret, size);
+    }
+  return ret;
+}
+
+#ifndef GRUB_MACHINE_EMU
+void *
+grub_profile_memalign (const char *file, int line, grub_size_t align,
+		       grub_size_t size)
+{
+  void *ptr = grub_memalign (align, size);
+
+  record_alloc (file, line, ptr, size);
+  return ptr;
+}
+#endif
+
+void
+grub_profile_free (void *ptr)
+{
+  record_free (ptr);
+  grub_free (ptr);
+}
+
+void
+grub_mm_profile_iterate (grub_mm_profile_hook_t hook, void *data)
+{
+  grub_uint32_t i;
+
+  for (i = 0; i < nsites; i++)
+    if (hook (&sites[i], data))
+      break;
+}
+
+void
+grub_mm_profile_totals (grub_size_t *live_bytes, grub_size_t *peak_bytes)
+{
+  *live_bytes = total_live;
+  *peak_bytes = total_peak;
+}
+
+#endif /* MM_PROFILE && ! GRUB_UTIL */
@@ -28,6 +28,106 @@
 
 grub_partition_map_t grub_partition_map_list;
 
+/* The parsed partition tree of a whole disk, so that opening partitions
+   and iterating over them doesn't read and parse the partition tables
+   over and over again.  Keyed like the disk cache and dropped together
+   with it, on a write to the disk and when a partition map is
+   registered or unregistered.  */
+struct grub_partition_cache_node
+{
+  /* PART.PARENT points to the node of the parent partition.  */
+  struct grub_partition part;
+  struct grub_partition_cache_node *next;
+};
+
+/* The outcome of running one partition map on the disk or on one of
+   its partitions.  */
+struct grub_partition_cache_scan
+{
+  grub_partition_t parent;
+  grub_partition_map_t partmap;
+  grub_err_t err;
+  struct grub_partition_cache_scan *next;
+};
+
+struct grub_partition_cache
+{
+  struct grub_partition_cache *next;
+  unsigned long dev_id;
+  unsigned long disk_id;
+  /* Partitions in the order grub_partition_iterate reports them.  */
+  struct grub_partition_cache_node *parts;
+  struct grub_partition_cache_scan *scans;
+  /* A hook or a memory allocation may invalidate the cache while it is
+     in use, in which case it is freed by the last user.  */
+  unsigned refs;
+  int stale;
+};
+
+#define GRUB_PARTITION_CACHE_MAX	32
+
+static struct grub_partition_cache *grub_partition_cache_list;
+static unsigned grub_partition_cache_count;
+
+static void
+grub_partition_cache_free (struct grub_partition_cache *cache)
+{
+  struct grub_partition_cache_node *node, *next_node;
+  struct grub_partition_cache_scan *scan, *next_scan;
+
+  for (node = cache->parts; node; node = next_node)
+    {
+      next_node = node->next;
+      grub_free (node);
+    }
+  for (scan = cache->scans; scan; scan = next_scan)
+    {
+      next_scan = scan->next;
+      grub_free (scan);
+    }
+  grub_free (cache);
+}
+
+static void
+grub_partition_cache_unlink (struct grub_partition_cache **prev)
+{
+  struct grub_partition_cache *cache = *prev;
+
+  *prev = cache->next;
+  grub_partition_cache_count--;
+  if (cache->refs)
+    cache->stale = 1;
+  else
+    grub_partition_cache_free (cache);
+}
+
+static void
+grub_partition_cache_release (struct grub_partition_cache *cache)
+{
+  if (--cache->refs == 0 && cache->stale)
+    grub_partition_cache_free (cache);
+}
+
+void
+grub_partition_cache_invalidate (unsigned long dev_id, unsigned long disk_id)
+{
+  struct grub_partition_cache **prev;
+
+  for (prev = &grub_partition_cache_list; *prev; prev = &(*prev)->next)
+    if ((*prev)->dev_id == dev_id && (*prev)->disk_id == disk_id)
+      {
+	grub_partition_cache_unlink (prev);
+	return;
+      }
+}
+
+void
+grub_partition_cache_invalidate_all (void)
+{
+  while (grub_partition_cache_list)
+    grub_partition_cache_unlink (&grub_partition_cache_list);
+}
+
 /*
  * Checks that disk->partition contains part.  This function assumes that the
  * start of part is relative to the start of disk->partition.  Returns 1 if
@@ -59,6 +159,226 @@ grub_partition_check_containment (const grub_disk_t disk,
   return 1;
 }
 
+/* Context for grub_partition_cache_get.  */
+struct grub_partition_cache_build_ctx
+{
+  struct grub_partition_cache_node **tail;
+  struct grub_partition_cache_scan **scan_tail;
+  int failed;
+};
+
+static void
+grub_partition_cache_scan (grub_disk_t dsk,
+			   struct grub_partition_cache_build_ctx *ctx);
+
+/* Helper for grub_partition_cache_scan.  Mirrors part_iterate.  */
+static int
+cache_record (grub_disk_t dsk, const grub_partition_t partition, void *data)
+{
+  struct grub_partition_cache_build_ctx *ctx = data;
+  struct grub_partition_cache_node *node;
+
+  if (!(grub_partition_check_containment (dsk, partition)))
+    return 0;
+
+  node = grub_malloc (sizeof (*node));
+  if (!node)
+    {
+      ctx->failed = 1;
+      return 1;
+    }
+  node->part = *partition;
+  node->part.parent = dsk->partition;
+  node->next = NULL;
+  *ctx->tail = node;
+  ctx->tail = &node->next;
+
+  if (node->part.start != 0)
+    {
+      dsk->partition = &node->part;
+      grub_partition_cache_scan (dsk, ctx);
+      dsk->partition = node->part.parent;
+    }
+  return ctx->failed;
+}
+
+/* Run every partition map on DSK->PARTITION, or the whole disk.  */
+static void
+grub_partition_cache_scan (grub_disk_t dsk,
+			   struct grub_partition_cache_build_ctx *ctx)
+{
+  grub_partition_map_t partmap;
+
+  FOR_PARTITION_MAPS(partmap)
+  {
+    struct grub_partition_cache_scan *scan;
+    grub_err_t err;
+
+    err = partmap->iterate (dsk, cache_record, ctx);
+    grub_errno = GRUB_ERR_NONE;
+    /* Don't remember failures that may go away on the next try.  */
+    if (ctx->failed || err == GRUB_ERR_READ_ERROR
+	|| err == GRUB_ERR_OUT_OF_MEMORY)
+      {
+	ctx->failed = 1;
+	return;
+      }
+
+    scan = grub_malloc (sizeof (*scan));
+    if (!scan)
+      {
+	grub_errno = GRUB_ERR_NONE;
+	ctx->failed = 1;
+	return;
+      }
+    scan->parent = dsk->partition;
+    scan->partmap = partmap;
+    scan->err = err;
+    scan->next = NULL;
+    *ctx->scan_tail = scan;
+    ctx->scan_tail = &scan->next;
+  }
+}
+
+/* Return the partition tree of DISK, parsing it if it isn't cached yet,
+   or NULL if it can't be cached.  The caller must release it.  */
+static struct grub_partition_cache *
+grub_partition_cache_get (grub_disk_t disk)
+{
+  struct grub_partition_cache **prev, *cache;
+  struct grub_partition_cache_build_ctx ctx;
+
+  if (disk->partition)
+    return NULL;
+
+  for (prev = &grub_partition_cache_list; *prev; prev = &(*prev)->next)
+    if ((*prev)->dev_id == disk->dev->id && (*prev)->disk_id == disk->id)
+      {
+	cache = *prev;
+	/* Keep the most recently used disks at the front.  */
+	*prev = cache->next;
+	cache->next = grub_partition_cache_list;
+	grub_partition_cache_list = cache;
+	cache->refs++;
+	return cache;
+      }
+
+  cache = grub_zalloc (sizeof (*cache));
+  if (!cache)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return NULL;
+    }
+  cache->dev_id = disk->dev->id;
+  cache->disk_id = disk->id;
+  ctx.tail = &cache->parts;
+  ctx.scan_tail = &cache->scans;
+  ctx.failed = 0;
+
+  grub_partition_cache_scan (disk, &ctx);
+  if (ctx.failed)
+    {
+      grub_partition_cache_free (cache);
+      return NULL;
+    }
+  grub_dprintf ("partition", "cached partition tree of %s\n", disk->name);
+
+  if (grub_partition_cache_count >= GRUB_PARTITION_CACHE_MAX)
+    {
+      for (prev = &grub_partition_cache_list; (*prev)->next;
+	   prev = &(*prev)->next);
+      grub_partition_cache_unlink (prev);
+    }
+  cache->next = grub_partition_cache_list;
+  grub_partition_cache_list = cache;
+  grub_partition_cache_count++;
+  cache->refs = 1;
+  return cache;
+}
+
+/* Find PARTNUM of PARTMAP in the cached tree, following the same rules
+   as the uncached grub_partition_probe.  Return NULL with grub_errno
+   clear when the cache can't answer.  */
+static grub_partition_t
+grub_partition_cache_probe (struct grub_partition_cache *cache,
+			    const char *str)
+{
+  grub_partition_t part = NULL;
+  grub_partition_t parent = NULL;
+  grub_partition_t curpart;
+  const char *ptr;
+
+  for (ptr = str; *ptr;)
+    {
+      grub_partition_map_t partmap;
+      struct grub_partition_cache_node *found = NULL;
+      int num;
+      const char *partname, *partname_end;
+
+      partname = ptr;
+      while (*ptr && grub_isalpha (*ptr))
+	ptr++;
+      partname_end = ptr;
+      num = grub_strtoul (ptr, &ptr, 0) - 1;
+
+      FOR_PARTITION_MAPS(partmap)
+      {
+	struct grub_partition_cache_scan *scan;
+	struct grub_partition_cache_node *node;
+
+	if (partname_end != partname &&
+	    (grub_strncmp (partmap->name, partname, partname_end - partname)
+	     != 0 || partmap->name[partname_end - partname] != 0))
+	  continue;
+
+	for (scan = cache->scans; scan; scan = scan->next)
+	  if (scan->parent == parent && scan->partmap == partmap)
+	    break;
+	if (!scan)
+	  goto uncached;
+	if (scan->err == GRUB_ERR_BAD_PART_TABLE)
+	  continue;
+	if (scan->err == GRUB_ERR_NONE)
+	  for (node = cache->parts; node; node = node->next)
+	    if (node->part.parent == parent && node->part.partmap == partmap
+		&& node->part.number == num)
+	      {
+		found = node;
+		break;
+	      }
+	break;
+      }
+
+      /* Let the uncached path report the error.  */
+      if (!found)
+	goto uncached;
+
+      curpart = grub_malloc (sizeof (*curpart));
+      if (!curpart)
+	goto fail;
+      *curpart = found->part;
+      curpart->parent = part;
+      part = curpart;
+      parent = &found->part;
+      if (! ptr || *ptr != ',')
+	break;
+      ptr++;
+    }
+
+  return part;
+
+ uncached:
+  grub_errno = GRUB_ERR_NONE;
+ fail:
+  while (part)
+    {
+      curpart = part->parent;
+      grub_free (part);
+      part = curpart;
+    }
+  return NULL;
+}
+
 /* Context for grub_partition_map_probe.  */
 struct grub_partition_map_probe_ctx
 {
@@ -106,17 +426,14 @@ grub_partition_map_probe (const grub_partition_map_t partmap,
   return 0;
 }
 
-grub_partition_t
-grub_partition_probe (struct grub_disk *disk, const char *str)
+static grub_partition_t
+grub_partition_probe_uncached (struct grub_disk *disk, const char *str)
 {
   grub_partition_t part;
   grub_partition_t curpart = 0;
   grub_partition_t tail;
   const char *ptr;
 
-  if (str == NULL)
-    return 0;
-
   part = tail = disk->partition;
 
   for (ptr = str; *ptr;)
@@ -176,6 +493,27 @@ grub_partition_probe (struct grub_disk *disk, const char *str)
   return part;
 }
 
+grub_partition_t
+grub_partition_probe (struct grub_disk *disk, const char *str)
+{
+  struct grub_partition_cache *cache;
+  grub_partition_t part;
+
+  if (str == NULL)
+    return 0;
+
+  cache = grub_partition_cache_get (disk);
+  if (cache)
+    {
+      part = grub_partition_cache_probe (cache, str);
+      grub_partition_cache_release (cache);
+      if (part || grub_errno)
+	return part;
+    }
+
+  return grub_partition_probe_uncached (disk, str);
+}
+
 /* Context for grub_partition_iterate.  */
 struct grub_partition_iterate_ctx
 {
@@ -229,6 +567,28 @@ grub_partition_iterate (struct grub_disk *disk,
     .hook_data = hook_data
   };
   const struct grub_partition_map *partmap;
+  struct grub_partition_cache *cache;
+
+  cache = grub_partition_cache_get (disk);
+  if (cache)
+    {
+      struct grub_partition_cache_node *node;
+
+      for (node = cache->parts; node; node = node->next)
+	{
+	  /* Hooks get a copy, as they do from part_iterate.  */
+	  struct grub_partition p = node->part;
+
+	  if (hook (disk, &p, hook_data))
+	    {
+	      grub_errno = GRUB_ERR_NONE;
+	      ctx.ret = 1;
+	      break;
+	    }
+	}
+      grub_partition_cache_release (cache);
+      return ctx.ret;
+    }
 
   FOR_PARTITION_MAPS(partmap)
   {
@@ -24,6 +24,9 @@ typedef grub_uint64_t (*get_time_ms_func_t) (void);
 /* Function pointer to the implementation in use.  */
 static get_time_ms_func_t get_time_ms_func;
 
+/* Optional higher resolution clock.  */
+static get_time_ms_func_t get_time_us_func;
+
 grub_uint64_t
 grub_get_time_ms (void)
 {
@@ -35,3 +38,17 @@ grub_install_get_time_ms (get_time_ms_func_t func)
 {
   get_time_ms_func = func;
 }
+
+grub_uint64_t
+grub_get_time_us (void)
+{
+  if (get_time_us_func)
+    return get_time_us_func ();
+  return get_time_ms_func () * 1000;
+}
+
+void
+grub_install_get_time_us (get_time_ms_func_t func)
+{
+  get_time_us_func = func;
+}
@@ -38,7 +38,7 @@ verified_free (grub_verified_t verified)
 {
   if (verified)
     {
-      grub_free (verified->buf);
+      grub_bulk_free (verified->buf);
       grub_free (verified);
     }
 }
@@ -76,7 +76,7 @@ struct grub_fs verified_fs =
 };
 
 static grub_file_t
-grub_verifiers_open (grub_file_t io, enum grub_file_type type)
+verify_file (grub_file_t io, enum grub_file_type type)
 {
   grub_verified_t verified = NULL;
   struct grub_file_verifier *ver;
@@ -145,24 +145,27 @@ grub_verifiers_open (grub_file_t io, enum grub_file_type type)
     {
       goto fail;
     }
-  verified->buf = grub_malloc (ret->size);
+  verified->buf = grub_bulk_alloc (ret->size);
   if (!verified->buf)
     {
       goto fail;
     }
+  grub_boot_trace_begin ("verify", "read", io->name);
   if (grub_file_read (io, verified->buf, ret->size) != (grub_ssize_t) ret->size)
     {
+      grub_boot_trace_end ("verify", "read", io->name);
       if (!grub_errno)
 	grub_error (GRUB_ERR_FILE_READ_ERROR, N_("premature end of file %s"),
 		    io->name);
       goto fail;
     }
+  grub_boot_trace_end ("verify", "read", io->name);
 
+  grub_boot_trace_begin ("verify", "check", ver->name);
   err = ver->write (context, verified->buf, ret->size);
-  if (err)
-    goto fail;
-
-  err = ver->fini ? ver->fini (context) : GRUB_ERR_NONE;
+  if (!err)
+    err = ver->fini ? ver->fini (context) : GRUB_ERR_NONE;
+  grub_boot_trace_end ("verify", "check", ver->name);
   if (err)
     goto fail;
 
@@ -204,6 +207,30 @@ grub_verifiers_open (grub_file_t io, enum grub_file_type type)
   return NULL;
 }
 
+/* Modules may be installed compressed, but are signed as built: check them
+   once the decompression filters have run.  */
+static int
+verify_content (enum grub_file_type type)
+{
+  return (type & GRUB_FILE_TYPE_MASK) == GRUB_FILE_TYPE_GRUB_MODULE;
+}
+
+static grub_file_t
+grub_verifiers_open (grub_file_t io, enum grub_file_type type)
+{
+  if (verify_content (type))
+    return io;
+  return verify_file (io, type);
+}
+
+static grub_file_t
+grub_verifiers_open_content (grub_file_t io, enum grub_file_type type)
+{
+  if (!verify_content (type))
+    return io;
+  return verify_file (io, type);
+}
+
 grub_err_t
 grub_verify_string (char *str, enum grub_verify_string_type type)
 {
@@ -225,4 +252,6 @@ void
 grub_verifiers_init (void)
 {
   grub_file_filter_register (GRUB_FILE_FILTER_VERIFY, grub_verifiers_open);
+  grub_file_filter_register (GRUB_FILE_FILTER_VERIFY_CONTENT,
+			     grub_verifiers_open_content);
 }
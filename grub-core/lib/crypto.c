@@ -24,6 +24,9 @@
 #include <grub/dl.h>
 #include <grub/i18n.h>
 #include <grub/env.h>
+#if defined (__i386__) || defined (__x86_64__)
+#include <grub/i386/cpuid.h>
+#endif
 
 GRUB_MOD_LICENSE ("GPLv3+");
 
@@ -56,6 +59,106 @@ _gcry_burn_stack (int size)
   grub_burn_stack (size);
 }
 
+#if defined (__i386__) || defined (__x86_64__)
+
+#define CPUID_1_ECX_AES		(1 << 25)
+#define CPUID_1_EDX_SSE		(1 << 25)
+#define CPUID_1_EDX_SSE2	(1 << 26)
+#define CPUID_1_EDX_FXSR	(1 << 24)
+
+#define CR0_EM			(1 << 2)
+#define CR0_TS			(1 << 3)
+#define CR4_OSFXSR		(1 << 9)
+
+#if !defined (GRUB_UTIL) && !defined (GRUB_MACHINE_EMU) \
+  && !defined (GRUB_MACHINE_XEN)
+static inline grub_addr_t
+read_cr0 (void)
+{
+  grub_addr_t val;
+  asm volatile ("mov %%cr0, %0" : "=r" (val));
+  return val;
+}
+
+static inline grub_addr_t
+read_cr4 (void)
+{
+  grub_addr_t val;
+  asm volatile ("mov %%cr4, %0" : "=r" (val));
+  return val;
+}
+#endif
+
+/* Check whether SSE registers may be used.  Under an OS the kernel manages
+   the state.  Otherwise we only look at the control registers and never
+   change them, as the loaded OS expects them as the firmware left them:
+   EFI enables SSE, the BIOS and coreboot usually don't, and there the
+   generic cipher is used.  The xmm registers are cleared by the cipher
+   after each use, so nothing leaks to the loaded OS.  */
+static int
+sse_usable (grub_uint32_t edx)
+{
+  if ((edx & (CPUID_1_EDX_FXSR | CPUID_1_EDX_SSE | CPUID_1_EDX_SSE2))
+      != (CPUID_1_EDX_FXSR | CPUID_1_EDX_SSE | CPUID_1_EDX_SSE2))
+    return 0;
+
+#if defined (GRUB_UTIL) || defined (GRUB_MACHINE_EMU)
+  return 1;
+#elif defined (GRUB_MACHINE_XEN)
+  /* PV guests can't inspect the control registers.  */
+  return 0;
+#else
+  return (read_cr4 () & CR4_OSFXSR) && !(read_cr0 () & (CR0_EM | CR0_TS));
+#endif
+}
+
+static unsigned int
+probe_hw_features (void)
+{
+  grub_uint32_t max, a, b, c, d;
+
+#ifndef __x86_64__
+  if (!grub_cpu_is_cpuid_supported ())
+    return 0;
+#endif
+
+  grub_cpuid (0, max, b, c, d);
+  if (max < 1)
+    return 0;
+
+  grub_cpuid (1, a, b, c, d);
+  if (!(c & CPUID_1_ECX_AES) || !sse_usable (d))
+    return 0;
+
+  return GRUB_CRYPTO_HWF_INTEL_AESNI;
+}
+
+#else
+
+static unsigned int
+probe_hw_features (void)
+{
+  return 0;
+}
+
+#endif
+
+/* Return the GRUB_CRYPTO_HWF_* features the ciphers may use.  */
+unsigned int
+grub_crypto_get_hw_features (void)
+{
+  static int probed;
+  static unsigned int features;
+
+  if (!probed)
+    {
+      features = probe_hw_features ();
+      probed = 1;
+      grub_dprintf ("crypto", "hardware features: 0x%x\n", features);
+    }
+  return features;
+}
+
 void __attribute__ ((noreturn))
 _gcry_assert_failed (const char *expr, const char *file, int line,
 		     const char *func)
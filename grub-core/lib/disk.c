@@ -63,6 +63,8 @@ grub_disk_write (grub_disk_t disk, grub_disk_addr_t sector,
   if (grub_disk_adjust_range (disk, &sector, &offset, size) != GRUB_ERR_NONE)
     return -1;
 
+  grub_partition_cache_invalidate (disk->dev->id, disk->id);
+
   aligned_sector = (sector & ~((1ULL << (disk->log_sector_size
 					 - GRUB_DISK_SECTOR_BITS)) - 1));
   real_offset = offset + ((sector - aligned_sector) << GRUB_DISK_SECTOR_BITS);
@@ -67,6 +67,11 @@ _gcry_fips_mode (void)
 
 #define DBG_CIPHER 0
 
+#if defined (__i386__) || defined (__x86_64__)
+#define ENABLE_AESNI_SUPPORT 1
+#endif
+#define _gcry_get_hw_features grub_crypto_get_hw_features
+
 #include <string.h>
 #pragma GCC diagnostic ignored "-Wredundant-decls"
 #include <grub/gcrypt/g10lib.h>
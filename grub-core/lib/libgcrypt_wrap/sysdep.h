@@ -0,0 +1,27 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Replaces the sysdep.h which libgcrypt's configure generates for the
+   mpih assembly.  GRUB modules are ELF and symbols have no prefix.  */
+
+#ifndef GRUB_GCRY_WRAP_SYSDEP_HEADER
+#define GRUB_GCRY_WRAP_SYSDEP_HEADER 1
+
+#define C_SYMBOL_NAME(name) name
+
+#endif
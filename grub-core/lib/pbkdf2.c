@@ -25,6 +25,69 @@
 
 GRUB_MOD_LICENSE ("GPLv2+");
 
+#define HMAC_MAX_BLOCKSIZE 256
+
+/* Prepare the HMAC inner and outer hash states for key P.  These only
+   depend on the password, so they are computed once and then copied for
+   every PRF invocation instead of rehashing both pads each time.  */
+
+static gcry_err_code_t
+hmac_prepare (const struct gcry_md_spec *md,
+	      const grub_uint8_t *P, grub_size_t Plen,
+	      void *ictx, void *octx)
+{
+  grub_uint8_t pad[HMAC_MAX_BLOCKSIZE];
+  grub_uint8_t key[GRUB_CRYPTO_MAX_MDLEN];
+  unsigned int i;
+
+  if (md->blocksize > sizeof (pad) || md->mdlen > md->blocksize)
+    return GPG_ERR_INV_ARG;
+
+  if (Plen > md->blocksize)
+    {
+      grub_crypto_hash (md, key, P, Plen);
+      P = key;
+      Plen = md->mdlen;
+    }
+
+  grub_memset (pad, 0, md->blocksize);
+  grub_memcpy (pad, P, Plen);
+  for (i = 0; i < md->blocksize; i++)
+    pad[i] ^= 0x36;
+  md->init (ictx);
+  md->write (ictx, pad, md->blocksize);
+
+  /* 0x36 ^ 0x5c turns the inner pad into the outer one.  */
+  for (i = 0; i < md->blocksize; i++)
+    pad[i] ^= 0x36 ^ 0x5c;
+  md->init (octx);
+  md->write (octx, pad, md->blocksize);
+
+  grub_memset (pad, 0, sizeof (pad));
+  grub_memset (key, 0, sizeof (key));
+
+  return GPG_ERR_NO_ERROR;
+}
+
+/* Compute HMAC (P, DATA) into OUT, starting from the prepared states.  */
+
+static void
+hmac_prepared (const struct gcry_md_spec *md,
+	       const void *ictx, const void *octx, void *work,
+	       const grub_uint8_t *data, grub_size_t datalen,
+	       grub_uint8_t *out)
+{
+  grub_memcpy (work, ictx, md->contextsize);
+  md->write (work, data, datalen);
+  md->final (work);
+  grub_memcpy (out, md->read (work), md->mdlen);
+
+  grub_memcpy (work, octx, md->contextsize);
+  md->write (work, out, md->mdlen);
+  md->final (work);
+  grub_memcpy (out, md->read (work), md->mdlen);
+}
+
 /* Implement PKCS#5 PBKDF2 as per RFC 2898.  The PRF to use is HMAC variant
    of digest supplied by MD.  Inputs are the password P of length PLEN,
    the salt S of length SLEN, the iteration counter C (> 0), and the
@@ -50,6 +113,8 @@ grub_crypto_pbkdf2 (const struct gcry_md_spec *md,
   gcry_err_code_t rc;
   grub_uint8_t *tmp;
   grub_size_t tmplen = Slen + 4;
+  grub_uint8_t *ctxs;
+  void *ictx, *octx, *work;
 
   if (md->mdlen > GRUB_CRYPTO_MAX_MDLEN || md->mdlen == 0)
     return GPG_ERR_INV_ARG;
@@ -70,31 +135,35 @@ grub_crypto_pbkdf2 (const struct gcry_md_spec *md,
   if (tmp == NULL)
     return GPG_ERR_OUT_OF_MEMORY;
 
+  ctxs = grub_malloc (3 * md->contextsize);
+  if (ctxs == NULL)
+    {
+      grub_free (tmp);
+      return GPG_ERR_OUT_OF_MEMORY;
+    }
+  ictx = ctxs;
+  octx = ctxs + md->contextsize;
+  work = ctxs + 2 * md->contextsize;
+
+  rc = hmac_prepare (md, P, Plen, ictx, octx);
+  if (rc != GPG_ERR_NO_ERROR)
+    goto out;
+
   grub_memcpy (tmp, S, Slen);
 
   for (i = 1; i - 1 < l; i++)
     {
-      grub_memset (T, 0, hLen);
+      tmp[Slen + 0] = (i & 0xff000000) >> 24;
+      tmp[Slen + 1] = (i & 0x00ff0000) >> 16;
+      tmp[Slen + 2] = (i & 0x0000ff00) >> 8;
+      tmp[Slen + 3] = (i & 0x000000ff) >> 0;
+
+      hmac_prepared (md, ictx, octx, work, tmp, tmplen, U);
+      grub_memcpy (T, U, hLen);
 
-      for (u = 0; u < c; u++)
+      for (u = 1; u < c; u++)
 	{
-	  if (u == 0)
-	    {
-	      tmp[Slen + 0] = (i & 0xff000000) >> 24;
-	      tmp[Slen + 1] = (i & 0x00ff0000) >> 16;
-	      tmp[Slen + 2] = (i & 0x0000ff00) >> 8;
-	      tmp[Slen + 3] = (i & 0x000000ff) >> 0;
-
-	      rc = grub_crypto_hmac_buffer (md, P, Plen, tmp, tmplen, U);
-	    }
-	  else
-	    rc = grub_crypto_hmac_buffer (md, P, Plen, U, hLen, U);
-
-	  if (rc != GPG_ERR_NO_ERROR)
-	    {
-	      grub_free (tmp);
-	      return rc;
-	    }
+	  hmac_prepared (md, ictx, octx, work, U, hLen, U);
 
 	  for (k = 0; k < hLen; k++)
 	    T[k] ^= U[k];
@@ -103,7 +172,12 @@ grub_crypto_pbkdf2 (const struct gcry_md_spec *md,
       grub_memcpy (DK + (i - 1) * hLen, T, i == l ? r : hLen);
     }
 
+ out:
+  grub_memset (ctxs, 0, 3 * md->contextsize);
+  grub_memset (U, 0, sizeof (U));
+  grub_memset (T, 0, sizeof (T));
+  grub_free (ctxs);
   grub_free (tmp);
 
-  return GPG_ERR_NO_ERROR;
+  return rc;
 }
@@ -91,6 +91,8 @@ send_ethernet_packet (struct grub_net_network_level_interface *inf,
       inf->card->opened = 1;
     }
 
+  inf->card->stat_tx_packets++;
+  inf->card->stat_tx_bytes += nb->tail - nb->data;
   return inf->card->driver->send (inf->card, nb);
 }
 
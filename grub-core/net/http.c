@@ -424,6 +424,8 @@ http_establish (struct grub_file *file, grub_off_t offset, int initial)
       grub_netbuff_free (nb);
       return grub_errno;
     }
+  grub_net_tcp_count_retransmits (data->sock,
+				  &file->device->net->stat_retransmits);
 
   //  grub_net_poll_cards (5000);
 
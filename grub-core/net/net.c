@@ -32,6 +32,7 @@
 #include <grub/loader.h>
 #include <grub/bufio.h>
 #include <grub/kernel.h>
+#include <grub/iostat.h>
 #ifdef GRUB_MACHINE_EFI
 #include <grub/net/efi.h>
 #endif
@@ -1586,7 +1587,9 @@ grub_net_fs_open (struct grub_file *file_out, const char *name)
       return grub_errno;
     }
 
+  grub_boot_trace_begin ("net", "open", name);
   err = file->device->net->protocol->open (file, name);
+  grub_boot_trace_end ("net", "open", name);
   if (err)
     {
       while (file->device->net->packs.first)
@@ -1617,9 +1620,76 @@ grub_net_fs_open (struct grub_file *file_out, const char *name)
   return GRUB_ERR_NONE;
 }
 
+/* Counters of the most recently closed network files.  */
+#define NET_STATS_NUM	16
+#define NET_STATS_NAME	64
+
+static struct
+{
+  char name[NET_STATS_NAME];
+  grub_uint64_t packets;
+  grub_uint64_t bytes;
+  grub_uint64_t retransmits;
+} net_stats[NET_STATS_NUM];
+static unsigned net_stats_next;
+
+static void
+net_stats_record (grub_net_t net)
+{
+  unsigned i = net_stats_next++ % NET_STATS_NUM;
+  char *name = net_stats[i].name;
+  grub_size_t len;
+
+  len = grub_snprintf (name, NET_STATS_NAME, "%s://%s",
+		       net->protocol->name, net->server ? : "");
+  if (len + 4 < NET_STATS_NAME)
+    {
+      const char *path = net->name ? : "";
+      grub_size_t plen = grub_strlen (path);
+
+      /* Keep the end of long paths.  */
+      if (len + plen >= NET_STATS_NAME)
+	grub_snprintf (name + len, NET_STATS_NAME - len, "...%s",
+		       path + plen - (NET_STATS_NAME - len - 4));
+      else
+	grub_strcpy (name + len, path);
+    }
+  net_stats[i].packets = net->stat_packets;
+  net_stats[i].bytes = net->stat_bytes;
+  net_stats[i].retransmits = net->stat_retransmits;
+}
+
+static void
+grub_net_iostat_real (grub_iostat_emit_t emit, void *data)
+{
+  struct grub_net_card *card;
+  unsigned i, n;
+
+  FOR_NET_CARDS (card)
+    {
+      emit ("net", card->name, "rx_packets", card->stat_rx_packets, data);
+      emit ("net", card->name, "rx_bytes", card->stat_rx_bytes, data);
+      emit ("net", card->name, "tx_packets", card->stat_tx_packets, data);
+      emit ("net", card->name, "tx_bytes", card->stat_tx_bytes, data);
+    }
+
+  n = net_stats_next < NET_STATS_NUM ? net_stats_next : NET_STATS_NUM;
+  for (i = 0; i < n; i++)
+    {
+      unsigned j = (net_stats_next - n + i) % NET_STATS_NUM;
+
+      emit ("netfile", net_stats[j].name, "packets", net_stats[j].packets,
+	    data);
+      emit ("netfile", net_stats[j].name, "bytes", net_stats[j].bytes, data);
+      emit ("netfile", net_stats[j].name, "retransmits",
+	    net_stats[j].retransmits, data);
+    }
+}
+
 static grub_err_t
 grub_net_fs_close (grub_file_t file)
 {
+  net_stats_record (file->device->net);
   while (file->device->net->packs.first)
     {
       grub_netbuff_free (file->device->net->packs.first->nb);
@@ -1665,6 +1735,8 @@ receive_packets (struct grub_net_card *card, int *stop_condition)
 	  break;
 	}
       received++;
+      card->stat_rx_packets++;
+      card->stat_rx_bytes += nb->tail - nb->data;
       grub_net_recv_ethernet_packet (nb, card);
       if (grub_errno)
 	{
@@ -1764,6 +1836,7 @@ grub_net_fs_read_real (grub_file_t file, char *buf, grub_size_t len)
 	  len -= amount;
 	  total += amount;
 	  file->device->net->offset += amount;
+	  net->stat_bytes += amount;
 	  if (grub_file_progress_hook)
 	    grub_file_progress_hook (0, 0, amount, file);
 	  if (buf)
@@ -1773,6 +1846,7 @@ grub_net_fs_read_real (grub_file_t file, char *buf, grub_size_t len)
 	    }
 	  if (amount == (grub_size_t) (nb->tail - nb->data))
 	    {
+	      net->stat_packets++;
 	      grub_netbuff_free (nb);
 	      grub_net_remove_packet (net->packs.first);
 	    }
@@ -1860,6 +1934,8 @@ grub_net_seek_real (struct grub_file *file, grub_off_t offset)
 static grub_ssize_t
 grub_net_fs_read (grub_file_t file, char *buf, grub_size_t len)
 {
+  grub_ssize_t ret;
+
   if (file->device->net->broken)
     return -1;
 
@@ -1870,7 +1946,11 @@ grub_net_fs_read (grub_file_t file, char *buf, grub_size_t len)
       if (err)
 	return err;
     }
-  return grub_net_fs_read_real (file, buf, len);
+
+  grub_boot_trace_begin ("net", "read", file->device->net->name);
+  ret = grub_net_fs_read_real (file, buf, len);
+  grub_boot_trace_end ("net", "read", file->device->net->name);
+  return ret;
 }
 
 static struct grub_fs grub_net_fs =
@@ -2129,6 +2209,7 @@ GRUB_MOD_INIT(net)
   grub_dns_init ();
 
   grub_net_open = grub_net_open_real;
+  grub_net_iostat = grub_net_iostat_real;
   fini_hnd = grub_loader_register_preboot_hook (grub_net_fini_hw,
 						grub_net_restore_hw,
 						GRUB_LOADER_PREBOOT_HOOK_PRIO_DISK);
@@ -2179,6 +2260,7 @@ GRUB_MOD_FINI(net)
   grub_unregister_command (cmd_slaac);
   grub_fs_unregister (&grub_net_fs);
   grub_net_open = NULL;
+  grub_net_iostat = NULL;
   grub_net_fini_hw (0);
   grub_loader_unregister_preboot_hook (fini_hnd);
   grub_net_poll_cards_idle = grub_net_poll_cards_idle_real;
@@ -78,6 +78,7 @@ struct grub_net_tcp_socket
   struct grub_net_network_level_interface *inf;
   grub_net_packets_t packs;
   grub_priority_queue_t pq;
+  grub_uint64_t *retransmits;
 };
 
 struct grub_net_tcp_listen
@@ -257,6 +258,8 @@ grub_net_tcp_close (grub_net_tcp_socket_t sock,
       sock->recv_hook = NULL;
       sock->error_hook = NULL;
       sock->fin_hook = NULL;
+      /* The owner of the counter may go away before the socket does.  */
+      sock->retransmits = NULL;
     }
 
   if (discard_received == GRUB_NET_TCP_ABORT)
@@ -396,6 +399,8 @@ grub_net_tcp_retransmit (void)
 	  }
 	unack->try_count++;
 	unack->last_try = ctime;
+	if (sock->retransmits)
+	  (*sock->retransmits)++;
 	nbd = unack->nb->data;
 	tcph = (struct tcphdr *) nbd;
 
@@ -1034,3 +1039,10 @@ grub_net_tcp_unstall (grub_net_tcp_socket_t sock)
   sock->i_stall = 0;
   ack (sock);
 }
+
+void
+grub_net_tcp_count_retransmits (grub_net_tcp_socket_t sock,
+				grub_uint64_t *counter)
+{
+  sock->retransmits = counter;
+}
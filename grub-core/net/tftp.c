@@ -196,7 +196,11 @@ tftp_receive (grub_net_udp_socket_t sock __attribute__ ((unused)),
        * [0]: https://tools.ietf.org/html/rfc1350
        */
       if (grub_be_to_cpu16 (tftph->u.data.block) < ((grub_uint16_t) (data->block + 1)))
-	ack (data, grub_be_to_cpu16 (tftph->u.data.block));
+	{
+	  /* The server resent a block whose ack got lost.  */
+	  file->device->net->stat_retransmits++;
+	  ack (data, grub_be_to_cpu16 (tftph->u.data.block));
+	}
       /* Ignore unexpected block. */
       else if (grub_be_to_cpu16 (tftph->u.data.block) > ((grub_uint16_t) (data->block + 1)))
 	grub_dprintf ("tftp", "TFTP unexpected block # %d\n", tftph->u.data.block);
@@ -387,6 +391,8 @@ tftp_open (struct grub_file *file, const char *filename)
   for (i = 0; i < GRUB_NET_TRIES; i++)
     {
       nb.data = nbd;
+      if (i)
+	file->device->net->stat_retransmits++;
       err = grub_net_send_udp_packet (data->sock, &nb);
       if (err)
 	{
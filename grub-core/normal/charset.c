@@ -218,6 +218,11 @@ grub_utf8_to_ucs4_alloc (const char *msg, grub_uint32_t **unicode_msg,
   return msg_len;
 }
 
+typedef unsigned long utf8_word_t __attribute__ ((__may_alias__));
+
+#define UTF8_WORD_ONES	(~0UL / 0xff)
+#define UTF8_WORD_HIGHS	(UTF8_WORD_ONES * 0x80)
+
 /* Convert a (possibly null-terminated) UTF-8 string of at most SRCSIZE
    bytes (if SRCSIZE is -1, it is ignored) in length to a UCS-4 string.
    Return the number of characters converted. DEST must be able to hold
@@ -239,6 +244,31 @@ grub_utf8_to_ucs4 (grub_uint32_t *dest, grub_size_t destsize,
   while (srcsize && destsize)
     {
       int was_count = count;
+
+      /* Runs of ASCII without a NUL are copied a word at a time.  An
+	 aligned load never crosses into the next page, so looking past the
+	 end of the string is harmless.  */
+      if (count == 0 && destsize >= sizeof (utf8_word_t)
+	  && ((grub_addr_t) src & (sizeof (utf8_word_t) - 1)) == 0
+	  && (srcsize == (grub_size_t) -1 || srcsize >= sizeof (utf8_word_t)))
+	{
+	  utf8_word_t w = *(const utf8_word_t *) src;
+
+	  if (!(w & UTF8_WORD_HIGHS)
+	      && !((w - UTF8_WORD_ONES) & ~w & UTF8_WORD_HIGHS))
+	    {
+	      unsigned i;
+
+	      for (i = 0; i < sizeof (w); i++)
+		*p++ = src[i];
+	      src += sizeof (w);
+	      destsize -= sizeof (w);
+	      if (srcsize != (grub_size_t) -1)
+		srcsize -= sizeof (w);
+	      continue;
+	    }
+	}
+
       if (srcsize != (grub_size_t)-1)
 	srcsize--;
       if (!grub_utf8_process (*src++, &code, &count))
@@ -857,6 +887,24 @@ grub_bidi_line_logical_to_visual (const grub_uint32_t *logical,
   if (!visual)
     return -1;
 
+  /* Printable ASCII, which most menus are made of, has no combining
+     characters, joiners or explicit embeddings, and is never reordered.  */
+  for (i = 0; i < logical_len; i++)
+    if (logical[i] < 0x20 || logical[i] > 0x7e)
+      break;
+  if (i == logical_len)
+    {
+      for (i = 0; i < logical_len; i++)
+	{
+	  visual[i].base = logical[i];
+	  visual[i].estimated_width = 1;
+	  visual[i].orig_pos = i;
+	  visual[i].bidi_type = get_bidi_type (logical[i]);
+	}
+      visual_len = logical_len;
+      goto wrap;
+    }
+
   for (i = 0; i < logical_len; i++)
     {
       type = get_bidi_type (logical[i]);
@@ -1145,6 +1193,7 @@ grub_bidi_line_logical_to_visual (const grub_uint32_t *logical,
 	visual[i].bidi_level = 0;
     }
 
+ wrap:
   {
     grub_ssize_t ret;
     ret = bidi_line_wrap (visual_out, visual, visual_len,
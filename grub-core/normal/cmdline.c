@@ -637,6 +637,7 @@ grub_cmdline_get (const char *prompt_translated)
 	  break;
 
 	case GRUB_TERM_ESC:
+	  grub_normal_completion_flush ();
 	  grub_free (cl_terms);
 	  grub_free (buf);
 	  return 0;
@@ -676,6 +677,9 @@ grub_cmdline_get (const char *prompt_translated)
   grub_xputs ("\n");
   grub_refresh ();
 
+  /* The line may change what there is to complete.  */
+  grub_normal_completion_flush ();
+
   histpos = 0;
   if (strlen_ucs4 (buf) > 0)
     {
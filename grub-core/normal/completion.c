@@ -27,6 +27,7 @@
 #include <grub/parser.h>
 #include <grub/extcmd.h>
 #include <grub/charset.h>
+#include <grub/env.h>
 
 /* The current word.  */
 static const char *current_word;
@@ -45,6 +46,37 @@ static void (*print_func) (const char *, grub_completion_type_t, int);
 
 /* The state the command line is in.  */
 static grub_parser_state_t cmdline_state;
+
+/* Listing devices opens every one of them and listing a directory probes
+   its filesystem, which is slow on real disks and dreadful over a serial
+   line when the user presses Tab again and again.  What was found is
+   therefore kept until the editing session ends, or a command may have
+   changed it; see grub_normal_completion_flush.  */
+enum completion_cache_kind
+  {
+    CACHE_DEVICES,
+    CACHE_PARTITIONS,
+    CACHE_DIR
+  };
+
+struct completion_cache_item
+{
+  char *name;
+  int dir;
+};
+
+struct completion_cache
+{
+  struct completion_cache *next;
+  enum completion_cache_kind kind;
+  /* The device for partitions, the device and directory for files.  */
+  char *key;
+  struct completion_cache_item *items;
+  grub_size_t nitems;
+  grub_size_t alloc;
+};
+
+static struct completion_cache *completion_cache;
 
 
 /* Add a string to the list of possible completions. COMPLETION is the
@@ -98,101 +130,171 @@ add_completion (const char *completion, const char *extra,
   return 0;
 }
 
-static int
-iterate_partition (grub_disk_t disk, const grub_partition_t p,
-		   void *data __attribute__ ((unused)))
+static void
+cache_free (struct completion_cache *cache)
 {
-  const char *disk_name = disk->name;
-  char *name;
-  int ret;
-  char *part_name;
+  grub_size_t i;
 
-  part_name = grub_partition_get_name (p);
-  if (! part_name)
-    return 1;
+  for (i = 0; i < cache->nitems; i++)
+    grub_free (cache->items[i].name);
+  grub_free (cache->items);
+  grub_free (cache->key);
+  grub_free (cache);
+}
 
-  name = grub_xasprintf ("%s,%s", disk_name, part_name);
-  grub_free (part_name);
+void
+grub_normal_completion_flush (void)
+{
+  struct completion_cache *next;
 
-  if (! name)
-    return 1;
+  for (; completion_cache; completion_cache = next)
+    {
+      next = completion_cache->next;
+      cache_free (completion_cache);
+    }
+}
 
-  ret = add_completion (name, ")", GRUB_COMPLETION_TYPE_PARTITION);
-  grub_free (name);
-  return ret;
+static struct completion_cache *
+cache_find (enum completion_cache_kind kind, const char *key)
+{
+  struct completion_cache *cache;
+
+  for (cache = completion_cache; cache; cache = cache->next)
+    if (cache->kind == kind
+	&& (! key || grub_strcmp (cache->key, key) == 0))
+      return cache;
+  return NULL;
 }
 
-static int
-iterate_dir (const char *filename, const struct grub_dirhook_info *info,
-	     void *data __attribute__ ((unused)))
+static struct completion_cache *
+cache_new (enum completion_cache_kind kind, const char *key)
 {
-  if (! info->dir)
-    {
-      const char *prefix;
-      if (cmdline_state == GRUB_PARSER_STATE_DQUOTE)
-	prefix = "\" ";
-      else if (cmdline_state == GRUB_PARSER_STATE_QUOTE)
-	prefix = "\' ";
-      else
-	prefix = " ";
+  struct completion_cache *cache;
 
-      if (add_completion (filename, prefix, GRUB_COMPLETION_TYPE_FILE))
-	return 1;
+  cache = grub_zalloc (sizeof (*cache));
+  if (! cache)
+    return NULL;
+  cache->kind = kind;
+  if (key)
+    {
+      cache->key = grub_strdup (key);
+      if (! cache->key)
+	{
+	  grub_free (cache);
+	  return NULL;
+	}
     }
-  else if (grub_strcmp (filename, ".") && grub_strcmp (filename, ".."))
+  return cache;
+}
+
+static void
+cache_insert (struct completion_cache *cache)
+{
+  cache->next = completion_cache;
+  completion_cache = cache;
+}
+
+/* Add NAME to CACHE, taking it over.  */
+static int
+cache_add_item (struct completion_cache *cache, char *name, int dir)
+{
+  if (! name)
+    return 1;
+
+  if (cache->nitems == cache->alloc)
     {
-      char *fname;
+      struct completion_cache_item *items;
+      grub_size_t alloc = cache->alloc ? cache->alloc * 2 : 16;
 
-      fname = grub_xasprintf ("%s/", filename);
-      if (add_completion (fname, "", GRUB_COMPLETION_TYPE_FILE))
+      items = grub_realloc (cache->items, alloc * sizeof (items[0]));
+      if (! items)
 	{
-	  grub_free (fname);
+	  grub_free (name);
 	  return 1;
 	}
-      grub_free (fname);
+      cache->items = items;
+      cache->alloc = alloc;
     }
 
+  cache->items[cache->nitems].name = name;
+  cache->items[cache->nitems].dir = dir;
+  cache->nitems++;
   return 0;
 }
 
 static int
-iterate_dev (const char *devname, void *data __attribute__ ((unused)))
+collect_partition (grub_disk_t disk, const grub_partition_t p, void *data)
 {
+  struct completion_cache *cache = data;
+  char *part_name;
+  char *name;
+
+  part_name = grub_partition_get_name (p);
+  if (! part_name)
+    return 1;
+
+  name = grub_xasprintf ("%s,%s", disk->name, part_name);
+  grub_free (part_name);
+
+  return cache_add_item (cache, name, 0);
+}
+
+/* Return the partitions of DEVNAME, or NULL if it can't be opened.  */
+static struct completion_cache *
+get_partitions (const char *devname)
+{
+  struct completion_cache *cache;
   grub_device_t dev;
 
-  /* Complete the partition part.  */
+  cache = cache_find (CACHE_PARTITIONS, devname);
+  if (cache)
+    return cache;
+
   dev = grub_device_open (devname);
+  grub_errno = GRUB_ERR_NONE;
+  if (! dev)
+    return NULL;
 
-  if (!dev)
+  cache = cache_new (CACHE_PARTITIONS, devname);
+  if (cache && dev->disk
+      && grub_partition_iterate (dev->disk, collect_partition, cache))
     {
-      grub_errno = GRUB_ERR_NONE;
-      return 0;
+      cache_free (cache);
+      cache = NULL;
     }
+  grub_device_close (dev);
 
-  if (grub_strcmp (devname, current_word) == 0)
-    {
-      if (add_completion (devname, ")", GRUB_COMPLETION_TYPE_PARTITION))
-	{
-	  grub_device_close (dev);
-	  return 1;
-	}
+  if (cache)
+    cache_insert (cache);
+  return cache;
+}
 
-      if (dev->disk)
-	if (grub_partition_iterate (dev->disk, iterate_partition, NULL))
-	  {
-	    grub_device_close (dev);
-	    return 1;
-	  }
-    }
-  else if (add_completion (devname, "", GRUB_COMPLETION_TYPE_DEVICE))
-    {
-      grub_device_close (dev);
+static int
+complete_partitions (struct completion_cache *cache)
+{
+  grub_size_t i;
+
+  for (i = 0; i < cache->nitems; i++)
+    if (add_completion (cache->items[i].name, ")",
+			GRUB_COMPLETION_TYPE_PARTITION))
       return 1;
-    }
+  return 0;
+}
 
-  grub_device_close (dev);
+static int
+collect_dev (const char *devname, void *data)
+{
+  struct completion_cache *cache = data;
+  grub_device_t dev;
+
+  /* Only offer the devices that can be opened.  */
+  dev = grub_device_open (devname);
   grub_errno = GRUB_ERR_NONE;
-  return 0;
+  if (! dev)
+    return 0;
+  grub_device_close (dev);
+
+  return cache_add_item (cache, grub_strdup (devname), 0);
 }
 
 /* Complete a device.  */
@@ -201,42 +303,106 @@ complete_device (void)
 {
   /* Check if this is a device or a partition.  */
   char *p = grub_strchr (++current_word, ',');
-  grub_device_t dev;
+  struct completion_cache *cache;
+  grub_size_t i;
+  const char *devname;
 
   if (! p)
     {
       /* Complete the disk part.  */
-      if (grub_disk_dev_iterate (iterate_dev, NULL))
-	return 1;
+      cache = cache_find (CACHE_DEVICES, NULL);
+      if (! cache)
+	{
+	  cache = cache_new (CACHE_DEVICES, NULL);
+	  if (! cache)
+	    return 1;
+	  if (grub_disk_dev_iterate (collect_dev, cache))
+	    {
+	      cache_free (cache);
+	      return 1;
+	    }
+	  cache_insert (cache);
+	}
+
+      for (i = 0; i < cache->nitems; i++)
+	{
+	  devname = cache->items[i].name;
+	  if (grub_strcmp (devname, current_word) == 0)
+	    {
+	      struct completion_cache *parts;
+
+	      if (add_completion (devname, ")", GRUB_COMPLETION_TYPE_PARTITION))
+		return 1;
+
+	      parts = get_partitions (devname);
+	      if (! parts || complete_partitions (parts))
+		return 1;
+	    }
+	  else if (add_completion (devname, "", GRUB_COMPLETION_TYPE_DEVICE))
+	    return 1;
+	}
     }
   else
     {
       /* Complete the partition part.  */
       *p = '\0';
-      dev = grub_device_open (current_word);
+      cache = get_partitions (current_word);
       *p = ',';
-      grub_errno = GRUB_ERR_NONE;
 
-      if (dev)
-	{
-	  if (dev->disk)
-	    {
-	      if (grub_partition_iterate (dev->disk, iterate_partition, NULL))
-		{
-		  grub_device_close (dev);
-		  return 1;
-		}
-	    }
-
-	  grub_device_close (dev);
-	}
-      else
+      if (! cache || complete_partitions (cache))
 	return 1;
     }
 
   return 0;
 }
 
+static int
+collect_dir (const char *filename, const struct grub_dirhook_info *info,
+	     void *data)
+{
+  struct completion_cache *cache = data;
+
+  if (info->dir && (grub_strcmp (filename, ".") == 0
+		    || grub_strcmp (filename, "..") == 0))
+    return 0;
+
+  return cache_add_item (cache, grub_strdup (filename), info->dir);
+}
+
+/* Return the listing of DIR on DEVICE, cached under KEY.  */
+static struct completion_cache *
+get_dir (const char *key, const char *device, const char *dir)
+{
+  struct completion_cache *cache;
+  grub_device_t dev;
+  grub_fs_t fs;
+
+  cache = cache_find (CACHE_DIR, key);
+  if (cache)
+    return cache;
+
+  dev = grub_device_open (device);
+  if (! dev)
+    return NULL;
+
+  fs = grub_fs_probe (dev);
+  cache = fs ? cache_new (CACHE_DIR, key) : NULL;
+  if (cache)
+    {
+      (fs->fs_dir) (dev, dir, collect_dir, cache);
+      if (grub_errno)
+	{
+	  cache_free (cache);
+	  cache = NULL;
+	}
+    }
+  grub_device_close (dev);
+
+  if (cache)
+    cache_insert (cache);
+  return cache;
+}
+
 /* Complete a file.  */
 static int
 complete_file (void)
@@ -245,33 +411,23 @@ complete_file (void)
   char *dir;
   char *last_dir;
   grub_fs_t fs;
-  grub_device_t dev;
+  grub_device_t dev = 0;
   int ret = 0;
 
   device = grub_file_get_device_name (current_word);
   if (grub_errno != GRUB_ERR_NONE)
     return 1;
 
-  dev = grub_device_open (device);
-  if (! dev)
-    {
-      ret = 1;
-      goto fail;
-    }
-
-  fs = grub_fs_probe (dev);
-  if (! fs)
-    {
-      ret = 1;
-      goto fail;
-    }
-
   dir = grub_strchr (current_word + (device ? 2 + grub_strlen (device) : 0),
 		     '/');
   last_dir = grub_strrchr (current_word, '/');
   if (dir)
     {
       char *dirfile;
+      char *key;
+      const char *prefix;
+      struct completion_cache *cache;
+      grub_size_t i;
 
       current_word = last_dir + 1;
 
@@ -287,19 +443,67 @@ complete_file (void)
       if (dirfile)
 	dirfile[1] = '\0';
 
-      /* Iterate the directory.  */
-      (fs->fs_dir) (dev, dir, iterate_dir, NULL);
-
+      /* Without a device, the file is on $root.  */
+      key = grub_xasprintf ("(%s)%s", device ? : grub_env_get ("root") ? : "",
+			    dir);
+      cache = key ? get_dir (key, device, dir) : NULL;
+      grub_free (key);
       grub_free (dir);
 
-      if (grub_errno)
+      if (! cache)
 	{
 	  ret = 1;
 	  goto fail;
 	}
+
+      if (cmdline_state == GRUB_PARSER_STATE_DQUOTE)
+	prefix = "\" ";
+      else if (cmdline_state == GRUB_PARSER_STATE_QUOTE)
+	prefix = "\' ";
+      else
+	prefix = " ";
+
+      for (i = 0; i < cache->nitems; i++)
+	{
+	  char *fname;
+
+	  if (! cache->items[i].dir)
+	    {
+	      if (add_completion (cache->items[i].name, prefix,
+				  GRUB_COMPLETION_TYPE_FILE))
+		{
+		  ret = 1;
+		  goto fail;
+		}
+	      continue;
+	    }
+
+	  fname = grub_xasprintf ("%s/", cache->items[i].name);
+	  if (! fname || add_completion (fname, "", GRUB_COMPLETION_TYPE_FILE))
+	    {
+	      grub_free (fname);
+	      ret = 1;
+	      goto fail;
+	    }
+	  grub_free (fname);
+	}
     }
   else
     {
+      dev = grub_device_open (device);
+      if (! dev)
+	{
+	  ret = 1;
+	  goto fail;
+	}
+
+      fs = grub_fs_probe (dev);
+      if (! fs)
+	{
+	  ret = 1;
+	  goto fail;
+	}
+
       current_word += grub_strlen (current_word);
       match = grub_strdup ("/");
       if (! match)
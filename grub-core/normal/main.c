@@ -174,6 +174,7 @@ read_config_file (const char *config)
   grub_env_export ("config_file");
   grub_env_export ("config_directory");
 
+  grub_boot_trace_begin ("script", "config", config);
   while (1)
     {
       char *line;
@@ -188,6 +189,7 @@ read_config_file (const char *config)
       grub_normal_parse_line (line, read_config_file_getline, file);
       grub_free (line);
     }
+  grub_boot_trace_end ("script", "config", config);
 
   if (old_file)
     grub_env_set ("config_file", old_file);
@@ -578,6 +578,8 @@ destroy_screen (struct screen *screen)
   grub_free (screen->lines);
   grub_free (screen->terms);
   grub_free (screen);
+
+  grub_normal_completion_flush ();
 }
 
 /* Make a new screen.  */
@@ -1424,6 +1426,8 @@ grub_menu_entry_run (grub_menu_entry_t entry)
 	case GRUB_TERM_CTRL | 'x':
 	case GRUB_TERM_KEY_F10:
 	  run (screen);
+	  /* The entry may have added devices or files.  */
+	  grub_normal_completion_flush ();
 	  goto refresh;
 
 	case GRUB_TERM_CTRL | 'r':
@@ -0,0 +1,5 @@
+#if defined (__MINGW32__) || defined (__CYGWIN__)
+#include "basic/profile.c"
+#else
+#include "unix/profile.c"
+#endif
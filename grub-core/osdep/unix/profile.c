@@ -0,0 +1,113 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config-util.h>
+#include <config.h>
+
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <grub/emu/misc.h>
+
+static void (*profile_sample) (void *pc);
+static struct sigaction profile_old_action;
+
+static void *
+profile_pc (void *uc_ptr)
+{
+#if defined (__linux__)
+  ucontext_t *uc = uc_ptr;
+#if defined (__x86_64__)
+  return (void *) uc->uc_mcontext.gregs[REG_RIP];
+#elif defined (__i386__)
+  return (void *) uc->uc_mcontext.gregs[REG_EIP];
+#elif defined (__aarch64__)
+  return (void *) uc->uc_mcontext.pc;
+#elif defined (__arm__)
+  return (void *) uc->uc_mcontext.arm_pc;
+#elif defined (__powerpc__)
+  return (void *) uc->uc_mcontext.regs->nip;
+#else
+  (void) uc;
+  return NULL;
+#endif
+#elif defined (__FreeBSD__) && defined (__x86_64__)
+  return (void *) ((ucontext_t *) uc_ptr)->uc_mcontext.mc_rip;
+#else
+  (void) uc_ptr;
+  return NULL;
+#endif
+}
+
+static void
+profile_handler (int sig __attribute__ ((unused)),
+		 siginfo_t *info __attribute__ ((unused)), void *uc)
+{
+  if (profile_sample)
+    profile_sample (profile_pc (uc));
+}
+
+int
+grub_util_profile_start (unsigned hz, void (*sample) (void *pc))
+{
+  struct sigaction sa;
+  struct itimerval it;
+
+  if (!hz || hz > 1000000)
+    return -1;
+
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_sigaction = profile_handler;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset (&sa.sa_mask);
+
+  profile_sample = sample;
+  if (sigaction (SIGPROF, &sa, &profile_old_action) < 0)
+    {
+      profile_sample = NULL;
+      return -1;
+    }
+
+  it.it_interval.tv_sec = 0;
+  it.it_interval.tv_usec = 1000000 / hz;
+  it.it_value = it.it_interval;
+  if (setitimer (ITIMER_PROF, &it, NULL) < 0)
+    {
+      sigaction (SIGPROF, &profile_old_action, NULL);
+      profile_sample = NULL;
+      return -1;
+    }
+
+  return 0;
+}
+
+void
+grub_util_profile_stop (void)
+{
+  struct itimerval it;
+
+  if (!profile_sample)
+    return;
+
+  memset (&it, 0, sizeof (it));
+  setitimer (ITIMER_PROF, &it, NULL);
+  sigaction (SIGPROF, &profile_old_action, NULL);
+  profile_sample = NULL;
+}
@@ -19,9 +19,124 @@
 
 #include <grub/mm.h>
 #include <grub/misc.h>
+#include <grub/i18n.h>
 #include <grub/script_sh.h>
 #include <grub/safemath.h>
 
+/* Arguments used to be built with a realloc for every fragment appended,
+   several per word of a command line.  They now come from chunks of an
+   arena that lives as long as the command, the first one of which is
+   usually the chunk kept from the previous command.  */
+#define ARENA_CHUNK_SIZE	1024
+
+struct grub_script_arena_chunk
+{
+  struct grub_script_arena_chunk *next;
+  grub_size_t size;
+  grub_size_t used;
+};
+
+static struct grub_script_arena_chunk *arena_spare;
+
+static char *
+chunk_data (struct grub_script_arena_chunk *chunk)
+{
+  return (char *) (chunk + 1);
+}
+
+void *
+grub_script_arena_alloc (struct grub_script_arena *arena, grub_size_t size)
+{
+  struct grub_script_arena_chunk *chunk = arena->chunks;
+  grub_size_t start = 0, chunk_size;
+
+  if (chunk)
+    start = ALIGN_UP (chunk->used, sizeof (void *));
+
+  if (! chunk || start > chunk->size || size > chunk->size - start)
+    {
+      chunk_size = chunk ? chunk->size * 2 : ARENA_CHUNK_SIZE;
+      while (chunk_size < size)
+	if (grub_mul (chunk_size, 2, &chunk_size))
+	  {
+	    grub_error (GRUB_ERR_OUT_OF_RANGE, N_("overflow is detected"));
+	    return NULL;
+	  }
+
+      if (chunk_size == ARENA_CHUNK_SIZE && arena_spare)
+	{
+	  chunk = arena_spare;
+	  arena_spare = NULL;
+	}
+      else
+	{
+	  grub_size_t sz;
+
+	  if (grub_add (chunk_size, sizeof (*chunk), &sz))
+	    {
+	      grub_error (GRUB_ERR_OUT_OF_RANGE, N_("overflow is detected"));
+	      return NULL;
+	    }
+	  chunk = grub_malloc (sz);
+	  if (! chunk)
+	    return NULL;
+	  chunk->size = chunk_size;
+	}
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+      start = 0;
+    }
+
+  chunk->used = start + size;
+  arena->last = chunk_data (chunk) + start;
+  return arena->last;
+}
+
+/* Like grub_realloc, for PTR of OLD_SIZE bytes allocated from ARENA.  */
+void *
+grub_script_arena_grow (struct grub_script_arena *arena, void *ptr,
+			grub_size_t old_size, grub_size_t size)
+{
+  struct grub_script_arena_chunk *chunk = arena->chunks;
+  char *p;
+
+  if (ptr && ptr == arena->last
+      && size <= chunk->size - ((char *) ptr - chunk_data (chunk)))
+    {
+      chunk->used = ((char *) ptr - chunk_data (chunk)) + size;
+      return ptr;
+    }
+
+  p = grub_script_arena_alloc (arena, size);
+  if (p && ptr)
+    grub_memcpy (p, ptr, old_size < size ? old_size : size);
+  return p;
+}
+
+void
+grub_script_arena_release (struct grub_script_arena *arena)
+{
+  struct grub_script_arena_chunk *chunk, *next;
+
+  for (chunk = arena->chunks; chunk; chunk = next)
+    {
+      next = chunk->next;
+      if (chunk->size == ARENA_CHUNK_SIZE && ! arena_spare)
+	arena_spare = chunk;
+      else
+	grub_free (chunk);
+    }
+  arena->chunks = NULL;
+  arena->last = NULL;
+}
+
+void
+grub_script_arena_fini (void)
+{
+  grub_free (arena_spare);
+  arena_spare = NULL;
+}
+
 /* Return nearest power of two that is >= v.  */
 static unsigned
 round_up_exp (unsigned v)
@@ -41,12 +156,25 @@ round_up_exp (unsigned v)
   return v;
 }
 
+/* Resize PTR, which holds OLD_SIZE bytes when OLD_SIZE isn't zero.  */
+static void *
+argv_realloc (struct grub_script_argv *argv, void *ptr, grub_size_t old_size,
+	      grub_size_t size)
+{
+  if (! argv->arena)
+    return grub_realloc (ptr, size);
+  if (ptr && size <= old_size)
+    return ptr;
+  return grub_script_arena_grow (argv->arena, ptr, old_size, size);
+}
+
 void
 grub_script_argv_free (struct grub_script_argv *argv)
 {
   unsigned i;
 
-  if (argv->args)
+  /* The arena owner releases the arguments.  */
+  if (argv->args && ! argv->arena)
     {
       for (i = 0; i < argv->argc; i++)
 	grub_free (argv->args[i]);
@@ -64,7 +192,7 @@ int
 grub_script_argv_make (struct grub_script_argv *argv, int argc, char **args)
 {
   int i;
-  struct grub_script_argv r = { 0, 0, 0 };
+  struct grub_script_argv r = { 0, 0, 0, 0 };
 
   for (i = 0; i < argc; i++)
     if (grub_script_argv_next (&r)
@@ -82,7 +210,7 @@ int
 grub_script_argv_next (struct grub_script_argv *argv)
 {
   char **p = argv->args;
-  grub_size_t sz;
+  grub_size_t sz, old_sz = 0;
 
   if (argv->args && argv->argc && argv->args[argv->argc - 1] == 0)
     return 0;
@@ -91,7 +219,9 @@ grub_script_argv_next (struct grub_script_argv *argv)
       grub_mul (sz, sizeof (char *), &sz))
     return 1;
 
-  p = grub_realloc (p, round_up_exp (sz));
+  if (p)
+    old_sz = round_up_exp ((argv->argc + 1) * sizeof (char *));
+  p = argv_realloc (argv, p, old_sz, round_up_exp (sz));
   if (! p)
     return 1;
 
@@ -111,7 +241,7 @@ grub_script_argv_append (struct grub_script_argv *argv, const char *s,
 {
   grub_size_t a;
   char *p = argv->args[argv->argc - 1];
-  grub_size_t sz;
+  grub_size_t sz, old_sz = 0;
 
   if (! s)
     return 0;
@@ -123,7 +253,9 @@ grub_script_argv_append (struct grub_script_argv *argv, const char *s,
       grub_mul (sz, sizeof (char), &sz))
     return 1;
 
-  p = grub_realloc (p, round_up_exp (sz));
+  if (p)
+    old_sz = round_up_exp (a + 1);
+  p = argv_realloc (argv, p, old_sz, round_up_exp (sz));
   if (! p)
     return 1;
 
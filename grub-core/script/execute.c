@@ -94,36 +94,31 @@ wildcard_escape (const char *s)
   return p;
 }
 
-static char*
-wildcard_unescape (const char *s)
+/* Undo wildcard_escape on S, in place.  */
+static void
+wildcard_unescape (char *s)
 {
-  int i;
-  int len;
+  char *p = s;
   char ch;
-  char *p;
 
-  len = grub_strlen (s);
-  p = grub_malloc (len + 1);
-  if (! p)
-    return NULL;
-
-  i = 0;
   while ((ch = *s++))
     {
       if (ch == '\\' && s[0] == 'x' && is_hex(s[1]) && is_hex(s[2]))
 	{
-	  p[i++] = '\\';
-	  p[i++] = *s++;
-	  p[i++] = *s++;
-	  p[i++] = *s++;
+	  *p++ = '\\';
+	  *p++ = *s++;
+	  *p++ = *s++;
+	  *p++ = *s++;
 	}
       else if (ch == '\\')
-	p[i++] = *s++;
+	{
+	  if (*s)
+	    *p++ = *s++;
+	}
       else
-	p[i++] = ch;
+	*p++ = ch;
     }
-  p[i] = '\0';
-  return p;
+  *p = '\0';
 }
 
 static void
@@ -211,7 +206,7 @@ grub_script_setparams (grub_command_t cmd __attribute__((unused)),
 		       int argc, char **args)
 {
   struct grub_script_scope *new_scope;
-  struct grub_script_argv argv = { 0, 0, 0 };
+  struct grub_script_argv argv = { 0, 0, 0, 0 };
 
   if (! scope)
     return GRUB_ERR_INVALID_COMMAND;
@@ -283,10 +278,11 @@ grub_env_special (const char *name)
 }
 
 static char **
-grub_script_env_get (const char *name, grub_script_arg_type_t type)
+grub_script_env_get (const char *name, grub_script_arg_type_t type,
+		     struct grub_script_arena *arena)
 {
   unsigned i;
-  struct grub_script_argv result = { 0, 0, 0 };
+  struct grub_script_argv result = { 0, 0, 0, arena };
 
   if (grub_script_argv_next (&result))
     goto fail;
@@ -382,8 +378,6 @@ grub_script_env_get (const char *name, grub_script_arg_type_t type)
   return result.args;
 
  fail:
-
-  grub_script_argv_free (&result);
   return 0;
 }
 
@@ -625,21 +619,39 @@ gettext_append (struct grub_script_argv *result, const char *orig_str)
   return rval;
 }
 
+/* Whether wildcard_escape would change S.  */
+static int
+needs_escape (const char *s)
+{
+  for (; *s; s++)
+    if (*s == '*' || *s == '\\' || *s == '?')
+      return 1;
+  return 0;
+}
+
 static int
 append (struct grub_script_argv *result,
 	const char *s, int escape_type)
 {
   int r;
-  char *p = 0;
+  char *p;
+  grub_size_t start;
 
-  if (escape_type == 0)
+  if (escape_type == 0 || (escape_type > 0 && ! needs_escape (s)))
     return grub_script_argv_append (result, s, grub_strlen (s));
 
-  if (escape_type > 0)
-    p = wildcard_escape (s);
-  else if (escape_type < 0)
-    p = wildcard_unescape (s);
+  if (escape_type < 0)
+    {
+      /* Unescaping only ever shortens the string.  */
+      p = result->args[result->argc - 1];
+      start = p ? grub_strlen (p) : 0;
+      if (grub_script_argv_append (result, s, grub_strlen (s)))
+	return 1;
+      wildcard_unescape (result->args[result->argc - 1] + start);
+      return 0;
+    }
 
+  p = wildcard_escape (s);
   if (! p)
     return 1;
 
@@ -648,15 +660,16 @@ append (struct grub_script_argv *result,
   return r;
 }
 
-/* Convert arguments in ARGLIST into ARGV form.  */
+/* Convert arguments in ARGLIST into ARGV form, allocated from ARENA.  */
 static int
 grub_script_arglist_to_argv (struct grub_script_arglist *arglist,
-			     struct grub_script_argv *argv)
+			     struct grub_script_argv *argv,
+			     struct grub_script_arena *arena)
 {
   int i;
   char **values = 0;
   struct grub_script_arg *arg = 0;
-  struct grub_script_argv result = { 0, 0, 0 };
+  struct grub_script_argv result = { 0, 0, 0, arena };
 
   if (arglist == NULL)
     return 1;
@@ -673,73 +686,48 @@ grub_script_arglist_to_argv (struct grub_script_arglist *arglist,
 	    {
 	    case GRUB_SCRIPT_ARG_TYPE_VAR:
 	    case GRUB_SCRIPT_ARG_TYPE_DQVAR:
-	      {
-		int need_cleanup = 0;
-
-		values = grub_script_env_get (arg->str, arg->type);
-		for (i = 0; values && values[i]; i++)
-		  {
-		    if (!need_cleanup)
-		      {
-			if (i != 0 && grub_script_argv_next (&result))
-			  {
-			    need_cleanup = 1;
-			    goto cleanup;
-			  }
-
-			if (arg->type == GRUB_SCRIPT_ARG_TYPE_VAR)
-			  {
-			    int len;
-			    char ch;
-			    char *p;
-			    char *op;
-			    const char *s = values[i];
-
-			    len = grub_strlen (values[i]);
-			    /* \? -> \\\? */
-			    /* \* -> \\\* */
-			    /* \ -> \\ */
-			    p = grub_malloc (len * 2 + 1);
-			    if (! p)
-			      {
-				need_cleanup = 1;
-				goto cleanup;
-			      }
-
-			    op = p;
-			    while ((ch = *s++))
-			      {
-				if (ch == '\\')
-				  {
-				    *op++ = '\\';
-				    if (*s == '?' || *s == '*')
-				      *op++ = '\\';
-				  }
-				*op++ = ch;
-			      }
-			    *op = '\0';
-
-			    need_cleanup = grub_script_argv_append (&result, p, op - p);
-			    grub_free (p);
-			    /* Fall through to cleanup */
-			  }
-			else
-			  {
-			    need_cleanup = append (&result, values[i], 1);
-			    /* Fall through to cleanup */
-			  }
-		      }
-
-cleanup:
-		    grub_free (values[i]);
-		  }
-		grub_free (values);
-
-		if (need_cleanup)
-		  goto fail;
+	      values = grub_script_env_get (arg->str, arg->type, arena);
+	      for (i = 0; values && values[i]; i++)
+		{
+		  if (i != 0 && grub_script_argv_next (&result))
+		    goto fail;
 
-		break;
-	      }
+		  if (arg->type == GRUB_SCRIPT_ARG_TYPE_VAR)
+		    {
+		      int len;
+		      char ch;
+		      char *p;
+		      char *op;
+		      const char *s = values[i];
+
+		      len = grub_strlen (values[i]);
+		      /* \? -> \\\? */
+		      /* \* -> \\\* */
+		      /* \ -> \\ */
+		      p = grub_script_arena_alloc (arena, len * 2 + 1);
+		      if (! p)
+			goto fail;
+
+		      op = p;
+		      while ((ch = *s++))
+			{
+			  if (ch == '\\')
+			    {
+			      *op++ = '\\';
+			      if (*s == '?' || *s == '*')
+				*op++ = '\\';
+			    }
+			  *op++ = ch;
+			}
+		      *op = '\0';
+
+		      if (grub_script_argv_append (&result, p, op - p))
+			goto fail;
+		    }
+		  else if (append (&result, values[i], 1))
+		    goto fail;
+		}
+	      break;
 
 	    case GRUB_SCRIPT_ARG_TYPE_BLOCK:
 	      {
@@ -803,15 +791,13 @@ cleanup:
       if (grub_wildcard_translator
 	  && grub_wildcard_translator->expand (unexpanded.args[i],
 					       &expansions))
-	{
-	  grub_script_argv_free (&unexpanded);
-	  goto fail;
-	}
+	goto fail;
 
       if (! expansions)
 	{
-	  grub_script_argv_next (&result);
-	  append (&result, unexpanded.args[i], -1);
+	  if (grub_script_argv_next (&result)
+	      || append (&result, unexpanded.args[i], -1))
+	    goto fail;
 	}
       else
 	{
@@ -822,22 +808,16 @@ cleanup:
 	      grub_free (expansions[j]);
 	    }
 	  grub_free (expansions);
-	  
+
 	  if (failed)
-	    {
-	      grub_script_argv_free (&unexpanded);
-	      goto fail;
-	    }
+	    goto fail;
 	}
     }
-  grub_script_argv_free (&unexpanded);
-
   *argv = result;
   return 0;
 
  fail:
-
-  grub_script_argv_free (&result);
+  /* Everything is released with the arena.  */
   return 1;
 }
 
@@ -974,36 +954,43 @@ grub_script_execute_cmdline (struct grub_script_cmd *cmd)
   grub_script_function_t func = 0;
   char errnobuf[18];
   char *cmdname, *cmdstring;
-  int argc, offset = 0, cmdlen = 0;
+  int argc, offset = 0, cmdlen = 0, len;
   unsigned int i;
   char **args;
   int invert;
-  struct grub_script_argv argv = { 0, 0, 0 };
+  struct grub_script_arena arena = { 0, 0 };
+  struct grub_script_argv argv = { 0, 0, 0, 0 };
 
   /* Lookup the command.  */
-  if (grub_script_arglist_to_argv (cmdline->arglist, &argv) || ! argv.args || ! argv.args[0])
-    return grub_errno;
+  if (grub_script_arglist_to_argv (cmdline->arglist, &argv, &arena)
+      || ! argv.args || ! argv.args[0])
+    {
+      grub_script_arena_release (&arena);
+      return grub_errno;
+    }
 
   for (i = 0; i < argv.argc; i++)
     {
       cmdlen += grub_strlen (argv.args[i]) + 1;
     }
 
-  cmdstring = grub_malloc (cmdlen);
+  cmdstring = grub_script_arena_alloc (&arena, cmdlen);
   if (!cmdstring)
     {
+      grub_script_arena_release (&arena);
       return grub_error (GRUB_ERR_OUT_OF_MEMORY,
 			 N_("cannot allocate command buffer"));
     }
 
   for (i = 0; i < argv.argc; i++)
     {
-      offset += grub_snprintf (cmdstring + offset, cmdlen - offset, "%s ",
-			       argv.args[i]);
+      len = grub_strlen (argv.args[i]);
+      grub_memcpy (cmdstring + offset, argv.args[i], len);
+      offset += len;
+      cmdstring[offset++] = ' ';
     }
   cmdstring[cmdlen - 1] = '\0';
   grub_verify_string (cmdstring, GRUB_VERIFY_COMMAND);
-  grub_free (cmdstring);
   invert = 0;
   argc = argv.argc - 1;
   args = argv.args + 1;
@@ -1012,7 +999,7 @@ grub_script_execute_cmdline (struct grub_script_cmd *cmd)
     {
       if (argv.argc < 2 || ! argv.args[1])
 	{
-	  grub_script_argv_free (&argv);
+	  grub_script_arena_release (&arena);
 	  return grub_error (GRUB_ERR_BAD_ARGUMENT,
 			     N_("no command is specified"));
 	}
@@ -1050,7 +1037,7 @@ grub_script_execute_cmdline (struct grub_script_cmd *cmd)
 	  grub_snprintf (errnobuf, sizeof (errnobuf), "%d", grub_errno);
 	  grub_script_env_set ("?", errnobuf);
 
-	  grub_script_argv_free (&argv);
+	  grub_script_arena_release (&arena);
 	  grub_print_error ();
 
 	  return 0;
@@ -1058,6 +1045,7 @@ grub_script_execute_cmdline (struct grub_script_cmd *cmd)
     }
 
   /* Execute the GRUB command or function.  */
+  grub_boot_trace_begin ("cmd", "exec", cmdname);
   if (grubcmd)
     {
       if (grub_extractor_level && !(grubcmd->flags
@@ -1073,6 +1061,7 @@ grub_script_execute_cmdline (struct grub_script_cmd *cmd)
     }
   else
     ret = grub_script_function_call (func, argc, args);
+  grub_boot_trace_end ("cmd", "exec", cmdname);
 
   if (invert)
     {
@@ -1088,7 +1077,7 @@ grub_script_execute_cmdline (struct grub_script_cmd *cmd)
     }
 
   /* Free arguments.  */
-  grub_script_argv_free (&argv);
+  grub_script_arena_release (&arena);
 
   if (grub_errno == GRUB_ERR_TEST_FAILURE)
     grub_errno = GRUB_ERR_NONE;
@@ -1154,11 +1143,15 @@ grub_script_execute_cmdfor (struct grub_script_cmd *cmd)
 {
   unsigned i;
   grub_err_t result;
-  struct grub_script_argv argv = { 0, 0, 0 };
+  struct grub_script_arena arena = { 0, 0 };
+  struct grub_script_argv argv = { 0, 0, 0, 0 };
   struct grub_script_cmdfor *cmdfor = (struct grub_script_cmdfor *) cmd;
 
-  if (grub_script_arglist_to_argv (cmdfor->words, &argv))
-    return grub_errno;
+  if (grub_script_arglist_to_argv (cmdfor->words, &argv, &arena))
+    {
+      grub_script_arena_release (&arena);
+      return grub_errno;
+    }
 
   active_loops++;
   result = 0;
@@ -1180,7 +1173,7 @@ grub_script_execute_cmdfor (struct grub_script_cmd *cmd)
     active_breaks--;
 
   active_loops--;
-  grub_script_argv_free (&argv);
+  grub_script_arena_release (&arena);
   return result;
 }
 
@@ -28,7 +28,9 @@ grub_normal_parse_line (char *line,
   struct grub_script *parsed_script;
 
   /* Parse the script.  */
+  grub_boot_trace_begin ("script", "parse", NULL);
   parsed_script = grub_script_parse (line, getline, getline_data);
+  grub_boot_trace_end ("script", "parse", NULL);
 
   if (parsed_script)
     {
@@ -95,4 +97,6 @@ grub_script_fini (void)
   if (cmd_return)
     grub_unregister_command (cmd_return);
   cmd_return = 0;
+
+  grub_script_arena_fini ();
 }
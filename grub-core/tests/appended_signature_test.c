@@ -55,6 +55,17 @@ static struct grub_procfs_entry case_name ## _entry = \
   grub_procfs_unregister (&case_name ## _entry); \
 }
 
+#ifdef APPENDED_SIGNATURE_BENCH
+#define BENCH_ITERATIONS 32
+
+#define DO_BENCH(case_name) \
+{ \
+  grub_procfs_register (#case_name, &case_name ## _entry); \
+  do_bench ("(proc)/" #case_name); \
+  grub_procfs_unregister (&case_name ## _entry); \
+}
+#endif
+
 
 DEFINE_TEST_CASE (hi_signed);
 DEFINE_TEST_CASE (hi_signed_sha256);
@@ -157,6 +168,41 @@ do_verify (const char *f, int is_valid)
 
 }
 
+#ifdef APPENDED_SIGNATURE_BENCH
+/* Report how many verifications per second the current trust store allows.
+   It takes a while, so it is only built with APPENDED_SIGNATURE_BENCH.  */
+static void
+do_bench (const char *f)
+{
+  grub_command_t cmd;
+  char *args[] = { (char *) f, NULL };
+  grub_uint64_t start, elapsed;
+  unsigned i;
+
+  cmd = grub_command_find ("verify_appended");
+  if (!cmd)
+    return;
+
+  start = grub_get_time_ms ();
+  for (i = 0; i < BENCH_ITERATIONS; i++)
+    if ((cmd->func) (cmd, 1, args) != GRUB_ERR_NONE)
+      {
+	grub_test_assert (0, "verification of %s failed during benchmark: %s",
+			  f, grub_errmsg);
+	grub_errno = GRUB_ERR_NONE;
+	return;
+      }
+  elapsed = grub_get_time_ms () - start;
+
+  grub_printf ("%s: %u verifications in %" PRIuGRUB_UINT64_T " ms",
+	       f, BENCH_ITERATIONS, elapsed);
+  if (elapsed)
+    grub_printf (" (%" PRIuGRUB_UINT64_T " verifications/s)",
+		 grub_divmod64 (BENCH_ITERATIONS * 1000ULL, elapsed, 0));
+  grub_printf ("\n");
+}
+#endif
+
 static void
 appended_signature_test (void)
 {
@@ -263,6 +309,12 @@ appended_signature_test (void)
 		    grub_errmsg);
   DO_TEST (hi_signed, 1);
 
+#ifdef APPENDED_SIGNATURE_BENCH
+  /* Both keys are trusted now, time verification with the list in place.  */
+  DO_BENCH (hi_signed);
+  DO_BENCH (hi_signed_2nd);
+#endif
+
   /* Remove the first certificate in the list, giving us just [#2] */
   err = (cmd_distrust->func) (cmd_distrust, 1, distrust_args);
   grub_test_assert (err == GRUB_ERR_NONE,
@@ -0,0 +1,237 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/test.h>
+#include <grub/dl.h>
+#include <grub/misc.h>
+#include <grub/mm.h>
+#include <grub/time.h>
+
+GRUB_MOD_LICENSE ("GPLv3+");
+
+#define BUF_SIZE	512
+#define MAX_LEN		200
+#define MAX_OFFSET	16
+
+static grub_uint8_t src[BUF_SIZE], dst[BUF_SIZE], ref[BUF_SIZE];
+
+static void
+fill (grub_uint8_t *buf, grub_size_t size, grub_uint8_t seed)
+{
+  grub_size_t i;
+
+  for (i = 0; i < size; i++)
+    buf[i] = seed + i * 7 + (i >> 8);
+}
+
+/* Copy into REF the way the reference byte loop would.  */
+static void
+ref_move (grub_uint8_t *buf, grub_size_t to, grub_size_t from,
+	  grub_size_t len)
+{
+  grub_size_t i;
+
+  if (to < from)
+    for (i = 0; i < len; i++)
+      buf[to + i] = buf[from + i];
+  else
+    for (i = len; i > 0; i--)
+      buf[to + i - 1] = buf[from + i - 1];
+}
+
+static int
+same (const grub_uint8_t *a, const grub_uint8_t *b, grub_size_t size)
+{
+  grub_size_t i;
+
+  for (i = 0; i < size; i++)
+    if (a[i] != b[i])
+      return 0;
+  return 1;
+}
+
+static void
+copy_test (void)
+{
+  grub_size_t so, d_o, len, i;
+
+  for (so = 0; so < MAX_OFFSET; so++)
+    for (d_o = 0; d_o < MAX_OFFSET; d_o++)
+      for (len = 0; len <= MAX_LEN; len++)
+	{
+	  fill (src, BUF_SIZE, len);
+	  fill (dst, BUF_SIZE, 0x55);
+	  fill (ref, BUF_SIZE, 0x55);
+	  grub_memcpy (dst + d_o, src + so, len);
+	  for (i = 0; i < len; i++)
+	    ref[d_o + i] = src[so + i];
+	  grub_test_assert (same (dst, ref, BUF_SIZE),
+			    "memcpy of %" PRIuGRUB_SIZE " bytes from +%"
+			    PRIuGRUB_SIZE " to +%" PRIuGRUB_SIZE " wrong",
+			    len, so, d_o);
+	}
+}
+
+static void
+move_test (void)
+{
+  grub_size_t from, to, len;
+
+  for (from = 0; from < 2 * MAX_OFFSET; from++)
+    for (to = 0; to < 2 * MAX_OFFSET; to++)
+      for (len = 0; len <= MAX_LEN; len++)
+	{
+	  fill (dst, BUF_SIZE, len);
+	  fill (ref, BUF_SIZE, len);
+	  grub_memmove (dst + to, dst + from, len);
+	  ref_move (ref, to, from, len);
+	  grub_test_assert (same (dst, ref, BUF_SIZE),
+			    "memmove of %" PRIuGRUB_SIZE " bytes from +%"
+			    PRIuGRUB_SIZE " to +%" PRIuGRUB_SIZE " wrong",
+			    len, from, to);
+
+	  /* grub_memcpy has always tolerated overlapping buffers.  */
+	  fill (dst, BUF_SIZE, len);
+	  grub_memcpy (dst + to, dst + from, len);
+	  grub_test_assert (same (dst, ref, BUF_SIZE),
+			    "overlapping memcpy of %" PRIuGRUB_SIZE
+			    " bytes from +%" PRIuGRUB_SIZE " to +%"
+			    PRIuGRUB_SIZE " wrong", len, from, to);
+	}
+}
+
+static void
+cmp_test (void)
+{
+  grub_size_t so, d_o, len, pos;
+
+  for (so = 0; so < MAX_OFFSET; so++)
+    for (d_o = 0; d_o < MAX_OFFSET; d_o++)
+      for (len = 0; len <= MAX_LEN; len += 3)
+	{
+	  fill (src, BUF_SIZE, 0);
+	  grub_memmove (dst + d_o, src + so, len);
+	  grub_test_assert (grub_memcmp (dst + d_o, src + so, len) == 0,
+			    "memcmp of %" PRIuGRUB_SIZE " equal bytes",
+			    len);
+	  for (pos = 0; pos < len; pos++)
+	    {
+	      src[so + pos] = 0x10;
+	      dst[d_o + pos] = 0x90;
+	      grub_test_assert (grub_memcmp (dst + d_o, src + so, len) > 0
+				&& grub_memcmp (src + so, dst + d_o, len) < 0,
+				"memcmp of %" PRIuGRUB_SIZE
+				" bytes differing at %" PRIuGRUB_SIZE,
+				len, pos);
+	      dst[d_o + pos] = src[so + pos] = 0;
+	    }
+	}
+
+  /* Only the first difference counts, whatever the byte order.  */
+  grub_memset (src, 0, 16);
+  grub_memset (dst, 0, 16);
+  src[3] = 1;
+  dst[4] = 0xff;
+  grub_test_assert (grub_memcmp (src, dst, 16) > 0,
+		    "memcmp doesn't stop at the first difference");
+}
+
+#ifdef MEM_TEST_BENCH
+/* Bytes copied for each size of the benchmark, so that small sizes run
+   long enough to be timed.  */
+#define BENCH_BYTES	(64 << 20)
+
+static const grub_size_t bench_sizes[] =
+  {
+    1, 16, 256, 4096, 65536, 1 << 20, 16 << 20, 64 << 20
+  };
+
+static void
+bench_one (const char *name, grub_uint8_t *to, grub_uint8_t *from,
+	   grub_size_t size,
+	   void *(*func) (void *dest, const void *src, grub_size_t n))
+{
+  grub_uint64_t start, elapsed, rate;
+  grub_size_t rounds, i;
+
+  rounds = BENCH_BYTES / size;
+  if (rounds == 0)
+    rounds = 1;
+
+  start = grub_get_time_ms ();
+  for (i = 0; i < rounds; i++)
+    func (to, from, size);
+  elapsed = grub_get_time_ms () - start;
+
+  if (elapsed == 0)
+    elapsed = 1;
+  rate = grub_divmod64 ((grub_uint64_t) size * rounds * 1000,
+			elapsed << 20, 0);
+  grub_printf ("%s %" PRIuGRUB_SIZE " bytes: %" PRIuGRUB_UINT64_T
+	       " MiB/s\n", name, size, rate);
+}
+
+/* Not a pass/fail test: the results are only printed, for comparing
+   builds and machines.  It takes seconds, so it is only built when
+   MEM_TEST_BENCH is defined.  */
+static void
+bench (void)
+{
+  grub_uint8_t *a, *b;
+  grub_size_t size, i;
+
+  for (i = 0; i < ARRAY_SIZE (bench_sizes); i++)
+    {
+      size = bench_sizes[i];
+      a = grub_malloc (size + 1);
+      b = grub_malloc (size + 1);
+      if (!a || !b)
+	{
+	  grub_printf ("%" PRIuGRUB_SIZE " bytes: out of memory, skipped\n",
+		       size);
+	  grub_free (a);
+	  grub_free (b);
+	  grub_errno = GRUB_ERR_NONE;
+	  break;
+	}
+      grub_memset (a, 0x5a, size + 1);
+      grub_memset (b, 0xa5, size + 1);
+
+      bench_one ("memcpy", b, a, size, grub_memcpy);
+      /* Different alignments take the byte loop outside of x86.  */
+      bench_one ("memcpy unaligned", b + 1, a, size, grub_memcpy);
+      bench_one ("memmove overlapping", a + 1, a, size, grub_memmove);
+
+      grub_free (a);
+      grub_free (b);
+    }
+}
+#endif
+
+static void
+mem_test (void)
+{
+  copy_test ();
+  move_test ();
+  cmp_test ();
+#ifdef MEM_TEST_BENCH
+  bench ();
+#endif
+}
+
+GRUB_FUNCTIONAL_TEST (mem_test, mem_test);
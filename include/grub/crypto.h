@@ -251,7 +251,8 @@ typedef struct gcry_pk_spec
 struct grub_crypto_cipher_handle
 {
   const struct gcry_cipher_spec *cipher;
-  char ctx[0];
+  /* Hardware cipher implementations need an aligned key schedule.  */
+  char ctx[0] __attribute__ ((aligned (16)));
 };
 
 typedef struct grub_crypto_cipher_handle *grub_crypto_cipher_handle_t;
@@ -407,6 +408,11 @@ void _gcry_assert_failed (const char *expr, const char *file, int line,
                           const char *func) __attribute__ ((noreturn));
 
 void _gcry_burn_stack (int bytes);
+
+/* CPU features usable by the ciphers; values match libgcrypt's HWF_*.  */
+#define GRUB_CRYPTO_HWF_INTEL_AESNI 256
+
+unsigned int grub_crypto_get_hw_features (void);
 void _gcry_log_error( const char *fmt, ... )  __attribute__ ((format (__printf__, 1, 2)));
 
 
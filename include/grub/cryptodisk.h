@@ -109,6 +109,9 @@ struct grub_cryptodisk
   grub_uint64_t last_rekey;
   int rekey_derived_size;
   grub_disk_addr_t partition_start;
+  /* Read statistics: calls to the read handler and sectors decrypted.  */
+  grub_uint64_t stat_reads;
+  grub_uint64_t stat_sectors;
 };
 typedef struct grub_cryptodisk *grub_cryptodisk_t;
 
@@ -170,4 +173,9 @@ grub_util_get_geli_uuid (const char *dev);
 grub_cryptodisk_t grub_cryptodisk_get_by_uuid (const char *uuid);
 grub_cryptodisk_t grub_cryptodisk_get_by_source_disk (grub_disk_t disk);
 
+/* Keyslot that last unlocked DEV, or -1 if it isn't known.  */
+int grub_cryptodisk_get_last_keyslot (grub_cryptodisk_t dev);
+void grub_cryptodisk_set_last_keyslot (grub_cryptodisk_t dev,
+				       grub_uint64_t slot);
+
 #endif
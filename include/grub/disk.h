@@ -135,6 +135,13 @@ struct grub_disk
   /* The id used by the disk cache manager.  */
   unsigned long id;
 
+  /* If non-zero, reads through this handle bypass the disk cache.  Used
+     by stacked devices which cache their own (transformed) data.  */
+  int nocache;
+
+  /* I/O counters, shared by all handles of this device.  May be NULL.  */
+  struct grub_disk_stats *stats;
+
   /* The partition information. This is machine-specific.  */
   struct grub_partition *partition;
 
@@ -150,6 +157,60 @@ struct grub_disk
 };
 typedef struct grub_disk *grub_disk_t;
 
+/* Device reads are bucketed by size from 512 bytes (bucket 0) up to 1MiB
+   and more (the last bucket).  */
+#define GRUB_DISK_STATS_SIZE_BUCKETS	12
+
+/* Counters kept per device for the whole GRUB session.  */
+struct grub_disk_stats
+{
+  struct grub_disk_stats *next;
+  char *name;
+  unsigned long dev_id;
+  unsigned long disk_id;
+
+  /* Calls of grub_disk_read and the bytes they asked for.  */
+  grub_uint64_t reads;
+  grub_uint64_t bytes;
+  grub_uint64_t cache_hits;
+  grub_uint64_t cache_misses;
+
+  /* Reads that reached the driver, in 512-byte sectors and
+     microseconds.  */
+  grub_uint64_t dev_reads;
+  grub_uint64_t dev_sectors;
+  grub_uint64_t dev_time_us;
+  grub_uint64_t dev_read_sizes[GRUB_DISK_STATS_SIZE_BUCKETS];
+};
+
+/* Disk access trace, recorded between grub_disk_trace_start and
+   grub_disk_trace_stop.  */
+enum grub_disk_trace_event
+  {
+    /* A call of grub_disk_read, in 512-byte sectors from the start of the
+       whole disk.  */
+    GRUB_DISK_TRACE_READ,
+    /* A cache block found in or missing from the cache.  */
+    GRUB_DISK_TRACE_HIT,
+    GRUB_DISK_TRACE_MISS,
+    /* A read that reached the driver, in its native sectors.  */
+    GRUB_DISK_TRACE_DEV
+  };
+
+struct grub_disk_trace_entry
+{
+  grub_uint64_t time_us;
+  /* Stays valid after the disk is closed.  NULL if unknown.  */
+  const char *disk;
+  grub_disk_addr_t sector;
+  grub_uint32_t offset;
+  grub_uint32_t size;
+  /* Return address of the grub_disk_read call, telling which layer
+     issued it.  Only set for GRUB_DISK_TRACE_READ.  */
+  const void *caller;
+  enum grub_disk_trace_event event;
+};
+
 #ifdef GRUB_UTIL
 struct grub_disk_memberlist
 {
@@ -255,6 +316,26 @@ extern grub_err_t (*EXPORT_VAR(grub_disk_write_weak)) (grub_disk_t disk,
 
 grub_uint64_t EXPORT_FUNC(grub_disk_native_sectors) (grub_disk_t disk);
 
+/* Called for every grub_disk_read while set, with SECTOR counted from the
+   start of the whole disk and OFFSET below GRUB_DISK_SECTOR_SIZE.  */
+extern void (*EXPORT_VAR(grub_disk_read_notify)) (grub_disk_t disk,
+						  grub_disk_addr_t sector,
+						  grub_off_t offset,
+						  grub_size_t size);
+
+/* Start recording into a new ring of ENTRIES entries, dropping any
+   previous trace.  */
+grub_err_t EXPORT_FUNC(grub_disk_trace_start) (grub_size_t entries);
+/* Stop recording but keep the trace.  */
+void EXPORT_FUNC(grub_disk_trace_stop) (void);
+/* Call HOOK for the recorded entries from oldest to newest until it
+   returns non-zero.  Returns the number of entries overwritten because
+   the ring was full.  */
+grub_uint64_t
+EXPORT_FUNC(grub_disk_trace_iterate) (int (*hook) (const struct grub_disk_trace_entry *entry,
+						   void *data),
+				      void *data);
+
 #if DISK_CACHE_STATS
 void
 EXPORT_FUNC(grub_disk_cache_get_performance) (unsigned long *hits, unsigned long *misses);
@@ -315,6 +315,11 @@ grub_dl_find_segment (grub_dl_t mod, unsigned n)
 
 void * EXPORT_FUNC(grub_resolve_symbol) (const char *name);
 const char * EXPORT_FUNC(grub_get_symbol_by_addr) (const void *addr, int isfunc);
+#ifndef GRUB_UTIL
+const char * EXPORT_FUNC(grub_dl_addr_to_symbol) (const void *addr,
+						  grub_dl_t *mod,
+						  grub_size_t *offset);
+#endif
 grub_err_t grub_dl_register_symbol (const char *name, void *addr,
 				    int isfunc, grub_dl_t mod);
 
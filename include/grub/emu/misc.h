@@ -64,6 +64,12 @@ int EXPORT_FUNC(grub_util_get_switch_root) (void);
 
 grub_uint64_t EXPORT_FUNC (grub_util_get_cpu_time_ms) (void);
 
+/* Call SAMPLE with the interrupted program counter HZ times per second of
+   consumed CPU time.  SAMPLE runs in signal context.  */
+int EXPORT_FUNC (grub_util_profile_start) (unsigned hz,
+					   void (*sample) (void *pc));
+void EXPORT_FUNC (grub_util_profile_stop) (void);
+
 #ifdef HAVE_DEVICE_MAPPER
 int grub_device_mapper_supported (void);
 #endif
@@ -127,6 +127,7 @@ enum grub_file_type
 
     GRUB_FILE_TYPE_LOADENV,
     GRUB_FILE_TYPE_SAVEENV,
+    GRUB_FILE_TYPE_PREFETCH_LIST,
 
     GRUB_FILE_TYPE_VERIFY_SIGNATURE,
 
@@ -172,6 +173,11 @@ struct grub_file
 
   /* Caller-specific data passed to the read hook.  */
   void *read_hook_data;
+
+  /* I/O counters, reported by iostat once the file is closed.  */
+  grub_uint64_t stat_reads;
+  grub_uint64_t stat_bytes;
+  grub_uint64_t stat_time_us;
 };
 typedef struct grub_file *grub_file_t;
 
@@ -180,10 +186,14 @@ extern grub_disk_read_hook_t EXPORT_VAR(grub_file_progress_hook);
 /* Filters with lower ID are executed first.  */
 typedef enum grub_file_filter_id
   {
+    GRUB_FILE_FILTER_PREFETCH,
     GRUB_FILE_FILTER_VERIFY,
     GRUB_FILE_FILTER_GZIO,
     GRUB_FILE_FILTER_XZIO,
     GRUB_FILE_FILTER_LZOPIO,
+    /* Verifies the decompressed contents of the file types that are
+       signed uncompressed, such as modules.  */
+    GRUB_FILE_FILTER_VERIFY_CONTENT,
     GRUB_FILE_FILTER_MAX,
     GRUB_FILE_FILTER_COMPRESSION_FIRST = GRUB_FILE_FILTER_GZIO,
     GRUB_FILE_FILTER_COMPRESSION_LAST = GRUB_FILE_FILTER_LZOPIO,
@@ -33,6 +33,11 @@ struct grub_gfxmenu_box
   struct grub_video_bitmap **raw_pixmaps;
   struct grub_video_bitmap **scaled_pixmaps;
 
+  /* Where to load the pixmaps from on first use, or NULL once they
+     are loaded.  */
+  char *pixmaps_prefix;
+  char *pixmaps_suffix;
+
   void (*draw) (grub_gfxmenu_box_t self, int x, int y);
   void (*set_content_size) (grub_gfxmenu_box_t self,
                             int width, int height);
@@ -47,4 +52,9 @@ struct grub_gfxmenu_box
 grub_gfxmenu_box_t grub_gfxmenu_create_box (const char *pixmaps_prefix,
                                             const char *pixmaps_suffix);
 
+grub_err_t grub_gfxmenu_bitmap_load (struct grub_video_bitmap **bitmap,
+                                     const char *path);
+void grub_gfxmenu_bitmap_release (struct grub_video_bitmap *bitmap);
+void grub_gfxmenu_bitmap_cache_flush (void);
+
 #endif /* ! GRUB_GFXWIDGETS_HEADER */
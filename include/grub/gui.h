@@ -69,6 +69,12 @@ struct grub_gui_list_ops
                          grub_gfxmenu_view_t view);
   void (*refresh_list) (void *self,
                         grub_gfxmenu_view_t view);
+  /* Store in OLD_ROW and NEW_ROW the screen areas of the rows of
+     OLD_SELECTED and of the current selection.  Return 0 if the list has
+     to be repainted as a whole instead.  */
+  int (*get_selection_rows) (void *self, int old_selected,
+                             grub_video_rect_t *old_row,
+                             grub_video_rect_t *new_row);
 };
 
 struct grub_gui_progress_ops
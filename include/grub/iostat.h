@@ -0,0 +1,38 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRUB_IOSTAT_HEADER
+#define GRUB_IOSTAT_HEADER	1
+
+#include <grub/types.h>
+#include <grub/symbol.h>
+
+/* Called once per counter.  All counters of one OBJECT (a disk name, a
+   file name, a network card...) within CLASS are reported together.  */
+typedef void (*grub_iostat_emit_t) (const char *class, const char *object,
+				    const char *counter, grub_uint64_t value,
+				    void *data);
+
+void EXPORT_FUNC (grub_disk_iostat) (grub_iostat_emit_t emit, void *data);
+void EXPORT_FUNC (grub_file_iostat) (grub_iostat_emit_t emit, void *data);
+
+/* Set by the network stack while it is loaded.  */
+extern void (*EXPORT_VAR (grub_net_iostat)) (grub_iostat_emit_t emit,
+					     void *data);
+
+#endif /* ! GRUB_IOSTAT_HEADER */
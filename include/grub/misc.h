@@ -72,12 +72,15 @@ grub_stpcpy (char *dest, const char *src)
   return d - 1;
 }
 
-/* XXX: If grub_memmove is too slow, we must implement grub_memcpy.  */
+#ifdef GRUB_EMBED_DECOMPRESSOR
 static inline void *
 grub_memcpy (void *dest, const void *src, grub_size_t n)
 {
   return grub_memmove (dest, src, n);
 }
+#else
+void *EXPORT_FUNC(grub_memcpy) (void *dest, const void *src, grub_size_t n);
+#endif
 
 #if defined(__x86_64__) && !defined (GRUB_UTIL)
 #if defined (__MINGW32__) || defined (__CYGWIN__) || defined (__MINGW64__)
@@ -503,8 +506,39 @@ void EXPORT_FUNC(grub_real_boot_time) (const char *file,
 				       const int line,
 				       const char *fmt, ...) __attribute__ ((format (GNU_PRINTF, 3, 4)));
 #define grub_boot_time(...) grub_real_boot_time(GRUB_FILE, __LINE__, __VA_ARGS__)
+
+/* Boot trace events, kept in a ring buffer of GRUB_BOOT_TRACE_EVENTS
+   entries.  CAT and NAME must be static strings, DETAIL is copied.  */
+#define GRUB_BOOT_TRACE_EVENTS		4096
+#define GRUB_BOOT_TRACE_DETAIL_LEN	24
+
+struct grub_boot_trace_event
+{
+  /* Microseconds, see grub_get_time_us.  */
+  grub_uint64_t ts;
+  const char *cat;
+  const char *name;
+  /* 'B'egin, 'E'nd or 'i'nstant, as in the Chrome trace format.  */
+  char phase;
+  char detail[GRUB_BOOT_TRACE_DETAIL_LEN];
+};
+
+extern struct grub_boot_trace_event *EXPORT_VAR(grub_boot_trace_buf);
+/* Number of events ever recorded.  The last GRUB_BOOT_TRACE_EVENTS of
+   them are in the buffer.  */
+extern grub_size_t EXPORT_VAR(grub_boot_trace_count);
+
+void EXPORT_FUNC(grub_boot_trace) (char phase, const char *cat,
+				   const char *name, const char *detail);
+#define grub_boot_trace_begin(cat, name, detail) \
+  grub_boot_trace ('B', cat, name, detail)
+#define grub_boot_trace_end(cat, name, detail) \
+  grub_boot_trace ('E', cat, name, detail)
 #else
 #define grub_boot_time(fmt, ...) grub_dprintf("boot", fmt "\n", ##__VA_ARGS__)
+#define grub_boot_trace(phase, cat, name, detail) do { } while (0)
+#define grub_boot_trace_begin(cat, name, detail) do { } while (0)
+#define grub_boot_trace_end(cat, name, detail) do { } while (0)
 #endif
 
 #define _grub_min(a, b, _a, _b)						      \
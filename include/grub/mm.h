@@ -47,12 +47,34 @@ typedef grub_err_t (*grub_mm_add_region_func_t) (grub_size_t, unsigned int);
 extern grub_mm_add_region_func_t EXPORT_VAR(grub_mm_add_region_fn);
 #endif
 
+/*
+ * Functions used to get whole pages of at least `grub_size_t` bytes straight
+ * from the firmware, and to give them back.  The size passed on freeing is
+ * the one that was requested.
+ */
+typedef void *(*grub_mm_alloc_pages_func_t) (grub_size_t);
+typedef void (*grub_mm_free_pages_func_t) (void *, grub_size_t);
+
+/*
+ * Set these function pointers to serve large buffers from grub_bulk_alloc()
+ * outside of the heap.  Without them such buffers come from the heap.
+ */
+#ifndef GRUB_MACHINE_EMU
+extern grub_mm_alloc_pages_func_t EXPORT_VAR(grub_mm_alloc_pages_fn);
+extern grub_mm_free_pages_func_t EXPORT_VAR(grub_mm_free_pages_fn);
+#endif
+
+/* Requests smaller than this are served from the heap anyway.  */
+#define GRUB_MM_BULK_MIN	0x10000
+
 void grub_mm_init_region (void *addr, grub_size_t size);
 void *EXPORT_FUNC(grub_calloc) (grub_size_t nmemb, grub_size_t size);
 void *EXPORT_FUNC(grub_malloc) (grub_size_t size);
 void *EXPORT_FUNC(grub_zalloc) (grub_size_t size);
 void EXPORT_FUNC(grub_free) (void *ptr);
 void *EXPORT_FUNC(grub_realloc) (void *ptr, grub_size_t size);
+void *EXPORT_FUNC(grub_bulk_alloc) (grub_size_t size);
+void EXPORT_FUNC(grub_bulk_free) (void *ptr);
 #ifndef GRUB_MACHINE_EMU
 void *EXPORT_FUNC(grub_memalign) (grub_size_t align, grub_size_t size);
 #endif
@@ -128,6 +150,69 @@ void *EXPORT_FUNC(grub_debug_realloc) (const char *file, int line, void *ptr,
 				       grub_size_t size);
 void *EXPORT_FUNC(grub_debug_memalign) (const char *file, int line,
 					grub_size_t align, grub_size_t size);
-#endif /* MM_DEBUG && ! GRUB_UTIL */
+#elif MM_PROFILE && !defined (GRUB_UTIL)
+/* Account every allocation to its call site, see kern/mm_profile.c.  */
+#define grub_calloc(nmemb, size)	\
+  grub_profile_calloc (GRUB_FILE, __LINE__, nmemb, size)
+
+#define grub_malloc(size)	\
+  grub_profile_malloc (GRUB_FILE, __LINE__, size)
+
+#define grub_zalloc(size)	\
+  grub_profile_zalloc (GRUB_FILE, __LINE__, size)
+
+#define grub_realloc(ptr,size)	\
+  grub_profile_realloc (GRUB_FILE, __LINE__, ptr, size)
+
+#ifndef GRUB_MACHINE_EMU
+#define grub_memalign(align,size)	\
+  grub_profile_memalign (GRUB_FILE, __LINE__, align, size)
+#endif
+
+#define grub_free(ptr)	\
+  grub_profile_free (ptr)
+
+void *EXPORT_FUNC(grub_profile_calloc) (const char *file, int line,
+					grub_size_t nmemb, grub_size_t size);
+void *EXPORT_FUNC(grub_profile_malloc) (const char *file, int line,
+					grub_size_t size);
+void *EXPORT_FUNC(grub_profile_zalloc) (const char *file, int line,
+					grub_size_t size);
+void *EXPORT_FUNC(grub_profile_realloc) (const char *file, int line,
+					 void *ptr, grub_size_t size);
+#ifndef GRUB_MACHINE_EMU
+void *EXPORT_FUNC(grub_profile_memalign) (const char *file, int line,
+					  grub_size_t align, grub_size_t size);
+#endif
+void EXPORT_FUNC(grub_profile_free) (void *ptr);
+#endif /* MM_PROFILE && ! GRUB_UTIL */
+
+#if MM_PROFILE && !defined (GRUB_UTIL)
+/* Allocation sizes are counted in buckets growing by a factor of four;
+   bucket I holds the sizes below GRUB_MM_PROFILE_BUCKET_LIMIT (I), the last
+   one everything else.  */
+#define GRUB_MM_PROFILE_BUCKETS		8
+#define GRUB_MM_PROFILE_BUCKET_LIMIT(i)	((grub_size_t) 16 << (2 * (i)))
+
+struct grub_mm_profile_site
+{
+  const char *file;
+  int line;
+  unsigned long allocs;
+  unsigned long frees;
+  /* Bytes allocated here and not freed yet, and the most there ever were.  */
+  grub_size_t live;
+  grub_size_t peak;
+  unsigned long sizes[GRUB_MM_PROFILE_BUCKETS];
+};
+
+typedef int (*grub_mm_profile_hook_t) (const struct grub_mm_profile_site *site,
+				       void *data);
+
+void EXPORT_FUNC(grub_mm_profile_iterate) (grub_mm_profile_hook_t hook,
+					   void *data);
+void EXPORT_FUNC(grub_mm_profile_totals) (grub_size_t *live,
+					  grub_size_t *peak);
+#endif /* MM_PROFILE && ! GRUB_UTIL */
 
 #endif /* ! GRUB_MM_H */
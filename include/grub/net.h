@@ -135,6 +135,11 @@ struct grub_net_card
   grub_size_t rcvbufsize;
   grub_size_t txbufsize;
   int txbusy;
+  /* Frames handed to and received from the driver.  */
+  grub_uint64_t stat_rx_packets;
+  grub_uint64_t stat_rx_bytes;
+  grub_uint64_t stat_tx_packets;
+  grub_uint64_t stat_tx_bytes;
   union
   {
 #ifdef GRUB_MACHINE_EFI
@@ -281,6 +286,11 @@ typedef struct grub_net
   int eof;
   int stall;
   int broken;
+  /* Payload packets and bytes handed to the reader and packets sent
+     again, over all (re)connections of this file.  */
+  grub_uint64_t stat_packets;
+  grub_uint64_t stat_bytes;
+  grub_uint64_t stat_retransmits;
 } *grub_net_t;
 
 extern grub_net_t (*EXPORT_VAR (grub_net_open)) (const char *name);
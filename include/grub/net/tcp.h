@@ -82,4 +82,9 @@ grub_net_tcp_stall (grub_net_tcp_socket_t sock);
 void
 grub_net_tcp_unstall (grub_net_tcp_socket_t sock);
 
+/* Add the segments SOCK sends again to *COUNTER.  */
+void
+grub_net_tcp_count_retransmits (grub_net_tcp_socket_t sock,
+				grub_uint64_t *counter);
+
 #endif
@@ -75,6 +75,7 @@ grub_err_t grub_set_history (int newsize);
 /* Defined in `completion.c'.  */
 char *grub_normal_do_completion (char *buf, int *restore,
 				 void (*hook) (const char *item, grub_completion_type_t type, int count));
+void grub_normal_completion_flush (void);
 
 /* Defined in `misc.c'.  */
 grub_err_t grub_normal_print_device_info (const char *name);
@@ -98,6 +98,9 @@ int EXPORT_FUNC(grub_partition_iterate) (struct grub_disk *disk,
 					 grub_partition_iterate_hook_t hook,
 					 void *hook_data);
 char *EXPORT_FUNC(grub_partition_get_name) (const grub_partition_t partition);
+void EXPORT_FUNC(grub_partition_cache_invalidate) (unsigned long dev_id,
+						   unsigned long disk_id);
+void EXPORT_FUNC(grub_partition_cache_invalidate_all) (void);
 
 
 extern grub_partition_map_t EXPORT_VAR(grub_partition_map_list);
@@ -108,6 +111,7 @@ grub_partition_map_register (grub_partition_map_t partmap)
 {
   grub_list_push (GRUB_AS_LIST_P (&grub_partition_map_list),
 		  GRUB_AS_LIST (partmap));
+  grub_partition_cache_invalidate_all ();
 }
 #endif
 
@@ -115,6 +119,7 @@ static inline void
 grub_partition_map_unregister (grub_partition_map_t partmap)
 {
   grub_list_remove (GRUB_AS_LIST (partmap));
+  grub_partition_cache_invalidate_all ();
 }
 
 #define FOR_PARTITION_MAPS(var) FOR_LIST_ELEMENTS((var), (grub_partition_map_list))
@@ -74,12 +74,24 @@ struct grub_script_arg
   struct grub_script_arg *next;
 };
 
+struct grub_script_arena_chunk;
+
+/* Memory for the arguments of one command, released all at once.  */
+struct grub_script_arena
+{
+  struct grub_script_arena_chunk *chunks;
+  /* The most recent allocation, which can grow in place.  */
+  char *last;
+};
+
 /* An argument vector.  */
 struct grub_script_argv
 {
   unsigned argc;
   char **args;
   struct grub_script *script;
+  /* Where the arguments are allocated, or NULL for the heap.  */
+  struct grub_script_arena *arena;
 };
 
 /* Pluggable wildcard translator.  */
@@ -244,6 +256,13 @@ void grub_script_fini (void);
 
 void grub_script_mem_free (struct grub_script_mem *mem);
 
+void *grub_script_arena_alloc (struct grub_script_arena *arena,
+			       grub_size_t size);
+void *grub_script_arena_grow (struct grub_script_arena *arena, void *ptr,
+			      grub_size_t old_size, grub_size_t size);
+void grub_script_arena_release (struct grub_script_arena *arena);
+void grub_script_arena_fini (void);
+
 void grub_script_argv_free    (struct grub_script_argv *argv);
 int grub_script_argv_make     (struct grub_script_argv *argv, int argc, char **args);
 int grub_script_argv_next     (struct grub_script_argv *argv);
@@ -34,6 +34,9 @@ grub_cpu_idle(void)
 
 void EXPORT_FUNC(grub_millisleep) (grub_uint32_t ms);
 grub_uint64_t EXPORT_FUNC(grub_get_time_ms) (void);
+/* Microseconds since an arbitrary epoch.  Falls back to millisecond
+   resolution where no finer clock is installed.  */
+grub_uint64_t EXPORT_FUNC(grub_get_time_us) (void);
 
 grub_uint64_t grub_rtc_get_time_ms (void);
 
@@ -44,5 +47,6 @@ grub_sleep (grub_uint32_t s)
 }
 
 void grub_install_get_time_ms (grub_uint64_t (*get_time_ms_func) (void));
+void grub_install_get_time_us (grub_uint64_t (*get_time_us_func) (void));
 
 #endif /* ! KERNEL_TIME_HEADER */
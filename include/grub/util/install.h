@@ -43,6 +43,9 @@
   { "compress", GRUB_INSTALL_OPTIONS_INSTALL_COMPRESS,		  \
     "no|xz|gz|lzo", 0,				  \
     N_("compress GRUB files [optional]"), 1 },			          \
+  { "compress-modules", GRUB_INSTALL_OPTIONS_INSTALL_MODULE_COMPRESS,	  \
+    "no|xz|gz|lzo", 0,						  \
+    N_("compress GRUB modules [default=as --compress]"), 1 },	          \
   {"core-compress", GRUB_INSTALL_OPTIONS_INSTALL_CORE_COMPRESS,		\
       "xz|none|auto",						\
       0, N_("choose the compression to use for core image"), 2},	\
@@ -134,7 +137,8 @@ enum grub_install_options {
   GRUB_INSTALL_OPTIONS_DTB,
   GRUB_INSTALL_OPTIONS_SBAT,
   GRUB_INSTALL_OPTIONS_DISABLE_SHIM_LOCK,
-  GRUB_INSTALL_OPTIONS_APPENDED_SIGNATURE_SIZE
+  GRUB_INSTALL_OPTIONS_APPENDED_SIGNATURE_SIZE,
+  GRUB_INSTALL_OPTIONS_INSTALL_MODULE_COMPRESS
 };
 
 extern char *grub_install_source_directory;
@@ -263,6 +267,9 @@ grub_install_get_blocklist (grub_device_t root_dev,
 void
 grub_util_create_envblk_file (const char *name);
 
+void
+grub_util_create_prefetch_file (const char *name);
+
 void
 grub_util_glue_efi (const char *file32, const char *file64, const char *out);
 
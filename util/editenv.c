@@ -133,3 +133,33 @@ grub_util_create_envblk_file (const char *name)
 
   free (namenew);
 }
+
+/* The prefetch module rewrites this file in place, so it must already have
+   its final size.  */
+#define PREFETCH_LIST_SIZE	65536
+#define PREFETCH_LIST_HEADER	"# GRUB boot prefetch list\n"
+
+void
+grub_util_create_prefetch_file (const char *name)
+{
+  FILE *fp;
+  char *buf;
+
+  buf = xmalloc (PREFETCH_LIST_SIZE);
+  memcpy (buf, PREFETCH_LIST_HEADER, sizeof (PREFETCH_LIST_HEADER) - 1);
+  memset (buf + sizeof (PREFETCH_LIST_HEADER) - 1, '#',
+	  PREFETCH_LIST_SIZE - sizeof (PREFETCH_LIST_HEADER));
+  buf[PREFETCH_LIST_SIZE - 1] = '\n';
+
+  fp = grub_util_fopen (name, "wb");
+  if (! fp)
+    grub_util_error (_("cannot open `%s': %s"), name, strerror (errno));
+
+  if (fwrite (buf, 1, PREFETCH_LIST_SIZE, fp) != PREFETCH_LIST_SIZE)
+    grub_util_error (_("cannot write to `%s': %s"), name, strerror (errno));
+
+  if (grub_util_file_sync (fp) < 0)
+    grub_util_error (_("cannot sync `%s': %s"), name, strerror (errno));
+  free (buf);
+  fclose (fp);
+}
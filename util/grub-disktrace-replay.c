@@ -0,0 +1,457 @@
+/* grub-disktrace-replay.c - replay a disk trace with other cache policies */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2026  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The trace is the output of `disktrace dump'.  Every grub_disk_read of
+   one disk is fed through a simulated cache and the misses are read from
+   the image, so the number, size and time of the device reads can be
+   compared across cache sizes, replacement policies and read-ahead
+   without rebooting anything.  */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <grub/types.h>
+#include <grub/disk.h>
+#include <grub/time.h>
+#include <grub/util/misc.h>
+#include <grub/emu/misc.h>
+#include <grub/emu/hostfile.h>
+#include <grub/i18n.h>
+
+#define _GNU_SOURCE	1
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+#pragma GCC diagnostic ignored "-Wmissing-declarations"
+#include <argp.h>
+#pragma GCC diagnostic error "-Wmissing-prototypes"
+#pragma GCC diagnostic error "-Wmissing-declarations"
+
+#include "progname.h"
+
+enum policy
+  {
+    /* Direct-mapped like the GRUB disk cache.  */
+    POLICY_GRUB,
+    /* Fully associative, least recently used block evicted.  */
+    POLICY_LRU
+  };
+
+struct arguments
+{
+  char *trace;
+  char *image;
+  char *disk;
+  enum policy policy;
+  unsigned long blocks;
+  unsigned block_bits;
+  unsigned long readahead;
+  unsigned long max_agglomerate;
+};
+
+static struct argp_option options[] = {
+  {"disk", 'd', N_("NAME"), 0,
+   N_("replay the reads of disk NAME [default=the first one in the trace]"),
+   0},
+  {"policy", 'p', "grub|lru", 0,
+   N_("cache replacement policy [default=grub]"), 0},
+  {"blocks", 'b', N_("N"), 0, N_("cache N blocks [default=1021]"), 0},
+  {"block-size", 's', N_("SECTORS"), 0,
+   N_("cache blocks of SECTORS 512-byte sectors, a power of two "
+      "[default=64]"), 0},
+  {"read-ahead", 'r', N_("N"), 0,
+   N_("read up to N more blocks after each miss [default=0]"), 0},
+  {"max-agglomerate", 'a', N_("N"), 0,
+   N_("merge at most N missing blocks into one device read"), 0},
+  { 0, 0, 0, 0, 0, 0 }
+};
+
+static unsigned long
+parse_number (const char *arg, const char *what)
+{
+  char *end;
+  unsigned long ret;
+
+  ret = strtoul (arg, &end, 0);
+  if (*arg == '\0' || *end != '\0')
+    grub_util_error (_("invalid %s `%s'"), what, arg);
+  return ret;
+}
+
+static error_t
+argp_parser (int key, char *arg, struct argp_state *state)
+{
+  struct arguments *arguments = state->input;
+  unsigned long n;
+
+  switch (key)
+    {
+    case 'd':
+      free (arguments->disk);
+      arguments->disk = xstrdup (arg);
+      break;
+
+    case 'p':
+      if (strcmp (arg, "grub") == 0)
+	arguments->policy = POLICY_GRUB;
+      else if (strcmp (arg, "lru") == 0)
+	arguments->policy = POLICY_LRU;
+      else
+	argp_error (state, _("unknown cache policy `%s'"), arg);
+      break;
+
+    case 'b':
+      arguments->blocks = parse_number (arg, "number of blocks");
+      if (!arguments->blocks)
+	argp_error (state, _("the cache needs at least one block"));
+      break;
+
+    case 's':
+      n = parse_number (arg, "block size");
+      if (!n || (n & (n - 1)) || n > 65536)
+	argp_error (state, _("invalid block size `%s'"), arg);
+      for (arguments->block_bits = 0; (1UL << arguments->block_bits) < n;
+	   arguments->block_bits++);
+      break;
+
+    case 'r':
+      arguments->readahead = parse_number (arg, "read-ahead");
+      break;
+
+    case 'a':
+      arguments->max_agglomerate = parse_number (arg, "agglomerate limit");
+      if (!arguments->max_agglomerate)
+	argp_error (state, _("invalid agglomerate limit `%s'"), arg);
+      break;
+
+    case ARGP_KEY_ARG:
+      if (state->arg_num == 0)
+	arguments->trace = xstrdup (arg);
+      else if (state->arg_num == 1)
+	arguments->image = xstrdup (arg);
+      else
+	argp_error (state, _("Unknown extra argument `%s'."), arg);
+      break;
+
+    case ARGP_KEY_END:
+      if (state->arg_num < 2)
+	argp_error (state, _("A trace and a disk image are required."));
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+static struct argp argp = {
+  options, argp_parser, N_("TRACE IMAGE"),
+  N_("Replay a GRUB disk trace against a disk image with a simulated "
+     "cache.\v"
+     "TRACE is the output of the `disktrace dump' command.  The reads "
+     "of one disk are replayed against IMAGE, which should hold that "
+     "disk, and the resulting device reads are counted and timed.  "
+     "Run it once with the defaults to model the GRUB disk cache, then "
+     "vary the options."),
+  NULL, NULL, NULL
+};
+
+#define NO_SLOT	((unsigned long) -1)
+
+struct slot
+{
+  grub_uint64_t block;
+  /* LRU list, most recently used first, and hash chain.  */
+  unsigned long prev, next, chain;
+  int valid;
+};
+
+static struct arguments arguments;
+static struct slot *slots;
+static unsigned long *buckets;
+static unsigned long used, lru_first, lru_last;
+
+static grub_util_fd_t image_fd;
+static char *read_buf;
+static grub_size_t read_buf_size;
+
+static struct
+{
+  grub_uint64_t requests, request_bytes;
+  grub_uint64_t hits, misses;
+  grub_uint64_t dev_reads, dev_bytes, dev_time_us;
+  grub_uint64_t traced_dev_reads, traced_dev_bytes;
+} stats;
+
+static void
+lru_unlink (unsigned long i)
+{
+  if (slots[i].prev != NO_SLOT)
+    slots[slots[i].prev].next = slots[i].next;
+  else
+    lru_first = slots[i].next;
+  if (slots[i].next != NO_SLOT)
+    slots[slots[i].next].prev = slots[i].prev;
+  else
+    lru_last = slots[i].prev;
+}
+
+static void
+lru_push (unsigned long i)
+{
+  slots[i].prev = NO_SLOT;
+  slots[i].next = lru_first;
+  if (lru_first != NO_SLOT)
+    slots[lru_first].prev = i;
+  lru_first = i;
+  if (lru_last == NO_SLOT)
+    lru_last = i;
+}
+
+static unsigned long
+cache_find (grub_uint64_t block)
+{
+  unsigned long i;
+
+  if (arguments.policy == POLICY_GRUB)
+    {
+      i = block % arguments.blocks;
+      return (slots[i].valid && slots[i].block == block) ? i : NO_SLOT;
+    }
+
+  for (i = buckets[block % arguments.blocks]; i != NO_SLOT;
+       i = slots[i].chain)
+    if (slots[i].block == block)
+      return i;
+  return NO_SLOT;
+}
+
+/* Look BLOCK up as a read would, counting it as used.  */
+static int
+cache_lookup (grub_uint64_t block)
+{
+  unsigned long i = cache_find (block);
+
+  if (i == NO_SLOT)
+    return 0;
+  if (arguments.policy == POLICY_LRU)
+    {
+      lru_unlink (i);
+      lru_push (i);
+    }
+  return 1;
+}
+
+static void
+cache_insert (grub_uint64_t block)
+{
+  unsigned long i, *p;
+
+  if (cache_find (block) != NO_SLOT)
+    return;
+
+  if (arguments.policy == POLICY_GRUB)
+    {
+      i = block % arguments.blocks;
+      slots[i].block = block;
+      slots[i].valid = 1;
+      return;
+    }
+
+  if (used < arguments.blocks)
+    i = used++;
+  else
+    {
+      i = lru_last;
+      lru_unlink (i);
+      for (p = &buckets[slots[i].block % arguments.blocks]; *p != i;
+	   p = &slots[*p].chain);
+      *p = slots[i].chain;
+    }
+  slots[i].block = block;
+  slots[i].chain = buckets[block % arguments.blocks];
+  buckets[block % arguments.blocks] = i;
+  lru_push (i);
+}
+
+static void
+device_read (grub_uint64_t block, grub_uint64_t count)
+{
+  unsigned shift = arguments.block_bits + GRUB_DISK_SECTOR_BITS;
+  grub_size_t len = count << shift;
+  grub_uint64_t start;
+  ssize_t got;
+
+  if (len > read_buf_size)
+    {
+      read_buf = xrealloc (read_buf, len);
+      read_buf_size = len;
+    }
+
+  start = grub_get_time_us ();
+  if (grub_util_fd_seek (image_fd, block << shift) != 0)
+    grub_util_error (_("cannot seek `%s': %s"), arguments.image,
+		     grub_util_fd_strerror ());
+  /* Reads past the end of the image come back short, which is fine.  */
+  got = grub_util_fd_read (image_fd, read_buf, len);
+  if (got < 0)
+    grub_util_error (_("cannot read `%s': %s"), arguments.image,
+		     grub_util_fd_strerror ());
+  stats.dev_time_us += grub_get_time_us () - start;
+  stats.dev_reads++;
+  stats.dev_bytes += got;
+}
+
+/* Mirrors grub_disk_read: hits are copied, runs of missing blocks are
+   read together and everything read is cached.  */
+static void
+replay_read (grub_uint64_t sector, grub_uint64_t offset, grub_uint64_t size)
+{
+  unsigned shift = arguments.block_bits + GRUB_DISK_SECTOR_BITS;
+  grub_uint64_t first, last, block, n, ahead, i;
+
+  stats.requests++;
+  stats.request_bytes += size;
+  if (!size)
+    return;
+
+  first = ((sector << GRUB_DISK_SECTOR_BITS) + offset) >> shift;
+  last = ((sector << GRUB_DISK_SECTOR_BITS) + offset + size - 1) >> shift;
+
+  for (block = first; block <= last; )
+    {
+      if (cache_lookup (block))
+	{
+	  stats.hits++;
+	  block++;
+	  continue;
+	}
+
+      for (n = 1; block + n <= last && n < arguments.max_agglomerate
+	     && cache_find (block + n) == NO_SLOT; n++);
+      stats.misses += n;
+
+      for (ahead = 0; ahead < arguments.readahead
+	     && cache_find (block + n + ahead) == NO_SLOT; ahead++);
+
+      device_read (block, n + ahead);
+      for (i = 0; i < n + ahead; i++)
+	cache_insert (block + i);
+      block += n;
+    }
+}
+
+static void
+replay (FILE *trace)
+{
+  char line[1024], event[16], disk[512];
+  unsigned long long time_us, sector;
+  unsigned offset, size;
+  unsigned long lineno = 0;
+
+  while (fgets (line, sizeof (line), trace))
+    {
+      lineno++;
+      if (line[0] == '#' || line[0] == '\n')
+	continue;
+      if (sscanf (line, "%llu %15s %511s %llu %u %u", &time_us, event, disk,
+		  &sector, &offset, &size) != 6)
+	grub_util_error (_("%s:%lu: malformed trace line"), arguments.trace,
+			 lineno);
+
+      if (!arguments.disk)
+	{
+	  arguments.disk = xstrdup (disk);
+	  printf (_("Replaying disk %s\n"), disk);
+	}
+      if (strcmp (disk, arguments.disk) != 0)
+	continue;
+
+      if (strcmp (event, "read") == 0)
+	replay_read (sector, offset, size);
+      else if (strcmp (event, "dev") == 0)
+	{
+	  stats.traced_dev_reads++;
+	  stats.traced_dev_bytes += size;
+	}
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  FILE *trace;
+  unsigned long i;
+
+  grub_util_host_init (&argc, &argv);
+
+  memset (&arguments, 0, sizeof (arguments));
+  arguments.policy = POLICY_GRUB;
+  arguments.blocks = GRUB_DISK_CACHE_NUM;
+  arguments.block_bits = GRUB_DISK_CACHE_BITS;
+  arguments.max_agglomerate = GRUB_DISK_MAX_MAX_AGGLOMERATE;
+
+  if (argp_parse (&argp, argc, argv, 0, 0, &arguments) != 0)
+    {
+      fprintf (stderr, "%s", _("Error in parsing command line arguments\n"));
+      exit (1);
+    }
+
+  trace = grub_util_fopen (arguments.trace, "r");
+  if (!trace)
+    grub_util_error (_("cannot open `%s': %s"), arguments.trace,
+		     strerror (errno));
+
+  image_fd = grub_util_fd_open (arguments.image, GRUB_UTIL_FD_O_RDONLY);
+  if (!GRUB_UTIL_FD_IS_VALID (image_fd))
+    grub_util_error (_("cannot open `%s': %s"), arguments.image,
+		     grub_util_fd_strerror ());
+
+  slots = xcalloc (arguments.blocks, sizeof (*slots));
+  buckets = xcalloc (arguments.blocks, sizeof (*buckets));
+  for (i = 0; i < arguments.blocks; i++)
+    buckets[i] = NO_SLOT;
+  lru_first = lru_last = NO_SLOT;
+
+  replay (trace);
+  fclose (trace);
+  grub_util_fd_close (image_fd);
+
+  printf (_("Cache: %s, %lu blocks of %u bytes, read-ahead %lu blocks\n"),
+	  arguments.policy == POLICY_GRUB ? "grub" : "lru", arguments.blocks,
+	  1U << (arguments.block_bits + GRUB_DISK_SECTOR_BITS),
+	  arguments.readahead);
+  printf (_("Requests: %" PRIuGRUB_UINT64_T ", %" PRIuGRUB_UINT64_T
+	    " bytes\n"), stats.requests, stats.request_bytes);
+  printf (_("Cache hits: %" PRIuGRUB_UINT64_T ", misses: %"
+	    PRIuGRUB_UINT64_T "\n"), stats.hits, stats.misses);
+  printf (_("Device reads: %" PRIuGRUB_UINT64_T ", %" PRIuGRUB_UINT64_T
+	    " bytes, %" PRIuGRUB_UINT64_T " us\n"),
+	  stats.dev_reads, stats.dev_bytes, stats.dev_time_us);
+  printf (_("Device reads in the trace: %" PRIuGRUB_UINT64_T ", %"
+	    PRIuGRUB_UINT64_T " bytes\n"),
+	  stats.traced_dev_reads, stats.traced_dev_bytes);
+
+  free (read_buf);
+  free (slots);
+  free (buckets);
+  return 0;
+}
@@ -35,6 +35,7 @@
 #include <grub/i18n.h>
 #include <grub/zfs/zfs.h>
 #include <grub/emu/hostfile.h>
+#include <grub/iostat.h>
 
 #include <stdio.h>
 #include <errno.h>
@@ -376,6 +377,7 @@ static int cmd = 0;
 static char *debug_str = NULL;
 static char **args = NULL;
 static int mount_crypt = 0;
+static int print_stats = 0;
 
 static void
 fstest (int n)
@@ -524,9 +526,20 @@ static struct argp_option options[] = {
    N_("FILE|prompt"), 0, N_("Load zfs crypto key."),                 2},
   {"verbose",   'v', NULL, 0, N_("print verbose messages."), 2},
   {"uncompress", 'u', NULL, 0, N_("Uncompress data."), 2},
+  {"stats", 'S', NULL, 0, N_("Print I/O counters to standard error when done."), 2},
   {0, 0, 0, 0, 0, 0}
 };
 
+/* One counter per line; OBJECT may contain spaces, so parsers should
+   take the counter and the value from the end of the line.  */
+static void
+print_stat (const char *class, const char *object, const char *counter,
+	    grub_uint64_t value, void *data __attribute__ ((unused)))
+{
+  fprintf (stderr, "%s %s %s %" PRIuGRUB_UINT64_T "\n", class, object,
+	   counter, value);
+}
+
 /* Print the version information.  */
 static void
 print_version (FILE *stream, struct argp_state *state)
@@ -627,6 +640,10 @@ argp_parser (int key, char *arg, struct argp_state *state)
       uncompress = 1;
       return 0;
 
+    case 'S':
+      print_stats = 1;
+      return 0;
+
     case ARGP_KEY_END:
       if (args_count < num_disks)
 	{
@@ -768,6 +785,12 @@ main (int argc, char *argv[])
   /* Do it.  */
   fstest (args_count - 1 - num_disks);
 
+  if (print_stats)
+    {
+      grub_disk_iostat (print_stat, NULL);
+      grub_file_iostat (print_stat, NULL);
+    }
+
   /* Free resources.  */
   grub_gcry_fini_all ();
   grub_fini_all ();
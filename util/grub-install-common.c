@@ -71,7 +71,13 @@ grub_install_help_filter (int key, const char *text,
 
 #pragma GCC diagnostic error "-Wformat-nonliteral"
 
-static int (*compress_func) (const char *src, const char *dest) = NULL;
+typedef int (*compress_func_t) (const char *src, const char *dest);
+
+static compress_func_t compress_func = NULL;
+/* Modules are compressed with --compress unless --compress-modules was
+   given.  */
+static compress_func_t module_compress_func = NULL;
+static int module_compress_set;
 char *grub_install_copy_buffer;
 static char *dtb;
 
@@ -131,18 +137,19 @@ grub_install_copy_file (const char *src,
 }
 
 static int
-grub_install_compress_file (const char *in_name,
-			    const char *out_name,
-			    int is_needed)
+compress_file_with (compress_func_t func,
+		    const char *in_name,
+		    const char *out_name,
+		    int is_needed)
 {
   int ret;
 
-  if (!compress_func)
+  if (!func)
     ret = grub_install_copy_file (in_name, out_name, is_needed);
   else
     {
       grub_util_info ("compressing `%s' -> `%s'", in_name, out_name);
-      ret = !compress_func (in_name, out_name);
+      ret = !func (in_name, out_name);
       if (!ret && is_needed)
 	grub_util_warn (_("can't compress `%s' to `%s'"), in_name, out_name);
     }
@@ -154,6 +161,22 @@ grub_install_compress_file (const char *in_name,
   return ret;
 }
 
+static int
+grub_install_compress_file (const char *in_name,
+			    const char *out_name,
+			    int is_needed)
+{
+  return compress_file_with (compress_func, in_name, out_name, is_needed);
+}
+
+/* GRUB decompresses modules before their signatures are checked, so the
+   signatures made for the modules as built stay valid.  */
+static compress_func_t
+module_compression (void)
+{
+  return module_compress_set ? module_compress_func : compress_func;
+}
+
 static int
 is_path_separator (char c)
 {
@@ -465,6 +488,21 @@ static size_t nx509keys;
 static grub_compression_t compression;
 static size_t appsig_size;
 
+static compress_func_t
+parse_compress (const char *arg)
+{
+  if (strcmp (arg, "no") == 0
+      || strcmp (arg, "none") == 0)
+    return NULL;
+  if (strcmp (arg, "gz") == 0)
+    return grub_install_compress_gzip;
+  if (strcmp (arg, "xz") == 0)
+    return grub_install_compress_xz;
+  if (strcmp (arg, "lzo") == 0)
+    return grub_install_compress_lzop;
+  grub_util_error (_("Unrecognized compression `%s'"), arg);
+}
+
 int
 grub_install_parse (int key, char *arg)
 {
@@ -548,28 +586,12 @@ grub_install_parse (int key, char *arg)
       dtb = xstrdup (arg);
       return 1;
     case GRUB_INSTALL_OPTIONS_INSTALL_COMPRESS:
-      if (strcmp (arg, "no") == 0
-	  || strcmp (arg, "none") == 0)
-	{
-	  compress_func = NULL;
-	  return 1;
-	}
-      if (strcmp (arg, "gz") == 0)
-	{
-	  compress_func = grub_install_compress_gzip;
-	  return 1;
-	}
-      if (strcmp (arg, "xz") == 0)
-	{
-	  compress_func = grub_install_compress_xz;
-	  return 1;
-	}
-      if (strcmp (arg, "lzo") == 0)
-	{
-	  compress_func = grub_install_compress_lzop;
-	  return 1;
-	}
-      grub_util_error (_("Unrecognized compression `%s'"), arg);
+      compress_func = parse_compress (arg);
+      return 1;
+    case GRUB_INSTALL_OPTIONS_INSTALL_MODULE_COMPRESS:
+      module_compress_func = parse_compress (arg);
+      module_compress_set = 1;
+      return 1;
     case GRUB_INSTALL_OPTIONS_GRUB_MKIMAGE:
       return 1;
     case GRUB_INSTALL_OPTIONS_APPENDED_SIGNATURE_SIZE:
@@ -584,20 +606,20 @@ grub_install_parse (int key, char *arg)
 }
 
 static int
-decompressors (void)
+push_decompressor (compress_func_t func)
 {
-  if (compress_func == grub_install_compress_gzip)
+  if (func == grub_install_compress_gzip)
     {
       grub_install_push_module ("gzio");
       return 1;
     }
-  if (compress_func == grub_install_compress_xz)
+  if (func == grub_install_compress_xz)
     {
       grub_install_push_module ("xzio");
       grub_install_push_module ("gcry_crc");
       return 2;
     }
-  if (compress_func == grub_install_compress_lzop)
+  if (func == grub_install_compress_lzop)
     {
       grub_install_push_module ("lzopio");
       grub_install_push_module ("adler32");
@@ -607,6 +629,17 @@ decompressors (void)
   return 0;
 }
 
+/* Embed the modules needed to read the installed files.  */
+static int
+decompressors (void)
+{
+  int dc = push_decompressor (compress_func);
+
+  if (module_compress_set && module_compress_func != compress_func)
+    dc += push_decompressor (module_compress_func);
+  return dc;
+}
+
 void
 grub_install_make_image_wrap_file (const char *dir, const char *prefix,
 				   FILE *fp, const char *outname,
@@ -736,6 +769,7 @@ static void
 copy_by_ext (const char *srcd,
 	     const char *dstd,
 	     const char *extf,
+	     compress_func_t func,
 	     int req)
 {
   grub_util_fd_dir_t d;
@@ -755,7 +789,7 @@ copy_by_ext (const char *srcd,
 	{
 	  char *srcf = grub_util_path_concat (2, srcd, de->d_name);
 	  char *dstf = grub_util_path_concat (2, dstd, de->d_name);
-	  grub_install_compress_file (srcf, dstf, 1);
+	  compress_file_with (func, srcf, dstf, 1);
 	  free (srcf);
 	  free (dstf);
 	}
@@ -865,7 +899,7 @@ grub_install_copy_nls(const char *src __attribute__ ((unused)),
   if (install_locales.is_default)
     {
       char *srcd = grub_util_path_concat (2, src, "po");
-      copy_by_ext (srcd, dst_locale, ".mo", 0);
+      copy_by_ext (srcd, dst_locale, ".mo", compress_func, 0);
       copy_locales (dst_locale);
       free (srcd);
     }
@@ -1009,7 +1043,7 @@ grub_install_copy_files (const char *src,
   grub_install_copy_nls(src, dst);
 
   if (install_modules.is_default)
-    copy_by_ext (src, dst_platform, ".mod", 1);
+    copy_by_ext (src, dst_platform, ".mod", module_compression (), 1);
   else
     {
       struct grub_util_path_list *path_list, *p;
@@ -1028,7 +1062,7 @@ grub_install_copy_files (const char *src,
 	  else
 	    dir = srcf;
 	  dstf = grub_util_path_concat (2, dst_platform, dir);
-	  grub_install_compress_file (srcf, dstf, 1);
+	  compress_file_with (module_compression (), srcf, dstf, 1);
 	  free (dstf);
 	}
 
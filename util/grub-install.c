@@ -79,6 +79,7 @@ static char *label_color;
 static char *label_bgcolor;
 static char *product_version;
 static int add_rs_codes = 1;
+static int boot_prefetch = 0;
 
 enum
   {
@@ -109,7 +110,8 @@ enum
     OPTION_LABEL_FONT,
     OPTION_LABEL_COLOR,
     OPTION_LABEL_BGCOLOR,
-    OPTION_PRODUCT_VERSION
+    OPTION_PRODUCT_VERSION,
+    OPTION_BOOT_PREFETCH
   };
 
 static int fs_probe = 1;
@@ -200,6 +202,10 @@ argp_parser (int key, char *arg, struct argp_state *state)
       update_nvram = 0;
       return 0;
 
+    case OPTION_BOOT_PREFETCH:
+      boot_prefetch = 1;
+      return 0;
+
     case OPTION_FORCE:
       force = 1;
       return 0;
@@ -302,6 +308,9 @@ static struct argp_option options[] = {
   {"label-color", OPTION_LABEL_COLOR, N_("COLOR"), 0, N_("use COLOR for label"), 2},
   {"label-bgcolor", OPTION_LABEL_BGCOLOR, N_("COLOR"), 0, N_("use COLOR for label background"), 2},
   {"product-version", OPTION_PRODUCT_VERSION, N_("STRING"), 0, N_("use STRING as product version"), 2},
+  {"boot-prefetch", OPTION_BOOT_PREFETCH, 0, 0,
+   N_("record the disk blocks each boot reads and prefetch them on the "
+      "next boot"), 2},
   {0, 0, 0, 0, 0, 0}
 };
 
@@ -1254,6 +1263,14 @@ main (int argc, char *argv[])
   if (!grub_util_is_regular (envfile))
     grub_util_create_envblk_file (envfile);
 
+  if (boot_prefetch)
+    {
+      char *prefetch_file = grub_util_path_concat (2, grubdir, "prefetch");
+      if (!grub_util_is_regular (prefetch_file))
+	grub_util_create_prefetch_file (prefetch_file);
+      free (prefetch_file);
+    }
+
   size_t ndev = 0;
 
   /* Write device to a variable so we don't have to traverse /dev every time.  */